@@ -0,0 +1,129 @@
+/* Frame times of a render loop loading meshes, textures and programs in the
+ * middle of the run, synchronously and with the AssetLoader. */
+#include "troll_engine.h"
+#include "window.h"
+#include "assetloader.h"
+#include "image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+using namespace Engine;
+using namespace gl;
+
+const int frames = 600;
+const int loadFrame = 30;
+const int nMeshes = 20;
+const int nTextures = 8;
+const int nPrograms = 4;
+const char* meshFile = "../../examples/mesh/teapot.obj";
+const char* textureFile = "../../examples/mesh/metal.jpg";
+const char* vertexShader = "../../examples/mesh/vs.glsl";
+const char* fragmentShader = "../../examples/mesh/fs.glsl";
+const SceneImporter::PostProcess postProcess = SceneImporter::PostProcess::JoinVertices |
+                                               SceneImporter::PostProcess::GenerateNormals;
+
+struct Result {
+    double mean;
+    double worst;
+    /* Frame at which every asset is loaded */
+    int loaded;
+};
+
+/* Run the render loop, calling load at loadFrame and then update every frame
+ * until it returns true */
+template <class L, class U>
+Result run(GLFWWindow& win, L&& load, U&& update) {
+    std::vector<double> times;
+    int loaded = -1;
+    for(int frame = 0 ; frame != frames ; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if(frame == loadFrame)
+            load();
+        if(frame >= loadFrame && loaded < 0 && update())
+            loaded = frame;
+        win.swapBuffers();
+        win.pollEvents();
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    double total = 0.;
+    for(double t: times) {
+        total += t;
+    }
+    return {total / frames, *std::max_element(times.begin(), times.end()), loaded};
+}
+
+void print(const char* name, Result const& r) {
+    std::cout << std::setw(16) << name
+              << std::setw(12) << r.mean
+              << std::setw(12) << r.worst
+              << std::setw(12) << r.loaded - loadFrame << std::endl;
+}
+
+int main(int, char**) {
+    TrollEngine engine;
+    GLFWWindow win(1280, 720, "TrollEngine asset streaming benchmark", false, false);
+
+    std::cout << nMeshes << " x " << meshFile << ", " << nTextures << " x " << textureFile << ", "
+              << nPrograms << " programs loaded at frame " << loadFrame << std::endl
+              << std::setw(16) << ""
+              << std::setw(12) << "mean (ms)"
+              << std::setw(12) << "worst (ms)"
+              << std::setw(12) << "frames" << std::endl;
+
+    {
+        std::vector<std::unique_ptr<Mesh>> meshes;
+        std::vector<Texture> textures;
+        std::vector<Program> programs;
+        Result r = run(win, [&] () {
+            for(int i = 0 ; i != nMeshes ; ++i) {
+                SceneImporter imp;
+                imp.readFile(meshFile, postProcess);
+                for(const aiMesh* m: imp.meshes()) {
+                    meshes.push_back(imp.instantiateMesh(*m));
+                }
+            }
+            for(int i = 0 ; i != nTextures ; ++i) {
+                textures.push_back(Texture::fromImage(RGBImage::load(textureFile)));
+            }
+            for(int i = 0 ; i != nPrograms ; ++i) {
+                ProgramBuilder pb;
+                pb.vertexShader(vertexShader)
+                  .fragmentShader(fragmentShader);
+                programs.push_back(pb.build());
+            }
+        }, [] () { return true; });
+        print("synchronous", r);
+    }
+
+    for(double budget: {1., 2., 4.}) {
+        AssetLoader loader(2, budget);
+        std::vector<Asset<std::vector<std::unique_ptr<Mesh>>>> meshes;
+        std::vector<Asset<Texture>> textures;
+        std::vector<Asset<Program>> programs;
+        Result r = run(win, [&] () {
+            for(int i = 0 ; i != nMeshes ; ++i) {
+                meshes.push_back(loader.loadMeshes(meshFile, postProcess));
+            }
+            for(int i = 0 ; i != nTextures ; ++i) {
+                textures.push_back(loader.loadTexture(textureFile));
+            }
+            for(int i = 0 ; i != nPrograms ; ++i) {
+                programs.push_back(loader.loadProgram(vertexShader, fragmentShader));
+            }
+        }, [&loader] () {
+            loader.update();
+            return loader.loading() == 0 && loader.queued() == 0;
+        });
+        std::string name = "async " + std::to_string(static_cast<int>(budget)) + " ms";
+        print(name.c_str(), r);
+    }
+    return 0;
+}
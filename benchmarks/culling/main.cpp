@@ -0,0 +1,94 @@
+#include "scenegraph.h"
+#include "threadpool.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+
+const size_t nObjects = 500000;
+const int frames = 100;
+
+/* Drawable that issues no draw call, only the culling cost is measured */
+class EmptyNode : public DrawableNode {
+    public:
+        explicit EmptyNode(glm::mat4 const& m) : DrawableNode(m, nullptr, nullptr, 0) { }
+        virtual void drawCall(glm::mat4 const&) { }
+};
+
+/* Scatter the objects on a large terrain, under a few hundred group nodes */
+std::vector<Node*> build_scene(SceneGraph& scene) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> pos(-2000.f, 2000.f), height(0.f, 20.f);
+    std::vector<Node*> objects;
+    objects.reserve(nObjects);
+    std::vector<Node*> groups;
+    for(int i = 0 ; i != 256 ; ++i) {
+        groups.push_back(new Node());
+        scene.addChild(groups.back());
+    }
+    for(size_t i = 0 ; i != nObjects ; ++i) {
+        glm::vec3 p(pos(rng), height(rng), pos(rng));
+        DrawableNode* n = new EmptyNode(glm::translate(glm::mat4(1.f), p));
+        n->set_bounds(BoundingSphere(glm::vec3(0.f), 1.f));
+        groups[i % groups.size()]->addChild(n);
+        objects.push_back(n);
+    }
+    return objects;
+}
+
+/* Return the average frame time in milliseconds, moving \p moving objects
+ * per frame while the camera turns around */
+double time_render(SceneGraph& scene, std::vector<Node*> const& objects, size_t moving) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> pos(-2000.f, 2000.f);
+    scene.render();
+    auto start = std::chrono::steady_clock::now();
+    for(int frame = 0 ; frame != frames ; ++frame) {
+        scene.set_view(glm::rotate(glm::mat4(1.f), frame * 0.05f, glm::vec3(0.f, 1.f, 0.f)));
+        for(size_t i = 0 ; i != moving ; ++i) {
+            size_t o = (frame * moving + i) * 7919 % objects.size();
+            objects[o]->set_transform(glm::translate(glm::mat4(1.f), glm::vec3(pos(rng), 0.f, pos(rng))));
+        }
+        scene.render();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+int main(int, char**) {
+    ThreadPool pool;
+    SceneGraph scene;
+    std::vector<Node*> objects = build_scene(scene);
+    scene.renderQueue().set_sorting(false);
+    scene.set_projection(glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 500.f));
+    scene.set_thread_pool(&pool);
+
+    std::cout << nObjects << " objects" << std::endl
+              << std::setw(10) << "moving"
+              << std::setw(12) << "linear (ms)"
+              << std::setw(12) << "BVH (ms)"
+              << std::setw(12) << "drawn"
+              << std::setw(12) << "build (ms)"
+              << std::setw(12) << "refit (ms)"
+              << std::setw(12) << "query (ms)" << std::endl;
+    for(size_t moving: {size_t(0), size_t(100), size_t(5000)}) {
+        scene.set_bvh(false);
+        double linear = time_render(scene, objects, moving);
+        scene.set_bvh(true);
+        double bvh = time_render(scene, objects, moving);
+        BVH::Timings const& t = scene.bvh().timings();
+        std::cout << std::setw(10) << moving
+                  << std::setw(12) << linear
+                  << std::setw(12) << bvh
+                  << std::setw(12) << scene.cullStats().drawn
+                  << std::setw(12) << t.build
+                  << std::setw(12) << t.refit
+                  << std::setw(12) << t.query << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+#version 330
+
+in vec3 f_normal;
+
+out vec4 color;
+
+void main() {
+    float d = max(dot(normalize(f_normal), normalize(vec3(1.f, 1.f, 1.f))), 0.f);
+    color = vec4(vec3(0.1f + 0.9f * d), 1.f);
+}
@@ -0,0 +1,115 @@
+#include "troll_engine.h"
+#include "window.h"
+#include "program.h"
+#include "sceneimporter.h"
+#include "scenegraph.h"
+#include "glstate.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+using namespace gl;
+
+const int side = 100;
+const int frames = 100;
+
+/* Transform of the i-th teapot, on a side x side grid */
+glm::mat4 grid_transform(int i) {
+    glm::vec3 pos((i % side - side / 2) * 3.f, -2.f, -5.f - (i / side) * 3.f);
+    return glm::scale(glm::translate(glm::mat4(1.f), pos), glm::vec3(0.01f));
+}
+
+Program build_program(const char* vs, glm::mat4 const& projection) {
+    ProgramBuilder pb;
+    pb.vertexShader(vs)
+      .fragmentShader("fs.glsl")
+      .uniform("m_world", ProgramBuilder::UniformType::Mat4)
+      .uniform("projection", ProgramBuilder::UniformType::Mat4);
+    Program program = pb.build();
+    program.use();
+    dynamic_cast<Uniform<glm::mat4>*>(program.getUniform("projection"))->set(projection);
+    return program;
+}
+
+/* Render the scene and return the average frame time in milliseconds */
+double time_render(SceneGraph& scene, GLFWWindow& win) {
+    scene.render();
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0 ; i != frames ; ++i) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.render();
+        win.swapBuffers();
+        win.pollEvents();
+    }
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+int main(int, char**) {
+    TrollEngine engine;
+    GLFWWindow win(1280, 720, "TrollEngine instancing benchmark", false, false);
+    DepthState(true, true, GL_LESS).apply();
+
+    glm::mat4 projection = glm::perspective(glm::radians(55.f), 16.f / 9.f, 0.1f, 1000.f);
+    Program program = build_program("vs.glsl", projection);
+    Program instancedProgram = build_program("vs_instanced.glsl", projection);
+
+    SceneImporter imp;
+    imp.readFile("../../examples/mesh/teapot.obj", SceneImporter::PostProcess::JoinVertices |
+                 SceneImporter::PostProcess::GenerateNormals);
+    std::unique_ptr<Mesh> teapot = imp.instantiateMesh(*imp.meshes()[0]);
+
+    std::cout << side * side << " teapots" << std::endl
+              << std::setw(12) << ""
+              << std::setw(12) << "draws"
+              << std::setw(12) << "frame (ms)" << std::endl;
+
+    {
+        SceneGraph scene;
+        for(int i = 0 ; i != side * side ; ++i) {
+            scene.addChild(teapot->instantiate(grid_transform(i), &program));
+        }
+        double t = time_render(scene, win);
+        std::cout << std::setw(12) << "per object"
+                  << std::setw(12) << scene.renderStats().drawCalls
+                  << std::setw(12) << t << std::endl;
+    }
+
+    {
+        SceneGraph scene;
+        InstancedNode* node = teapot->instantiateInstanced(glm::mat4(1.f), &instancedProgram);
+        for(int i = 0 ; i != side * side ; ++i) {
+            node->addInstance(grid_transform(i));
+        }
+        scene.addChild(node);
+        double t = time_render(scene, win);
+        std::cout << std::setw(12) << "instanced"
+                  << std::setw(12) << scene.renderStats().drawCalls
+                  << std::setw(12) << t << std::endl;
+
+        /* Move every instance each frame, the whole instance VBO is uploaded */
+        auto start = std::chrono::steady_clock::now();
+        for(int f = 0 ; f != frames ; ++f) {
+            glm::mat4 offset = glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.01f * f, 0.f));
+            for(int i = 0 ; i != side * side ; ++i) {
+                node->set_instance(i, offset * grid_transform(i));
+            }
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            scene.render();
+            win.swapBuffers();
+            win.pollEvents();
+        }
+        glFinish();
+        t = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        std::cout << std::setw(12) << "animated"
+                  << std::setw(12) << scene.renderStats().drawCalls
+                  << std::setw(12) << t << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+#version 330
+
+uniform mat4 m_world;
+uniform mat4 projection;
+
+in vec3 v_position;
+in vec3 v_normal;
+
+out vec3 f_normal;
+
+void main() {
+    f_normal = mat3(m_world) * v_normal;
+    gl_Position = projection * m_world * vec4(v_position, 1.f);
+}
@@ -0,0 +1,16 @@
+#version 330
+
+uniform mat4 m_world;
+uniform mat4 projection;
+
+in vec3 v_position;
+in vec3 v_normal;
+in mat4 i_world;
+
+out vec3 f_normal;
+
+void main() {
+    mat4 world = m_world * i_world;
+    f_normal = mat3(world) * v_normal;
+    gl_Position = projection * world * vec4(v_position, 1.f);
+}
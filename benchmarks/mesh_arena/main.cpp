@@ -0,0 +1,118 @@
+#include "troll_engine.h"
+#include "window.h"
+#include "program.h"
+#include "mesharena.h"
+#include "scenegraph.h"
+#include "glstate.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+using namespace gl;
+
+const int nMeshes = 3000;
+const int frames = 100;
+
+/* Build a box of the given size, with one normal per face */
+std::unique_ptr<Mesh> box(glm::vec3 const& size, MeshArena* arena) {
+    std::vector<glm::vec3> vertices, normals;
+    std::vector<unsigned short> indices;
+    for(int axis = 0 ; axis != 3 ; ++axis) {
+        for(float side: {-1.f, 1.f}) {
+            glm::vec3 n(0.f);
+            n[axis] = side;
+            glm::vec3 u(0.f), v(0.f);
+            u[(axis + 1) % 3] = 1.f;
+            v[(axis + 2) % 3] = 1.f;
+            unsigned short first = static_cast<unsigned short>(vertices.size());
+            for(glm::vec2 c: {glm::vec2(-1.f, -1.f), glm::vec2(1.f, -1.f), glm::vec2(1.f, 1.f), glm::vec2(-1.f, 1.f)}) {
+                vertices.push_back(0.5f * size * (n + c.x * u + c.y * v));
+                normals.push_back(n);
+            }
+            indices.insert(indices.end(), {first, static_cast<unsigned short>(first + 1),
+                                           static_cast<unsigned short>(first + 2), first,
+                                           static_cast<unsigned short>(first + 2),
+                                           static_cast<unsigned short>(first + 3)});
+        }
+    }
+    MeshBuilder mb("box");
+    mb.arena(arena)
+      .vertices(vertices)
+      .normals(normals)
+      .faces(std::move(indices));
+    return mb.build_mesh();
+}
+
+/* Render the scene and return the average frame time in milliseconds */
+double time_render(SceneGraph& scene, GLFWWindow& win) {
+    scene.render();
+    glFinish();
+    GLState::resetCounters();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0 ; i != frames ; ++i) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.render();
+        win.pollEvents();
+    }
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+/* Render nMeshes distinct meshes, allocated in arena if not null */
+void run(const char* name, MeshArena* arena, Program& program, GLFWWindow& win) {
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    SceneGraph scene;
+    size_t buffers = 0;
+    for(int i = 0 ; i != nMeshes ; ++i) {
+        glm::vec3 size(0.2f + (i % 7) * 0.1f, 0.2f + (i % 5) * 0.1f, 0.2f + (i % 3) * 0.1f);
+        meshes.push_back(box(size, arena));
+        if(!arena)
+            buffers += meshes.back()->vertexBufferCount() + 1;
+        glm::vec3 pos((i % 60) - 30.f, (i / 60) % 50 - 25.f, -30.f - (i % 11) * 2.f);
+        scene.addChild(meshes.back()->instantiate(glm::translate(glm::mat4(1.f), pos), &program));
+    }
+    if(arena)
+        buffers = arena->bufferCount();
+    double t = time_render(scene, win);
+    RenderQueue::Stats const& stats = scene.renderStats();
+    std::cout << std::setw(12) << name
+              << std::setw(10) << buffers
+              << std::setw(10) << stats.vaoBinds
+              << std::setw(10) << stats.drawCalls
+              << std::setw(12) << GLState::counters().issued / frames
+              << std::setw(12) << t << std::endl;
+}
+
+int main(int, char**) {
+    TrollEngine engine;
+    GLFWWindow win(1280, 720, "TrollEngine mesh arena benchmark", false, false);
+    DepthState(true, true, GL_LESS).apply();
+
+    ProgramBuilder pb;
+    pb.vertexShader("vs.glsl")
+      .fragmentShader("fs.glsl")
+      .uniform("m_world", ProgramBuilder::UniformType::Mat4)
+      .uniform("projection", ProgramBuilder::UniformType::Mat4);
+    Program program = pb.build();
+    program.use();
+    program.uniform(program.uniformHandle<glm::mat4>("projection")).set(
+        glm::perspective(glm::radians(55.f), 16.f / 9.f, 0.1f, 1000.f));
+
+    std::cout << nMeshes << " meshes" << std::endl
+              << std::setw(12) << ""
+              << std::setw(10) << "buffers"
+              << std::setw(10) << "VAOs"
+              << std::setw(10) << "draws"
+              << std::setw(12) << "GL issued"
+              << std::setw(12) << "frame (ms)" << std::endl;
+    run("own buffers", nullptr, program, win);
+    MeshArena arena;
+    run("arena", &arena, program, win);
+    return 0;
+}
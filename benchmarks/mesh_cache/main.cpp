@@ -0,0 +1,102 @@
+/* Cold and warm load times of the MeshCache, on the teapot and on a synthetic
+ * grid mesh of a few hundred MB. The cache entries are written to the working
+ * directory, along with the synthetic mesh. */
+#include "troll_engine.h"
+#include "window.h"
+#include "meshcache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+using namespace Engine;
+using namespace gl;
+
+const SceneImporter::PostProcess postProcess = SceneImporter::PostProcess::JoinVertices |
+                                               SceneImporter::PostProcess::GenerateNormals;
+
+/* Write a grid of n * n vertices as an OBJ file, unless it exists */
+void writeGrid(const char* file, int n) {
+    if(std::ifstream(file).good())
+        return;
+    std::cout << "Writing " << file << "..." << std::endl;
+    std::ofstream out(file);
+    char line[64];
+    for(int y = 0 ; y != n ; ++y) {
+        for(int x = 0 ; x != n ; ++x) {
+            float h = 0.1f * static_cast<float>(((x * 7919) ^ (y * 104729)) % 97) / 97.f;
+            std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", static_cast<float>(x) / n, h,
+                          static_cast<float>(y) / n);
+            out << line;
+        }
+    }
+    for(int y = 0 ; y + 1 != n ; ++y) {
+        for(int x = 0 ; x + 1 != n ; ++x) {
+            // OBJ indices start at 1
+            int i = y * n + x + 1;
+            std::snprintf(line, sizeof(line), "f %d %d %d\nf %d %d %d\n", i, i + n, i + 1, i + 1, i + n, i + n + 1);
+            out << line;
+        }
+    }
+}
+
+size_t fileSize(std::string const& file) {
+    std::ifstream in(file, std::ios_base::binary | std::ios_base::ate);
+    return in ? static_cast<size_t>(in.tellg()) : 0;
+}
+
+/* Load time in ms, until the meshes are in GPU memory */
+double timeLoad(MeshCache& cache, const char* file, size_t& nVertices) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Mesh>> meshes = cache.load(file, postProcess);
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+    nVertices = 0;
+    for(auto const& m: meshes) {
+        nVertices += m->numVertices();
+    }
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void bench(MeshCache& cache, const char* file) {
+    std::string entry = cache.entry(file, postProcess);
+    std::remove(entry.c_str());
+    size_t nVertices;
+    double cold = timeLoad(cache, file, nVertices);
+    double warm = timeLoad(cache, file, nVertices);
+    std::cout << std::setw(40) << file
+              << std::setw(12) << fileSize(file) / 1024
+              << std::setw(12) << fileSize(entry) / 1024
+              << std::setw(12) << nVertices
+              << std::setw(12) << std::setprecision(4) << cold
+              << std::setw(12) << std::setprecision(4) << warm
+              << std::setw(10) << std::setprecision(3) << cold / warm << std::endl;
+}
+
+int main(int argc, char** argv) {
+    TrollEngine engine;
+    GLFWWindow win(64, 64, "TrollEngine mesh cache benchmark", false, false);
+
+    // 2048 * 2048 vertices is about 340 MB of OBJ
+    int gridSize = argc > 1 ? std::atoi(argv[1]) : 2048;
+    const char* teapot = "../../examples/mesh/teapot.obj";
+    const char* grid = "synthetic_grid.obj";
+    writeGrid(grid, gridSize);
+
+    MeshCache cache(".");
+    std::cout << std::setw(40) << "file"
+              << std::setw(12) << "file (KB)"
+              << std::setw(12) << "cache (KB)"
+              << std::setw(12) << "vertices"
+              << std::setw(12) << "cold (ms)"
+              << std::setw(12) << "warm (ms)"
+              << std::setw(10) << "speedup" << std::endl;
+    bench(cache, teapot);
+    bench(cache, grid);
+    return 0;
+}
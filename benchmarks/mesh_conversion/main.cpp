@@ -0,0 +1,111 @@
+/* Time to instantiate every mesh of a scene of a few hundred meshes, one at a
+ * time with SceneImporter::instantiateMesh and in parallel with
+ * SceneImporter::instantiateMeshes, for a growing number of threads. The
+ * synthetic scene is written to the working directory. */
+#include "troll_engine.h"
+#include "window.h"
+#include "sceneimporter.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace Engine;
+using namespace gl;
+
+const MeshBuilder::VertexLayout layout = MeshBuilder::VertexLayout::Interleaved;
+const MeshBuilder::Quantise quantise = MeshBuilder::Quantise::All;
+const MeshBuilder::Optimize optimize = MeshBuilder::Optimize::All;
+const int runs = 5;
+
+/* Write nObjects grids of n * n vertices of growing size as separate objects
+ * of an OBJ file, unless it exists */
+void writeScene(const char* file, int nObjects, int n) {
+    if(std::ifstream(file).good())
+        return;
+    std::ofstream out(file);
+    char line[64];
+    int first = 1;
+    for(int o = 0 ; o != nObjects ; ++o) {
+        // Sizes between n / 2 and n, so that the threads get uneven work
+        int size = n / 2 + (o * 7) % (n / 2 + 1);
+        out << "o object" << o << "\n";
+        for(int y = 0 ; y != size ; ++y) {
+            for(int x = 0 ; x != size ; ++x) {
+                float h = 0.1f * static_cast<float>((x * y + o) % 13) / 13.f;
+                std::snprintf(line, sizeof(line), "v %.5f %.5f %.5f\n", static_cast<float>(x) / size + o, h,
+                              static_cast<float>(y) / size);
+                out << line;
+            }
+        }
+        for(int y = 0 ; y + 1 != size ; ++y) {
+            for(int x = 0 ; x + 1 != size ; ++x) {
+                int i = first + y * size + x;
+                std::snprintf(line, sizeof(line), "f %d %d %d\nf %d %d %d\n", i, i + size, i + 1, i + 1, i + size,
+                              i + size + 1);
+                out << line;
+            }
+        }
+        first += size * size;
+    }
+}
+
+/* Best time of a few runs, in ms, until the meshes are in GPU memory */
+template <class F>
+double best(F&& f) {
+    double t = 1e30;
+    for(int r = 0 ; r != runs ; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+        t = std::min(t, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return t;
+}
+
+int main(int argc, char** argv) {
+    TrollEngine engine;
+    GLFWWindow win(64, 64, "TrollEngine mesh conversion benchmark", false, false);
+
+    int nObjects = argc > 1 ? std::atoi(argv[1]) : 400;
+    const char* file = "synthetic_scene.obj";
+    writeScene(file, nObjects, 64);
+    SceneImporter imp;
+    imp.readFile(file, SceneImporter::PostProcess::JoinVertices | SceneImporter::PostProcess::GenerateNormals);
+    std::cout << imp.meshes().size() << " meshes" << std::endl;
+
+    double serial = best([&imp] () {
+        std::vector<std::unique_ptr<Mesh>> meshes;
+        for(const aiMesh* m: imp.meshes()) {
+            meshes.push_back(imp.instantiateMesh(*m, layout, quantise, optimize));
+        }
+    });
+    std::cout << "instantiateMesh: " << serial << " ms" << std::endl << std::endl
+              << std::setw(10) << "threads"
+              << std::setw(18) << "batched (ms)"
+              << std::setw(10) << "speedup" << std::endl;
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned int threads = 1 ; threads <= maxThreads ; ++threads) {
+        // The calling thread converts meshes too
+        std::unique_ptr<ThreadPool> pool;
+        if(threads > 1)
+            pool.reset(new ThreadPool(threads - 1));
+        double t = best([&imp, &pool] () {
+            imp.instantiateMeshes(pool.get(), layout, quantise, optimize);
+        });
+        std::cout << std::setw(10) << threads
+                  << std::setw(18) << t
+                  << std::setw(9) << serial / t << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "troll_engine.h"
+#include "window.h"
+#include "program.h"
+#include "mesharena.h"
+#include "scenegraph.h"
+#include "glstate.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+using namespace gl;
+
+const int nObjects = 20000;
+const int frames = 100;
+
+/* Build a box of the given size centered on center, with one normal per face */
+std::unique_ptr<Mesh> box(glm::vec3 const& center, glm::vec3 const& size, MeshArena& arena) {
+    std::vector<glm::vec3> vertices, normals;
+    std::vector<unsigned short> indices;
+    for(int axis = 0 ; axis != 3 ; ++axis) {
+        for(float side: {-1.f, 1.f}) {
+            glm::vec3 n(0.f);
+            n[axis] = side;
+            glm::vec3 u(0.f), v(0.f);
+            u[(axis + 1) % 3] = 1.f;
+            v[(axis + 2) % 3] = 1.f;
+            unsigned short first = static_cast<unsigned short>(vertices.size());
+            for(glm::vec2 c: {glm::vec2(-1.f, -1.f), glm::vec2(1.f, -1.f), glm::vec2(1.f, 1.f), glm::vec2(-1.f, 1.f)}) {
+                vertices.push_back(center + 0.5f * size * (n + c.x * u + c.y * v));
+                normals.push_back(n);
+            }
+            indices.insert(indices.end(), {first, static_cast<unsigned short>(first + 1),
+                                           static_cast<unsigned short>(first + 2), first,
+                                           static_cast<unsigned short>(first + 2),
+                                           static_cast<unsigned short>(first + 3)});
+        }
+    }
+    MeshBuilder mb("box");
+    mb.arena(&arena)
+      .vertices(vertices)
+      .normals(normals)
+      .faces(std::move(indices));
+    return mb.build_mesh();
+}
+
+/* Render the scene and print the draw calls and the average CPU time spent
+ * submitting them, in milliseconds */
+void run(const char* name, SceneGraph& scene, GLFWWindow& win) {
+    scene.render();
+    glFinish();
+    double submit = 0.;
+    for(int i = 0 ; i != frames ; ++i) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        auto start = std::chrono::steady_clock::now();
+        scene.render();
+        auto end = std::chrono::steady_clock::now();
+        submit += std::chrono::duration<double, std::milli>(end - start).count();
+        win.swapBuffers();
+        win.pollEvents();
+    }
+    glFinish();
+    RenderQueue::Stats const& stats = scene.renderStats();
+    std::cout << std::setw(12) << name
+              << std::setw(10) << stats.drawCalls
+              << std::setw(10) << stats.merged
+              << std::setw(14) << submit / frames << std::endl;
+}
+
+int main(int, char**) {
+    TrollEngine engine;
+    GLFWWindow win(1280, 720, "TrollEngine multi-draw benchmark", false, false);
+    DepthState(true, true, GL_LESS).apply();
+
+    ProgramBuilder pb;
+    pb.vertexShader("vs.glsl")
+      .fragmentShader("fs.glsl")
+      .uniform("projection", ProgramBuilder::UniformType::Mat4);
+    Program program = pb.build();
+    program.use();
+    program.uniform(program.uniformHandle<glm::mat4>("projection")).set(
+        glm::perspective(glm::radians(55.f), 16.f / 9.f, 0.1f, 1000.f));
+
+    MeshArena arena;
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    SceneGraph scene;
+    for(int i = 0 ; i != nObjects ; ++i) {
+        glm::vec3 size(0.2f + (i % 7) * 0.1f, 0.2f + (i % 5) * 0.1f, 0.2f + (i % 3) * 0.1f);
+        glm::vec3 pos((i % 200) - 100.f, (i / 200) % 100 - 50.f, -60.f - (i % 13) * 2.f);
+        meshes.push_back(box(pos, size, arena));
+        scene.addChild(meshes.back()->instantiate(glm::mat4(1.f), &program));
+    }
+
+    std::cout << nObjects << " objects" << std::endl
+              << std::setw(12) << ""
+              << std::setw(10) << "draws"
+              << std::setw(10) << "merged"
+              << std::setw(14) << "submit (ms)" << std::endl;
+    scene.renderQueue().set_multi_draw(RenderQueue::MultiDraw::Off);
+    run("single", scene, win);
+    scene.renderQueue().set_multi_draw(RenderQueue::MultiDraw::BaseVertex);
+    run("base vertex", scene, win);
+    if(RenderQueue::indirectSupported()) {
+        scene.renderQueue().set_multi_draw(RenderQueue::MultiDraw::Indirect);
+        run("indirect", scene, win);
+    }
+    else {
+        std::cout << "ARB_multi_draw_indirect not supported" << std::endl;
+    }
+    return 0;
+}
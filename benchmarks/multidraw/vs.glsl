@@ -0,0 +1,14 @@
+#version 330
+
+uniform mat4 projection;
+
+in vec3 v_position;
+in vec3 v_normal;
+
+out vec3 f_normal;
+
+// Static geometry, the vertices are already in world space
+void main() {
+    f_normal = v_normal;
+    gl_Position = projection * vec4(v_position, 1.f);
+}
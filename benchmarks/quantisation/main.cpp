@@ -0,0 +1,54 @@
+/* GPU memory used by the meshes of a scene with float and quantised vertex
+ * formats, and the error introduced by the quantisation. */
+#include "troll_engine.h"
+#include "window.h"
+#include "sceneimporter.h"
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+
+using namespace Engine;
+
+int main(int argc, char** argv) {
+    TrollEngine engine;
+    GLFWWindow win(64, 64, "TrollEngine quantisation benchmark", false, false);
+
+    const char* file = argc > 1 ? argv[1] : "../../examples/mesh/teapot.obj";
+    SceneImporter imp;
+    imp.readFile(file, SceneImporter::PostProcess::JoinVertices | SceneImporter::PostProcess::GenerateNormals);
+
+    std::cout << std::setw(16) << "mesh"
+              << std::setw(12) << "float (B)"
+              << std::setw(12) << "quant. (B)"
+              << std::setw(8) << "ratio"
+              << std::setw(12) << "position"
+              << std::setw(12) << "normal (deg)"
+              << std::setw(12) << "uv"
+              << std::setw(12) << "color" << std::endl;
+    size_t totalFloat = 0, totalQuantised = 0;
+    for(const aiMesh* m: imp.meshes()) {
+        std::unique_ptr<Mesh> f = imp.instantiateMesh(*m);
+        std::unique_ptr<Mesh> q = imp.instantiateMesh(*m, MeshBuilder::VertexLayout::Interleaved,
+                                                      MeshBuilder::Quantise::All);
+        size_t floatBytes = f->vertexBytes() + f->indexBytes();
+        size_t quantisedBytes = q->vertexBytes() + q->indexBytes();
+        totalFloat += floatBytes;
+        totalQuantised += quantisedBytes;
+        Mesh::QuantisationError const& e = q->quantisationError();
+        std::cout << std::setw(16) << m->mName.C_Str()
+                  << std::setw(12) << floatBytes
+                  << std::setw(12) << quantisedBytes
+                  << std::setw(8) << std::setprecision(3) << static_cast<double>(quantisedBytes) / floatBytes
+                  << std::setw(12) << e.position
+                  << std::setw(12) << e.normal
+                  << std::setw(12) << e.uv
+                  << std::setw(12) << e.color << std::endl;
+    }
+    std::cout << std::setw(16) << "total"
+              << std::setw(12) << totalFloat
+              << std::setw(12) << totalQuantised
+              << std::setw(8) << std::setprecision(3) << static_cast<double>(totalQuantised) / totalFloat
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,11 @@
+#version 330
+
+uniform sampler2D tex;
+
+in vec2 f_texCoord;
+
+out vec4 color;
+
+void main() {
+    color = texture(tex, f_texCoord);
+}
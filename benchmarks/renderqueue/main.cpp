@@ -0,0 +1,113 @@
+#include "troll_engine.h"
+#include "window.h"
+#include "program.h"
+#include "scenegraph.h"
+#include "glstate.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+using namespace gl;
+
+const int nPrograms = 5;
+const int nTextures = 20;
+const int nObjects = 2000;
+const int frames = 200;
+
+/* Render the scene and return the average frame time in milliseconds */
+double time_render(SceneGraph& scene, GLFWWindow& win) {
+    scene.render();
+    glFinish();
+    GLState::resetCounters();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0 ; i != frames ; ++i) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.render();
+        win.pollEvents();
+    }
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+void print_stats(const char* name, RenderQueue::Stats const& stats, double ms) {
+    std::cout << std::setw(10) << name
+              << std::setw(12) << stats.programBinds
+              << std::setw(12) << stats.textureBinds
+              << std::setw(12) << stats.vaoBinds
+              << std::setw(12) << stats.drawCalls
+              << std::setw(12) << GLState::counters().issued / frames
+              << std::setw(12) << GLState::counters().skipped / frames
+              << std::setw(12) << ms << std::endl;
+}
+
+int main(int, char**) {
+    TrollEngine engine;
+    GLFWWindow win(1280, 720, "TrollEngine render queue benchmark", false, false);
+
+    DepthState().apply();
+    BlendState::alpha().apply();
+
+    glm::mat4 projection = glm::perspective(glm::radians(55.f), 16.f / 9.f, 0.1f, 1000.f);
+    std::vector<Program> programs;
+    programs.reserve(nPrograms);
+    for(int i = 0 ; i != nPrograms ; ++i) {
+        ProgramBuilder pb;
+        pb.vertexShader("vs.glsl")
+          .fragmentShader("fs.glsl")
+          .uniform("m_world", ProgramBuilder::UniformType::Mat4)
+          .uniform("projection", ProgramBuilder::UniformType::Mat4)
+          .uniform("tex", ProgramBuilder::UniformType::Int);
+        programs.push_back(pb.build());
+        programs.back().use();
+        dynamic_cast<Uniform<glm::mat4>*>(programs.back().getUniform("projection"))->set(projection);
+        dynamic_cast<Uniform<int>*>(programs.back().getUniform("tex"))->set(0);
+    }
+
+    std::vector<Texture> textures(nTextures);
+    for(int i = 0 ; i != nTextures ; ++i) {
+        unsigned char pixel[4] = { static_cast<unsigned char>(i * 12), 128, 255, 200 };
+        textures[i].texData(static_cast<GLint>(GL_RGBA), GL_RGBA, GL_UNSIGNED_BYTE, 1, 1, pixel);
+    }
+
+    auto quad = Mesh::quad();
+    SceneGraph scene;
+    /* Interleave the programs and textures, the worst case for scene graph order */
+    for(int i = 0 ; i != nObjects ; ++i) {
+        glm::vec3 pos((i % 50) - 25.f, (i / 50) % 40 - 20.f, -10.f - (i % 7) * 5.f);
+        DrawableNode* n = quad->instantiate(glm::translate(glm::mat4(1.f), pos), &programs[i % nPrograms],
+                                            &textures[(i * 7) % nTextures]);
+        n->set_transparent(i % 10 == 0);
+        scene.addChild(n);
+    }
+
+    std::cout << nObjects << " objects, " << nPrograms << " programs, "
+              << nTextures << " textures" << std::endl
+              << std::setw(10) << ""
+              << std::setw(12) << "programs"
+              << std::setw(12) << "textures"
+              << std::setw(12) << "VAOs"
+              << std::setw(12) << "draws"
+              << std::setw(12) << "GL issued"
+              << std::setw(12) << "GL skipped"
+              << std::setw(12) << "frame (ms)" << std::endl;
+
+    scene.renderQueue().set_sorting(false);
+    double t = time_render(scene, win);
+    print_stats("unsorted", scene.renderStats(), t);
+
+    scene.renderQueue().set_sorting(true);
+    t = time_render(scene, win);
+    print_stats("sorted", scene.renderStats(), t);
+
+    scene.set_projection(projection);
+    t = time_render(scene, win);
+    print_stats("culled", scene.renderStats(), t);
+    std::cout << scene.cullStats().culled << " of " << scene.cullStats().tested
+              << " objects culled" << std::endl;
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "scenegraph.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+
+/* Fill a scene graph with n nodes. Every node has up to 4 children, nodes are
+ * added breadth-first so the hierarchy stays shallow like in a real scene. */
+std::vector<Node*> build_scene(SceneGraph& scene, size_t n) {
+    std::vector<Node*> nodes;
+    nodes.reserve(n);
+    for(size_t i = 0 ; i != n ; ++i) {
+        float f = static_cast<float>(i);
+        glm::mat4 m = glm::translate(glm::mat4(1.f), glm::vec3(f * 0.01f, 1.f, -f * 0.02f));
+        m = glm::rotate(m, f * 0.001f, glm::vec3(0.f, 1.f, 0.f));
+        Node* node = new Node(m);
+        if(i < 4)
+            scene.addChild(node);
+        else
+            nodes[(i - 4) / 4]->addChild(node);
+        nodes.push_back(node);
+    }
+    return nodes;
+}
+
+/* Return the average time in milliseconds of a SceneGraph::render call.
+ * The update function is called before each frame. */
+double time_render(SceneGraph& scene, int frames, std::function<void(int)> update = [] (int) { }) {
+    // Warm up, this also flattens the scene in Flat storage mode
+    scene.render();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0 ; i != frames ; ++i) {
+        update(i);
+        scene.render();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+/* Move the root nodes, so that every world transform must be recomputed. */
+void move_roots(std::vector<Node*> const& nodes, int frame) {
+    for(size_t i = 0 ; i != 4 ; ++i) {
+        nodes[i]->set_transform(glm::translate(glm::mat4(1.f), glm::vec3(frame * 0.1f, 0.f, 0.f)));
+    }
+}
+
+int main(int, char**) {
+    const size_t sizes[] = { 1000, 100000, 1000000 };
+
+    // Fully animated scene: every node is updated every frame
+
+    std::cout << std::setw(10) << "nodes"
+              << std::setw(18) << "recursive (ms)"
+              << std::setw(18) << "flattened (ms)"
+              << std::setw(10) << "speedup" << std::endl;
+    for(size_t n: sizes) {
+        int frames = (n >= 1000000) ? 10 : (n >= 100000) ? 50 : 1000;
+        double recursive, flat;
+        {
+            SceneGraph scene(SceneGraph::Storage::Hierarchical);
+            std::vector<Node*> nodes = build_scene(scene, n);
+            recursive = time_render(scene, frames, [&] (int frame) { move_roots(nodes, frame); });
+        }
+        {
+            SceneGraph scene(SceneGraph::Storage::Flat);
+            std::vector<Node*> nodes = build_scene(scene, n);
+            flat = time_render(scene, frames, [&] (int frame) { move_roots(nodes, frame); });
+        }
+        std::cout << std::setw(10) << n
+                  << std::setw(18) << recursive
+                  << std::setw(18) << flat
+                  << std::setw(9) << recursive / flat << "x" << std::endl;
+    }
+
+    // Mostly static scene: only a few leaf nodes are animated every frame
+    const size_t n = 100000;
+    const size_t animated[] = { 0, 10, 1000, n };
+    std::cout << std::endl << "Flattened storage, " << n << " nodes" << std::endl
+              << std::setw(10) << "animated"
+              << std::setw(18) << "render (ms)"
+              << std::setw(18) << "updated nodes" << std::endl;
+    for(size_t k: animated) {
+        SceneGraph scene;
+        std::vector<Node*> nodes = build_scene(scene, n);
+        double t = time_render(scene, 50, [&] (int frame) {
+            for(size_t i = 0 ; i != k ; ++i) {
+                Node* node = nodes[n - 1 - (i * 7919) % n];
+                node->set_transform(glm::translate(glm::mat4(1.f), glm::vec3(0.f, frame * 0.1f, 0.f)));
+            }
+        });
+        std::cout << std::setw(10) << k
+                  << std::setw(18) << t
+                  << std::setw(18) << scene.updatedNodes() << std::endl;
+    }
+    return 0;
+}
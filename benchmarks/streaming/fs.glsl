@@ -0,0 +1,9 @@
+#version 330
+
+in vec2 f_texCoord;
+
+out vec4 color;
+
+void main() {
+    color = vec4(f_texCoord, 0.5f, 1.f);
+}
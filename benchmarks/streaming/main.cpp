@@ -0,0 +1,147 @@
+#include "troll_engine.h"
+#include "window.h"
+#include "program.h"
+#include "scenegraph.h"
+#include "streambuffer.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+using namespace gl;
+
+const int nStrips = 500;
+const int nQuads = 32;
+const int frames = 200;
+
+/* Quads of a strip of text moving with the frame number, as interleaved
+ * positions and texture coordinates */
+void strip(int s, int frame, std::vector<float>& vertices, std::vector<unsigned short>& indices) {
+    vertices.clear();
+    indices.clear();
+    float x0 = (s % 20) * 3.f - 30.f + std::sin(0.05f * frame + s);
+    float y0 = (s / 20) * 1.2f - 15.f;
+    for(int q = 0 ; q != nQuads ; ++q) {
+        float x = x0 + q * 0.09f;
+        float v = static_cast<float>((q + frame) % 16) / 16.f;
+        auto first = static_cast<unsigned short>(4 * q);
+        vertices.insert(vertices.end(), {x,         y0 + 1.f, -40.f, 0.f, v,
+                                         x + 0.08f, y0 + 1.f, -40.f, 1.f, v,
+                                         x + 0.08f, y0,       -40.f, 1.f, v + 0.0625f,
+                                         x,         y0,       -40.f, 0.f, v + 0.0625f});
+        indices.insert(indices.end(), {first, static_cast<unsigned short>(first + 2),
+                                       static_cast<unsigned short>(first + 1), first,
+                                       static_cast<unsigned short>(first + 3),
+                                       static_cast<unsigned short>(first + 2)});
+    }
+}
+
+/* Rebuild every strip as a new Mesh each frame */
+double rebuild(Program& program, GLFWWindow& win) {
+    std::vector<float> vertices;
+    std::vector<unsigned short> indices;
+    double total = 0.;
+    for(int frame = 0 ; frame != frames ; ++frame) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        auto start = std::chrono::steady_clock::now();
+        for(int s = 0 ; s != nStrips ; ++s) {
+            strip(s, frame, vertices, indices);
+            std::vector<glm::vec3> positions;
+            std::vector<glm::vec2> uvs;
+            for(size_t v = 0 ; v != vertices.size() ; v += 5) {
+                positions.push_back(glm::vec3(vertices[v], vertices[v + 1], vertices[v + 2]));
+                uvs.push_back(glm::vec2(vertices[v + 3], vertices[v + 4]));
+            }
+            MeshBuilder mb("strip");
+            mb.vertices(std::move(positions))
+              .uvs(uvs)
+              .faces(std::move(indices));
+            std::unique_ptr<Mesh> mesh = mb.build_mesh();
+            std::unique_ptr<DrawableNode> node(mesh->instantiate(glm::mat4(1.f), &program));
+            node->draw(glm::mat4(1.f));
+            indices = std::vector<unsigned short>();
+        }
+        auto end = std::chrono::steady_clock::now();
+        total += std::chrono::duration<double, std::milli>(end - start).count();
+        win.swapBuffers();
+        win.pollEvents();
+    }
+    glFinish();
+    return total / frames;
+}
+
+/* Write every strip to a StreamBuffer each frame */
+double stream(Program& program, GLFWWindow& win, StreamBuffer& buffer) {
+    MeshArena::VertexFormat format{0, 0, 2};
+    std::vector<std::unique_ptr<StreamObject>> nodes;
+    for(int s = 0 ; s != nStrips ; ++s) {
+        nodes.emplace_back(new StreamObject(glm::mat4(1.f), &program, buffer.vao(format)));
+    }
+    std::vector<float> vertices;
+    std::vector<unsigned short> indices;
+    double total = 0.;
+    for(int frame = 0 ; frame != frames ; ++frame) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        auto start = std::chrono::steady_clock::now();
+        for(int s = 0 ; s != nStrips ; ++s) {
+            strip(s, frame, vertices, indices);
+            nodes[s]->set_geometry(buffer.write(format, vertices.data(), nQuads * 4, indices));
+        }
+        buffer.flush();
+        for(auto& node: nodes) {
+            node->draw(glm::mat4(1.f));
+        }
+        buffer.endFrame();
+        auto end = std::chrono::steady_clock::now();
+        total += std::chrono::duration<double, std::milli>(end - start).count();
+        win.swapBuffers();
+        win.pollEvents();
+    }
+    glFinish();
+    return total / frames;
+}
+
+int main(int, char**) {
+    TrollEngine engine;
+    GLFWWindow win(1280, 720, "TrollEngine streaming benchmark", false, false);
+
+    ProgramBuilder pb;
+    pb.vertexShader("vs.glsl")
+      .fragmentShader("fs.glsl")
+      .uniform("projection", ProgramBuilder::UniformType::Mat4);
+    Program program = pb.build();
+    program.use();
+    program.uniform(program.uniformHandle<glm::mat4>("projection")).set(
+        glm::perspective(glm::radians(55.f), 16.f / 9.f, 0.1f, 1000.f));
+
+    std::cout << nStrips << " strips of " << nQuads << " quads rebuilt every frame" << std::endl
+              << std::setw(14) << ""
+              << std::setw(14) << "frame (ms)"
+              << std::setw(10) << "waits" << std::endl;
+    std::cout << std::setw(14) << "new meshes"
+              << std::setw(14) << rebuild(program, win)
+              << std::setw(10) << "-" << std::endl;
+    {
+        StreamBuffer buffer(16 << 20, 3, false);
+        double ms = stream(program, win, buffer);
+        std::cout << std::setw(14) << "stream"
+                  << std::setw(14) << ms
+                  << std::setw(10) << buffer.waits() << std::endl;
+    }
+    if(StreamBuffer::persistentSupported()) {
+        StreamBuffer buffer;
+        double ms = stream(program, win, buffer);
+        std::cout << std::setw(14) << "persistent"
+                  << std::setw(14) << ms
+                  << std::setw(10) << buffer.waits() << std::endl;
+    }
+    else {
+        std::cout << "ARB_buffer_storage not supported" << std::endl;
+    }
+    return 0;
+}
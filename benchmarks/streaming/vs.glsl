@@ -0,0 +1,14 @@
+#version 330
+
+uniform mat4 projection;
+
+in vec3 v_position;
+in vec2 v_texCoord;
+
+out vec2 f_texCoord;
+
+// Dynamic geometry, the vertices are already in world space
+void main() {
+    f_texCoord = v_texCoord;
+    gl_Position = projection * vec4(v_position, 1.f);
+}
@@ -0,0 +1,80 @@
+#include "scenegraph.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+
+/* Fill a scene graph with n nodes. Every node has up to 4 children, nodes are
+ * added breadth-first so the hierarchy stays shallow like in a real scene. */
+std::vector<Node*> build_scene(SceneGraph& scene, size_t n) {
+    std::vector<Node*> nodes;
+    nodes.reserve(n);
+    for(size_t i = 0 ; i != n ; ++i) {
+        float f = static_cast<float>(i);
+        glm::mat4 m = glm::translate(glm::mat4(1.f), glm::vec3(f * 0.01f, 1.f, -f * 0.02f));
+        m = glm::rotate(m, f * 0.001f, glm::vec3(0.f, 1.f, 0.f));
+        Node* node = new Node(m);
+        if(i < 4)
+            scene.addChild(node);
+        else
+            nodes[(i - 4) / 4]->addChild(node);
+        nodes.push_back(node);
+    }
+    return nodes;
+}
+
+/* Return the average time in milliseconds of a fully animated frame: the root
+ * nodes move every frame so that every world transform is recomputed. */
+double time_render(SceneGraph& scene, std::vector<Node*> const& nodes, int frames) {
+    scene.render();
+    auto start = std::chrono::steady_clock::now();
+    for(int frame = 0 ; frame != frames ; ++frame) {
+        for(size_t i = 0 ; i != 4 ; ++i) {
+            nodes[i]->set_transform(glm::translate(glm::mat4(1.f), glm::vec3(frame * 0.1f, 0.f, 0.f)));
+        }
+        scene.render();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+int main(int, char**) {
+    const size_t sizes[] = { 10000, 100000, 1000000 };
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(size_t n: sizes) {
+        int frames = (n >= 1000000) ? 20 : (n >= 100000) ? 100 : 1000;
+        SceneGraph scene;
+        std::vector<Node*> nodes = build_scene(scene, n);
+
+        std::cout << n << " nodes" << std::endl
+                  << std::setw(10) << "threads"
+                  << std::setw(18) << "render (ms)"
+                  << std::setw(10) << "speedup" << std::endl;
+        double serial = 0.;
+        for(unsigned int threads = 1 ; threads <= maxThreads ; ++threads) {
+            // The rendering thread takes part in the update
+            std::unique_ptr<ThreadPool> pool;
+            if(threads > 1)
+                pool.reset(new ThreadPool(threads - 1));
+            scene.set_thread_pool(pool.get());
+            double t = time_render(scene, nodes, frames);
+            if(threads == 1)
+                serial = t;
+            std::cout << std::setw(10) << threads
+                      << std::setw(18) << t
+                      << std::setw(9) << serial / t << "x" << std::endl;
+        }
+        scene.set_thread_pool(nullptr);
+        std::cout << std::endl;
+    }
+    return 0;
+}
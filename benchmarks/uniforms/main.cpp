@@ -0,0 +1,169 @@
+#include "troll_engine.h"
+#include "window.h"
+#include "program.h"
+#include "uniformbuffers.h"
+#include "uniformring.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+
+const int draws = 1000000;
+
+/* Transform of the i-th draw, so that every set() actually changes the value */
+glm::mat4 draw_transform(int i) {
+    return glm::translate(glm::mat4(1.f), glm::vec3(static_cast<float>(i % 1000), 0.f, 0.f));
+}
+
+/* Return the average cost in nanoseconds of setting the world transform of a
+ * draw, looking the uniform up by name like the draw path used to */
+double time_lookup(Program& program) {
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0 ; i != draws ; ++i) {
+        auto u = dynamic_cast<Uniform<glm::mat4>*>(program.getUniform("m_world"));
+        if(u)
+            u->set(draw_transform(i));
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / draws;
+}
+
+/* Same with a handle resolved once */
+double time_handle(Program& program, UniformHandle<glm::mat4> world) {
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0 ; i != draws ; ++i) {
+        if(world)
+            program.uniform(world).set(draw_transform(i));
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / draws;
+}
+
+/* Return the average cost in nanoseconds of a draw setting the world transform
+ * and uploading the uniforms of the program, like the scene graph draw path */
+double time_upload(Program& program, UniformHandle<glm::mat4> world) {
+    program.resetUniformCounters();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0 ; i != draws ; ++i) {
+        program.uniform(world).set(draw_transform(i));
+        program.uploadUniforms();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / draws;
+}
+
+const int blocks = 10000;
+const int frames = 100;
+
+/* Return the average time in milliseconds of a frame giving its own block to
+ * each draw, with one UBO per draw */
+double time_ubos() {
+    std::vector<std::unique_ptr<UBO<ObjectBlock>>> ubos;
+    for(int i = 0 ; i != blocks ; ++i) {
+        ubos.emplace_back(new UBO<ObjectBlock>());
+    }
+    auto start = std::chrono::steady_clock::now();
+    for(int f = 0 ; f != frames ; ++f) {
+        for(int i = 0 ; i != blocks ; ++i) {
+            ubos[static_cast<size_t>(i)]->data.world = draw_transform(i + f);
+            ubos[static_cast<size_t>(i)]->upload_std140();
+            ubos[static_cast<size_t>(i)]->bindBase(gl::GL_UNIFORM_BUFFER, ObjectBlockBinding);
+        }
+    }
+    gl::glFinish();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+/* Same with slices of a UniformRing, \p waits is set to the number of times
+ * the ring waited for the GPU */
+double time_ring(size_t& waits) {
+    UniformRing ring(blocks * 256 * 4);
+    std::vector<UniformRing::Slice> slices(blocks);
+    ObjectBlock block;
+    auto start = std::chrono::steady_clock::now();
+    for(int f = 0 ; f != frames ; ++f) {
+        for(int i = 0 ; i != blocks ; ++i) {
+            block.world = draw_transform(i + f);
+            slices[static_cast<size_t>(i)] = ring.push(block);
+        }
+        ring.flush();
+        for(auto const& s: slices) {
+            ring.bind(s, ObjectBlockBinding);
+        }
+        ring.endFrame();
+    }
+    gl::glFinish();
+    auto end = std::chrono::steady_clock::now();
+    waits = ring.waits();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+int main(int, char**) {
+    TrollEngine engine;
+    GLFWWindow win(640, 480, "TrollEngine uniforms benchmark", false, false);
+
+    /* A typical program, with the per-draw uniform registered last */
+    UniformHandle<glm::mat4> world;
+    ProgramBuilder pb;
+    pb.vertexShader("vs.glsl")
+      .fragmentShader("fs.glsl")
+      .uniform("projection", ProgramBuilder::UniformType::Mat4)
+      .uniform("view", ProgramBuilder::UniformType::Mat4)
+      .uniform("normal_matrix", ProgramBuilder::UniformType::Mat3)
+      .uniform("light_direction", ProgramBuilder::UniformType::Vec3)
+      .uniform("ambient", ProgramBuilder::UniformType::Vec3)
+      .uniform("intensity", ProgramBuilder::UniformType::Float)
+      .uniform("mode", ProgramBuilder::UniformType::Int)
+      .uniform("m_world", world);
+    Program program = pb.build();
+    program.use();
+    program.uniform(program.uniformHandle<glm::mat4>("projection")).set(
+        glm::perspective(glm::radians(55.f), 4.f / 3.f, 0.1f, 100.f));
+    program.uniform(program.uniformHandle<glm::mat4>("view")).set(glm::mat4(1.f));
+    program.uniform(program.uniformHandle<glm::mat3>("normal_matrix")).set(glm::mat3(1.f));
+    program.uniform(program.uniformHandle<glm::vec3>("light_direction")).set(glm::vec3(1.f));
+    program.uniform(program.uniformHandle<glm::vec3>("ambient")).set(glm::vec3(0.1f));
+    program.uniform(program.uniformHandle<float>("intensity")).set(1.f);
+    program.uniform(program.uniformHandle<int>("mode")).set(1);
+
+    double lookup = time_lookup(program);
+    double handle = time_handle(program, world);
+    std::cout << draws << " draws" << std::endl
+              << std::setw(12) << ""
+              << std::setw(14) << "draw (ns)" << std::endl
+              << std::setw(12) << "by name"
+              << std::setw(14) << lookup << std::endl
+              << std::setw(12) << "handle"
+              << std::setw(14) << handle << std::endl
+              << "speedup " << lookup / handle << "x" << std::endl;
+
+    /* Only m_world changes from one draw to the next, the other uniforms are
+     * uploaded by the first draw only */
+    double upload = time_upload(program, world);
+    Program::UniformCounters const& c = program.uniformCounters();
+    std::cout << std::endl
+              << std::setw(12) << "upload"
+              << std::setw(14) << upload << std::endl
+              << "uniforms uploaded " << c.uploaded
+              << ", skipped " << c.skipped << std::endl;
+
+    /* Per-draw uniform blocks */
+    double ubo = time_ubos();
+    size_t waits = 0;
+    double ring = time_ring(waits);
+    std::cout << std::endl << blocks << " blocks per frame" << std::endl
+              << std::setw(12) << ""
+              << std::setw(14) << "frame (ms)" << std::endl
+              << std::setw(12) << "UBO per draw"
+              << std::setw(14) << ubo << std::endl
+              << std::setw(12) << "ring"
+              << std::setw(14) << ring << std::endl
+              << "ring waits " << waits << std::endl;
+    return 0;
+}
@@ -0,0 +1,23 @@
+#version 330
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat3 normal_matrix;
+uniform vec3 light_direction;
+uniform vec3 ambient;
+uniform float intensity;
+uniform int mode;
+uniform mat4 m_world;
+
+in vec3 v_position;
+in vec3 v_normal;
+
+out vec3 f_normal;
+
+void main() {
+    vec3 n = normal_matrix * mat3(m_world) * v_normal;
+    if(mode != 0)
+        n += ambient * intensity * dot(n, light_direction);
+    f_normal = n;
+    gl_Position = projection * view * m_world * vec4(v_position, 1.f);
+}
@@ -0,0 +1,44 @@
+/* Vertex cache efficiency of the meshes of a scene before and after the
+ * index buffer optimisations of MeshBuilder. */
+#include "troll_engine.h"
+#include "window.h"
+#include "sceneimporter.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+
+using namespace Engine;
+
+int main(int argc, char** argv) {
+    TrollEngine engine;
+    GLFWWindow win(64, 64, "TrollEngine vertex cache benchmark", false, false);
+
+    const char* file = argc > 1 ? argv[1] : "../../examples/mesh/teapot.obj";
+    SceneImporter imp;
+    imp.readFile(file, SceneImporter::PostProcess::JoinVertices | SceneImporter::PostProcess::GenerateNormals);
+
+    std::cout << std::setw(16) << "mesh"
+              << std::setw(10) << "faces"
+              << std::setw(12) << "ACMR"
+              << std::setw(12) << "opt. ACMR"
+              << std::setw(12) << "ATVR"
+              << std::setw(12) << "opt. ATVR"
+              << std::setw(12) << "build (ms)" << std::endl;
+    for(const aiMesh* m: imp.meshes()) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::unique_ptr<Mesh> mesh = imp.instantiateMesh(*m, MeshBuilder::VertexLayout::Interleaved,
+                                                         MeshBuilder::Quantise::None, MeshBuilder::Optimize::All);
+        auto end = std::chrono::high_resolution_clock::now();
+        Mesh::VertexCacheReport const& r = mesh->vertexCacheReport();
+        std::cout << std::setw(16) << m->mName.C_Str()
+                  << std::setw(10) << m->mNumFaces
+                  << std::setw(12) << std::setprecision(3) << r.before.acmr
+                  << std::setw(12) << r.after.acmr
+                  << std::setw(12) << r.before.atvr
+                  << std::setw(12) << r.after.atvr
+                  << std::setw(12) << std::chrono::duration<double, std::milli>(end - start).count() << std::endl;
+    }
+    return 0;
+}
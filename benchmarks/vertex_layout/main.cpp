@@ -0,0 +1,96 @@
+/* Vertex throughput for each MeshBuilder::VertexLayout. The window is small so
+ * that rendering is bound by vertex processing. To measure it on a software
+ * rasteriser, run with Mesa's llvmpipe: LIBGL_ALWAYS_SOFTWARE=1 */
+#include "troll_engine.h"
+#include "window.h"
+#include "program.h"
+#include "sceneimporter.h"
+#include "scenegraph.h"
+#include "glstate.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Engine;
+using namespace gl;
+
+const int side = 20;
+const int frames = 50;
+
+/* Transform of the i-th teapot, on a side x side grid */
+glm::mat4 grid_transform(int i) {
+    glm::vec3 pos((i % side - side / 2) * 3.f, -2.f, -5.f - (i / side) * 3.f);
+    return glm::scale(glm::translate(glm::mat4(1.f), pos), glm::vec3(0.01f));
+}
+
+/* Render the scene and return the average frame time in milliseconds */
+double time_render(SceneGraph& scene, GLFWWindow& win) {
+    scene.render();
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0 ; i != frames ; ++i) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.render();
+        win.swapBuffers();
+        win.pollEvents();
+    }
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+int main(int, char**) {
+    TrollEngine engine;
+    GLFWWindow win(128, 128, "TrollEngine vertex layout benchmark", false, false);
+    DepthState(true, true, GL_LESS).apply();
+
+    ProgramBuilder pb;
+    pb.vertexShader("vs.glsl")
+      .fragmentShader("fs.glsl")
+      .uniform("m_world", ProgramBuilder::UniformType::Mat4)
+      .uniform("projection", ProgramBuilder::UniformType::Mat4);
+    Program program = pb.build();
+    program.use();
+    program.uniform(program.uniformHandle<glm::mat4>("projection")).set(
+        glm::perspective(glm::radians(55.f), 1.f, 0.1f, 1000.f));
+
+    SceneImporter imp;
+    imp.readFile("../../examples/mesh/teapot.obj", SceneImporter::PostProcess::JoinVertices |
+                 SceneImporter::PostProcess::GenerateNormals);
+
+    const struct {
+        const char* name;
+        MeshBuilder::VertexLayout layout;
+    } layouts[] = {
+        { "separate", MeshBuilder::VertexLayout::Separate },
+        { "pos+rest", MeshBuilder::VertexLayout::PositionSeparate },
+        { "interleaved", MeshBuilder::VertexLayout::Interleaved }
+    };
+
+    std::cout << side * side << " teapots" << std::endl
+              << std::setw(12) << ""
+              << std::setw(10) << "buffers"
+              << std::setw(14) << "vertex bytes"
+              << std::setw(12) << "frame (ms)"
+              << std::setw(14) << "Mverts/s" << std::endl;
+    for(auto const& l: layouts) {
+        std::unique_ptr<Mesh> teapot = imp.instantiateMesh(*imp.meshes()[0], l.layout);
+        SceneGraph scene;
+        for(int i = 0 ; i != side * side ; ++i) {
+            scene.addChild(teapot->instantiate(grid_transform(i), &program));
+        }
+        double t = time_render(scene, win);
+        // Positions and normals, whatever the layout
+        size_t bytes = teapot->numVertices() * 2 * sizeof(glm::vec3);
+        double verts = static_cast<double>(teapot->numFaces()) * side * side;
+        std::cout << std::setw(12) << l.name
+                  << std::setw(10) << teapot->vertexBufferCount()
+                  << std::setw(14) << bytes
+                  << std::setw(12) << t
+                  << std::setw(14) << verts / t / 1000. << std::endl;
+    }
+    return 0;
+}
@@ -8,6 +8,7 @@
 #include "utility.h"
 #include "ubo.h"
 #include "gl_traits.h"
+#include "glstate.h"
 
 #include <iostream>
 #include <glm/gtc/matrix_inverse.hpp>
@@ -50,11 +51,10 @@ int main(int, char**) {
 
     std::cout << win.context_info() << std::endl;
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
+    DepthState(true, true, GL_LESS).apply();
+    CullState::back().apply();
     glClearColor(0.f, 0.f, 0.f, 1.f);
     glClearDepth(1.f);
-    glDepthFunc(GL_LESS);
 
     UBO<Material> uboMat;
     uboMat.data.Ka = glm::vec3(0.1f, 0.1f, 0.1f);
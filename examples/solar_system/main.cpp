@@ -13,6 +13,7 @@
 #include "camera.h"
 #include "texture.h"
 #include "planet.h"
+#include "glstate.h"
 
 #include "debug.h"
 
@@ -255,7 +256,7 @@ int main(int argc, char** argv) {
         Camera camera;
         camera.translate(Camera::Back, 100);
         SceneGraph scene;
-        glActiveTexture(GL_TEXTURE0);
+        GLState::activeTexture(0);
         // Load textures
         Texture earthTex(   Texture::from_image("assets/texture_earth.bmp")),
                 moonTex(    Texture::from_image("assets/texture_moon.bmp")),
@@ -301,13 +302,10 @@ int main(int argc, char** argv) {
         earth->addChild(moon);
         scene.addChild(sun);
 
-        // TODO : this must go
         // Some more GL related stuff
-        glEnable(GL_CULL_FACE);
-        glEnable(GL_DEPTH_TEST);
-        glDepthMask(GL_TRUE);
-        glDepthFunc(GL_LEQUAL);
-        glDepthRange(0.0f, 1.0f);
+        const DepthState depthState(true, true, GL_LEQUAL);
+        depthState.apply();
+        CullState::back().apply();
         glClearDepth(1.0f);
 
         // Install input callbacks
@@ -325,7 +323,7 @@ int main(int argc, char** argv) {
             GLV(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
             // First draw the skybox with depth test off
-            glDisable(GL_DEPTH_TEST);
+            DepthState::disabled().apply();
             sunProgram.use();
             glm::mat4 m(cameraMatrix), m2,
                       rz(glm::rotate(glm::mat4(1), 3.141592f / 2, glm::vec3(1, 0, 0))),
@@ -343,7 +341,7 @@ int main(int argc, char** argv) {
             skyRight->draw(m * glm::transpose(ry));
 
             // Then render the rest with depth test on
-            glEnable(GL_DEPTH_TEST);
+            depthState.apply();
             dynamic_cast<Uniform<glm::mat4>*>(sunProgram.getUniform("m_camera"))->set(cameraMatrix);
             scene.render(); });
 
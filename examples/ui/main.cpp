@@ -6,6 +6,7 @@
 #include "utility.h"
 #include "ubo.h"
 #include "gl_traits.h"
+#include "glstate.h"
 
 #include <iostream>
 #include <cmath>
@@ -65,14 +66,11 @@ int main(int, char**) {
 
     std::cout << win.context_info() << std::endl;
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glBlendEquation(GL_FUNC_ADD);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    DepthState(true, true, GL_LESS).apply();
+    CullState::back().apply();
+    BlendState::alpha().apply();
     glClearColor(0.2f, 0.2f, 0.2f, 1.f);
     glClearDepth(1.f);
-    glDepthFunc(GL_LESS);
 
     ProgramBuilder pb;
     pb.vertexShader("vs.glsl")
@@ -0,0 +1,214 @@
+/**
+  * \file include/assetloader.h
+  * \brief Contains the definition of the AssetLoader class.
+  * \author R.Chavignat
+  */
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "program.h"
+#include "sceneimporter.h"
+#include "texture.h"
+#include "threadpool.h"
+
+namespace Engine {
+
+class AssetLoader;
+
+/**
+  * \class Asset
+  * \brief Handle to an asset loaded by an AssetLoader. The handle resolves
+  * once the asset is uploaded by \ref AssetLoader::update, on the thread of the
+  * OpenGL context. Copies of a handle refer to the same asset.
+  */
+template <class T>
+class Asset {
+    friend class AssetLoader;
+    public:
+        /**
+          * \brief Default constructor. Construct a handle to no asset.
+          */
+        Asset();
+
+        /**
+          * \brief Return true if the handle refers to an asset.
+          */
+        bool valid() const;
+        /**
+          * \brief Return true if the asset is loaded or failed to load.
+          */
+        bool ready() const;
+        /**
+          * \brief Return true if the asset failed to load.
+          */
+        bool failed() const;
+        /**
+          * \brief Return the asset. Throws the load error if the asset failed
+          * to load, and std::runtime_error if it isn't ready.
+          */
+        T& get() const;
+
+    private:
+        struct State {
+            bool ready;
+            std::exception_ptr error;
+            std::unique_ptr<T> value;
+        };
+        std::shared_ptr<State> m_state;
+};
+
+/**
+  * \class AssetLoader
+  * \brief Loads meshes, textures and programs without blocking the render
+  * loop.
+  *
+  * The files are read and decoded on worker threads, and the meshes converted.
+  * The OpenGL work left is queued and done by \ref update, to call once per
+  * frame on the thread of the OpenGL context, until the time or byte budget of
+  * the frame is spent.
+  */
+class AssetLoader {
+    public:
+        /**
+          * \struct UpdateStats
+          * \brief Work done by the last call to \ref update.
+          */
+        struct UpdateStats {
+            /** Uploads done */
+            size_t uploads;
+            /** Data uploaded, in bytes */
+            size_t bytes;
+            /** Time spent uploading, in milliseconds */
+            double milliseconds;
+        };
+
+        /**
+          * \brief Constructor.
+          * \param nThreads Number of worker threads reading and decoding the
+          * files. With 0, the files are read and decoded by the load calls.
+          * \param milliseconds Time budget of \ref update, 0 for no limit.
+          * \param bytes Byte budget of \ref update, 0 for no limit.
+          */
+        explicit AssetLoader(unsigned int nThreads = 2, double milliseconds = 2., size_t bytes = 8 << 20);
+
+        /**
+          * \brief Destructor. Waits for the workers, the loads that aren't
+          * uploaded yet never resolve.
+          */
+        virtual ~AssetLoader();
+
+        /**
+          * \brief Set the time and byte budgets of \ref update, 0 for no limit.
+          */
+        void budget(double milliseconds, size_t bytes);
+
+        /**
+          * \brief Load the meshes of a file, see \ref SceneImporter. Each mesh
+          * is uploaded separately, the handle resolves once they all are.
+          */
+        Asset<std::vector<std::unique_ptr<Mesh>>>
+        loadMeshes(std::string const& file, SceneImporter::PostProcess pp = SceneImporter::PostProcess::None,
+                   MeshBuilder::VertexLayout layout = MeshBuilder::VertexLayout::Interleaved,
+                   MeshBuilder::Quantise quantise = MeshBuilder::Quantise::None,
+                   MeshBuilder::Optimize optimize = MeshBuilder::Optimize::None);
+
+        /**
+          * \brief Load an RGB texture, see \ref Texture::fromImage.
+          */
+        Asset<Texture> loadTexture(std::string const& file);
+
+        /**
+          * \brief Load a program. The shader files are read by a worker, the
+          * compilation and the link are done by \ref update.
+          * \param vertexShader Path of the vertex shader
+          * \param fragmentShader Path of the fragment shader
+          * \param setup Called on the ProgramBuilder before the link, to
+          * register the uniforms.
+          */
+        Asset<Program> loadProgram(std::string const& vertexShader, std::string const& fragmentShader,
+                                   std::function<void(ProgramBuilder&)> setup = nullptr);
+
+        /**
+          * \brief Do the uploads of the completed loads until the budget of
+          * the frame is spent. At least one upload is done if any is queued,
+          * so that uploads larger than the budget still complete. The time
+          * budget is checked between uploads, so a single upload may exceed
+          * it.
+          * \return The number of uploads done.
+          */
+        size_t update();
+
+        /**
+          * \brief Wait for every load and upload it, whatever the budget. For
+          * loading screens.
+          */
+        void finish();
+
+        /**
+          * \brief Return the number of loads in progress on the workers.
+          */
+        size_t loading() const;
+        /**
+          * \brief Return the number of uploads waiting for \ref update.
+          */
+        size_t queued() const;
+        /**
+          * \brief Return the work done by the last call to \ref update.
+          */
+        UpdateStats const& lastUpdate() const;
+
+        /* No copy or move */
+        AssetLoader(AssetLoader const& other) = delete;
+        AssetLoader& operator=(AssetLoader const& other) = delete;
+        AssetLoader(AssetLoader&& other) = delete;
+        AssetLoader& operator=(AssetLoader&& other) = delete;
+
+    private:
+        /* OpenGL work of a completed load */
+        struct Upload {
+            /* Estimated size of the upload, in bytes */
+            size_t bytes;
+            std::function<void()> run;
+        };
+
+        double m_milliseconds;
+        size_t m_bytes;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<Upload> m_uploads;
+        std::atomic<size_t> m_loading;
+        UpdateStats m_stats;
+        /* Last member, so that the workers are joined before the queue is
+         * destroyed */
+        ThreadPool m_pool;
+
+        /* Run load on a worker. load returns the uploads of the asset, an
+         * exception fails the asset. */
+        template <class T>
+        void submit(std::shared_ptr<typename Asset<T>::State> state, std::function<std::vector<Upload>()> load);
+
+        /* Wrap the upload of an asset, an exception fails the asset and the
+         * next uploads of a failed asset are skipped */
+        template <class T, class F>
+        static std::function<void()> guarded(std::shared_ptr<typename Asset<T>::State> state, F f);
+
+        /* Queue the uploads of a completed load */
+        void complete(std::vector<Upload> uploads);
+};
+
+#include "assetloader.inl"
+
+} // namespace Engine
+
+#endif
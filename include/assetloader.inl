@@ -0,0 +1,74 @@
+#ifndef ASSET_LOADER_H
+#include "assetloader.h"
+#endif
+
+template <class T>
+Asset<T>::Asset() :
+    m_state()
+{ }
+
+template <class T>
+bool Asset<T>::valid() const {
+    return m_state != nullptr;
+}
+
+template <class T>
+bool Asset<T>::ready() const {
+    return m_state && m_state->ready;
+}
+
+template <class T>
+bool Asset<T>::failed() const {
+    return m_state && m_state->error != nullptr;
+}
+
+template <class T>
+T& Asset<T>::get() const {
+    if(!ready())
+        throw std::runtime_error("The asset isn't loaded yet.");
+    if(m_state->error)
+        std::rethrow_exception(m_state->error);
+    return *m_state->value;
+}
+
+template <class T>
+void AssetLoader::submit(std::shared_ptr<typename Asset<T>::State> state,
+                         std::function<std::vector<Upload>()> load) {
+    ++m_loading;
+    auto task = [this, state, load] () {
+        std::vector<Upload> uploads;
+        try {
+            uploads = load();
+        }
+        catch(...) {
+            // Failed on the context thread like the uploads, so that the
+            // state is only ever written there
+            std::exception_ptr e = std::current_exception();
+            uploads.push_back({0, [state, e] () {
+                state->error = e;
+                state->ready = true;
+            }});
+        }
+        complete(std::move(uploads));
+    };
+    // A pool without workers would never run the task
+    if(m_pool.size() == 0)
+        task();
+    else
+        m_pool.submit(task);
+}
+
+template <class T, class F>
+std::function<void()> AssetLoader::guarded(std::shared_ptr<typename Asset<T>::State> state, F f) {
+    return [state, f] () {
+        if(state->ready)
+            return;
+        try {
+            f();
+        }
+        catch(...) {
+            state->error = std::current_exception();
+            state->ready = true;
+        }
+    };
+}
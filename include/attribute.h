@@ -21,6 +21,28 @@ namespace Engine {
 
 class MeshBuilder;
 
+/**
+  * \brief Location of the "v_position" vertex attribute. ProgramBuilder binds
+  * the engine vertex attributes to fixed locations before linking, so that a
+  * VAO can be used with every program.
+  */
+constexpr unsigned int PositionAttribute = 0;
+/** \brief Location of the "v_normal" vertex attribute. */
+constexpr unsigned int NormalAttribute = 1;
+/** \brief Location of the "v_color" vertex attribute. */
+constexpr unsigned int ColorAttribute = 2;
+/** \brief Location of the "v_texCoord" vertex attribute. */
+constexpr unsigned int TexCoordAttribute = 3;
+/** \brief First location of the mat4 "i_world" instance attribute, which
+ *  spans 4 locations. */
+constexpr unsigned int InstanceWorldAttribute = 4;
+
+/**
+  * \brief Return the fixed location of an engine vertex attribute from its
+  * name in the shaders, -1 if it isn't one.
+  */
+int attributeLocation(std::string const& name);
+
 /**
  * \class AttributeArray
  * \brief Represents an array of vertex attributes
@@ -43,7 +65,11 @@ class AttributeArray {
             /** Unsigned 16bit integer */
             Ushort,
             /** Unsigned 32bit integer */
-            Uint
+            Uint,
+            /** Half precision floating point */
+            Half,
+            /** Signed 10bit x, y and z and 2bit w packed in a 32bit integer */
+            Int2101010Rev
         };
         /**
          * \enum Kind
@@ -320,6 +346,10 @@ namespace traits {
                     return gl::GL_UNSIGNED_SHORT;
                 case AttributeArray::Type::Int:
                     return gl::GL_INT;
+                case AttributeArray::Type::Half:
+                    return gl::GL_HALF_FLOAT;
+                case AttributeArray::Type::Int2101010Rev:
+                    return gl::GL_INT_2_10_10_10_REV;
             }
             UNREACHABLE(0);
         }
@@ -0,0 +1,180 @@
+/**
+  * \file include/bounds.h
+  * \brief Bounding volumes and view frustum.
+  * \author R.Chavignat
+  */
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Engine {
+
+/**
+  * \class AABB
+  * \brief Axis-aligned bounding box.
+  */
+class AABB {
+    public:
+        /**
+          * \brief Default constructor. Construct an empty box.
+          */
+        AABB();
+        /**
+          * \brief Construct the box with the specified corners.
+          */
+        AABB(glm::vec3 const& min, glm::vec3 const& max);
+
+        /**
+          * \brief Return the smallest box containing the points.
+          */
+        static AABB fromPoints(std::vector<glm::vec3> const& points);
+
+        /**
+          * \brief Return true if the box contains no point.
+          */
+        bool empty() const;
+
+        glm::vec3 const& min() const;
+        glm::vec3 const& max() const;
+        glm::vec3 center() const;
+        /**
+          * \brief Return the half size of the box along each axis.
+          */
+        glm::vec3 extents() const;
+
+        /**
+          * \brief Grow the box to contain the point.
+          */
+        void expand(glm::vec3 const& p);
+        /**
+          * \brief Grow the box to contain another box.
+          */
+        void expand(AABB const& other);
+
+        /**
+          * \brief Return the box containing this box transformed by m.
+          */
+        AABB transformed(glm::mat4 const& m) const;
+
+    private:
+        glm::vec3 m_min, m_max;
+};
+
+/**
+  * \class BoundingSphere
+  * \brief Bounding sphere. A negative radius means that the sphere is
+  * unbounded, i.e. the object must never be culled.
+  */
+class BoundingSphere {
+    public:
+        /**
+          * \brief Default constructor. Construct an unbounded sphere.
+          */
+        BoundingSphere();
+        /**
+          * \brief Construct a sphere.
+          */
+        BoundingSphere(glm::vec3 const& center, float radius);
+
+        /**
+          * \brief Return a sphere containing the points, centered on their
+          * bounding box.
+          */
+        static BoundingSphere fromPoints(std::vector<glm::vec3> const& points);
+
+        glm::vec3 const& center() const;
+        float radius() const;
+        /**
+          * \brief Return true if the sphere is unbounded.
+          */
+        bool unbounded() const;
+
+        /**
+          * \brief Return the sphere containing this sphere transformed by m.
+          * The radius is scaled by the largest scaling factor of m.
+          */
+        BoundingSphere transformed(glm::mat4 const& m) const;
+
+    private:
+        glm::vec3 m_center;
+        float m_radius;
+};
+
+/**
+  * \class Frustum
+  * \brief View frustum, as six planes pointing inwards.
+  */
+class Frustum {
+    public:
+        /**
+          * \enum Plane
+          * \brief Frustum plane indices.
+          */
+        enum Plane { Left = 0, Right, Bottom, Top, Near, Far };
+
+        /**
+          * \brief Extract the frustum planes from a projection * view matrix.
+          */
+        explicit Frustum(glm::mat4 const& viewProjection);
+
+        /**
+          * \brief Return the normalized plane equation (a, b, c, d): a point p is
+          * inside the half-space if dot(vec3(a, b, c), p) + d >= 0.
+          */
+        glm::vec4 const& plane(int i) const;
+
+        /**
+          * \brief Return false if the sphere is entirely outside of the frustum.
+          */
+        bool intersects(BoundingSphere const& s) const;
+        /**
+          * \brief Return false if the box is entirely outside of the frustum.
+          */
+        bool intersects(AABB const& b) const;
+
+    private:
+        glm::vec4 m_planes[6];
+};
+
+/**
+  * \struct SphereArray
+  * \brief Bounding spheres stored as a structure of arrays, for \ref cullSpheres.
+  */
+struct SphereArray {
+    std::vector<float> x, y, z, r;
+
+    void clear();
+    void resize(size_t n);
+    size_t size() const;
+    void set(size_t i, BoundingSphere const& s);
+    BoundingSphere get(size_t i) const;
+};
+
+/**
+  * \brief Test bounding spheres against a frustum.
+  * The spheres are passed as a structure of arrays. Uses AVX or SSE when
+  * available, 8 or 4 spheres at a time.
+  * \param f Frustum.
+  * \param x, y, z, r Sphere centers and radii. Spheres with a negative radius are
+  * always visible.
+  * \param n Number of spheres.
+  * \param minSize Spheres whose radius is smaller than minSize times their distance
+  * to the near plane are culled too. 0 disables this test.
+  * \param visible Output, set to 1 for visible spheres and 0 for culled spheres.
+  * \return The number of visible spheres.
+  */
+size_t cullSpheres(Frustum const& f, const float* x, const float* y, const float* z, const float* r,
+                   size_t n, float minSize, std::uint8_t* visible);
+
+/**
+  * \brief Scalar implementation of \ref cullSpheres.
+  */
+size_t cullSpheresScalar(Frustum const& f, const float* x, const float* y, const float* z, const float* r,
+                         size_t n, float minSize, std::uint8_t* visible);
+
+} // namespace Engine
+
+#endif
@@ -0,0 +1,118 @@
+/**
+  * \file include/bvh.h
+  * \brief Contains the definition of the BVH class.
+  * \author R.Chavignat
+  */
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+namespace Engine {
+
+/**
+  * \class BVH
+  * \brief Bounding volume hierarchy over a set of axis-aligned boxes.
+  *
+  * Items are identified by their index in the box array passed to \ref build.
+  * The tree is built with the surface area heuristic, and can be refit when
+  * the items move. Refitting keeps the topology, so the tree degrades when
+  * the items move a lot and should be rebuilt from time to time.
+  */
+class BVH {
+    public:
+        /**
+          * \struct Timings
+          * \brief Duration of the last operations, in milliseconds.
+          */
+        struct Timings {
+            double build;
+            double refit;
+            double query;
+        };
+
+        /**
+          * \brief Constructor. Construct an empty hierarchy.
+          */
+        BVH();
+
+        /**
+          * \brief Build the hierarchy over the boxes. Empty boxes are not
+          * inserted, and are never returned by the queries.
+          */
+        void build(std::vector<AABB> const& boxes);
+
+        /**
+          * \brief Update the node boxes for new item boxes, without changing the
+          * topology. \p boxes must have the size used to build the hierarchy.
+          */
+        void refit(std::vector<AABB> const& boxes);
+        /**
+          * \brief Update the node boxes above the specified items only. The
+          * boxes of the other items must not have changed.
+          */
+        void refit(std::vector<AABB> const& boxes, std::vector<int> const& items);
+
+        /**
+          * \brief Append the items whose box intersects the frustum to \p items.
+          */
+        void query(Frustum const& f, std::vector<int>& items) const;
+        /**
+          * \brief Append the items whose box intersects the region to \p items.
+          */
+        void query(AABB const& region, std::vector<int>& items) const;
+        /**
+          * \brief Return the item whose box is hit first by the ray, -1 if none.
+          * \param origin Ray origin.
+          * \param direction Ray direction, needs not be normalized.
+          * \param t If not null, set to the ray parameter of the hit.
+          */
+        int raycast(glm::vec3 const& origin, glm::vec3 const& direction, float* t = nullptr) const;
+
+        /**
+          * \brief Return the number of items in the hierarchy.
+          */
+        size_t size() const;
+        /**
+          * \brief Return the number of nodes of the tree.
+          */
+        size_t nodeCount() const;
+        /**
+          * \brief Return the bounding box of every item.
+          */
+        AABB const& bounds() const;
+
+        /**
+          * \brief Return the duration of the last build, refit and query.
+          */
+        Timings const& timings() const;
+
+    private:
+        /* Leaves have count != 0 and hold m_items[first, first + count).
+         * Inner nodes have count == 0 and their children at first and first + 1,
+         * which are always stored after their parent. */
+        struct Node {
+            AABB box;
+            int first;
+            int count;
+            int parent;
+        };
+
+        std::vector<Node> m_nodes;
+        std::vector<int> m_items;
+        /* Box of each item */
+        std::vector<AABB> m_boxes;
+        /* Leaf of each item, -1 for items that weren't inserted */
+        std::vector<int> m_leaves;
+        mutable Timings m_timings;
+
+        /* Return the box of a node computed from its items or children */
+        AABB nodeBox(Node const& n) const;
+};
+
+} // namespace Engine
+
+#endif
@@ -0,0 +1,119 @@
+/**
+  * \file include/fencedring.h
+  * \brief Contains the definition of the FencedRing class.
+  * \author R.Chavignat
+  */
+#ifndef FENCED_RING_H
+#define FENCED_RING_H
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <glbinding/gl33core/gl.h>
+
+namespace Engine {
+
+/**
+  * \class FencedRing
+  * \brief Allocation state of a ring buffer whose ranges are used by the GPU
+  * for a few frames, shared by \ref StreamBuffer and \ref UniformRing.
+  *
+  * Only offsets are handed out, the owner of the ring holds the memory. The
+  * ranges of a frame are fenced by \ref endFrame and recycled once the fence
+  * signals, waiting for it when the ring runs out of space or when too many
+  * frames are in flight. The ring also tracks the bytes allocated since the
+  * last \ref flush, and passes them to an upload function so that they always
+  * are contiguous.
+  */
+class FencedRing {
+    public:
+        /**
+          * \brief Copies [offset, offset + size) of the owner's memory to the
+          * GPU buffer.
+          */
+        using Upload = std::function<void(size_t offset, size_t size)>;
+
+        /**
+          * \brief Constructor.
+          * \param name Name of the owner, for the error messages.
+          * \param size Size of the ring, in bytes.
+          * \param frames Maximum number of frames in flight.
+          * \param upload Called by \ref flush with the range to upload.
+          */
+        FencedRing(std::string const& name, size_t size, unsigned int frames, Upload upload);
+
+        /**
+          * \brief Destructor. Deletes the fences without waiting for them.
+          */
+        ~FencedRing();
+
+        FencedRing(FencedRing const& other) = delete;
+        FencedRing(FencedRing&& other) = delete;
+        FencedRing& operator=(FencedRing const& other) = delete;
+        FencedRing& operator=(FencedRing&& other) = delete;
+
+        /**
+          * \brief Allocate a range for the current frame and return its
+          * offset. Throws a std::runtime_error if the ranges of the frame
+          * don't fit in the ring.
+          * \param size Size of the range, in bytes.
+          * \param alignment Alignment of the start of the range, in bytes.
+          */
+        size_t allocate(size_t size, size_t alignment);
+
+        /**
+          * \brief Upload the ranges allocated since the last flush.
+          */
+        void flush();
+
+        /**
+          * \brief Flush, and fence the ranges of the current frame.
+          */
+        void endFrame();
+
+        /**
+          * \brief Return the size of the ring, in bytes.
+          */
+        size_t size() const;
+
+        /**
+          * \brief Return the number of bytes used by the frames in flight and
+          * the current frame, alignment padding included.
+          */
+        size_t used() const;
+
+        /**
+          * \brief Return the number of times the ring waited for the GPU to
+          * recycle ranges.
+          */
+        size_t waits() const;
+
+    private:
+        struct Frame {
+            gl::GLsync fence;
+            /* Bytes allocated by the frame, padding included */
+            size_t bytes;
+        };
+
+        std::string m_name;
+        size_t m_size;
+        unsigned int m_maxFrames;
+        Upload m_upload;
+        /* Offset of the end of the last allocation */
+        size_t m_head;
+        /* Bytes in use, from the oldest frame in flight to m_head */
+        size_t m_used;
+        size_t m_frameBytes;
+        /* Offset and size of the bytes allocated since the last flush */
+        size_t m_flushed;
+        size_t m_unflushed;
+        std::deque<Frame> m_frames;
+        size_t m_waits;
+
+        /* Wait for the oldest frame in flight and recycle its ranges */
+        void releaseFrame();
+};
+
+} // namespace Engine
+
+#endif
@@ -8,17 +8,46 @@
 #ifndef GL_TRAITS_H
 #define GL_TRAITS_H
 
+#include <array>
+#include <cstring>
+#include <type_traits>
 #include <glm/glm.hpp>
 
 namespace Engine {
     namespace traits {
+        /**
+         * @brief Layout of a type in the GLSL std140 storage layout: its base
+         * alignment, its size, and how to copy a value to a buffer.
+         *
+         * Specialized for the GLSL scalar, vector and matrix types, and for
+         * fixed-size arrays. The primary template handles uniform blocks
+         * nested in other blocks, it is defined in ubo.h.
+         *
+         * @tparam T GLSL-compatible type.
+         */
+        template <class T>
+        struct std140_layout;
+
         /**
          * @brief Meta-function returning the GLSL alignment of a specified type.
          *
          * @tparam T GLSL-compatible type.
          */
         template <class T>
-        struct glsl_alignment;
+        struct glsl_alignment {
+            static constexpr size_t value = std140_layout<T>::alignment;
+        };
+
+        /**
+         * @brief Meta-function returning the size in bytes of a specified type
+         * in the GLSL std140 layout.
+         *
+         * @tparam T GLSL-compatible type.
+         */
+        template <class T>
+        struct glsl_size {
+            static constexpr size_t value = std140_layout<T>::size;
+        };
 
         #ifndef DOX_SKIP_BLOCK
         template <class T>
@@ -26,20 +55,134 @@ namespace Engine {
             static constexpr size_t value = glsl_alignment<typename std::remove_cv<typename std::remove_reference<T>::type>::type>::value;
         };
 
-        template <>
-        struct glsl_alignment<bool> {
-            static constexpr size_t value = 4;
+        template <class T>
+        struct glsl_size<T&> {
+            static constexpr size_t value = glsl_size<typename std::remove_cv<typename std::remove_reference<T>::type>::type>::value;
         };
 
-        template <>
-        struct glsl_alignment<float> {
-            static constexpr size_t value = 4;
+        // Scalars are 4 bytes, GLSL booleans included
+        template <class T>
+        struct std140_scalar {
+            static_assert(sizeof(T) == 4, "std140 scalars are 4 bytes long");
+            static constexpr size_t alignment = 4;
+            static constexpr size_t size = 4;
+
+            static void pack(T const& value, char* dst) {
+                std::memcpy(dst, &value, 4);
+            }
+        };
+
+        // Vectors of N components of type C: vec2 is 8 bytes aligned, vec3 and
+        // vec4 are 16 bytes aligned
+        template <class V, class C, size_t N>
+        struct std140_vector {
+            static constexpr size_t alignment = (N == 2) ? 8 : 16;
+            static constexpr size_t size = 4 * N;
+
+            static void pack(V const& value, char* dst) {
+                for(size_t i = 0 ; i != N ; ++i) {
+                    std140_layout<C>::pack(value[static_cast<int>(i)], dst + 4 * i);
+                }
+            }
+        };
+
+        // Matrices are laid out as arrays of C column vectors
+        template <class M, class Column, size_t C>
+        struct std140_matrix {
+            static constexpr size_t alignment = 16;
+            static constexpr size_t size = 16 * C;
+
+            static void pack(M const& value, char* dst) {
+                for(size_t i = 0 ; i != C ; ++i) {
+                    std140_layout<Column>::pack(value[static_cast<int>(i)], dst + 16 * i);
+                }
+            }
         };
 
+        // Array elements are aligned on 16 bytes, whatever their type
+        template <class T, size_t N>
+        struct std140_array {
+            static constexpr size_t stride = (std140_layout<T>::size + 15) / 16 * 16;
+            static constexpr size_t alignment = 16;
+            static constexpr size_t size = stride * N;
+
+            template <class A>
+            static void pack(A const& value, char* dst) {
+                for(size_t i = 0 ; i != N ; ++i) {
+                    std140_layout<T>::pack(value[i], dst + stride * i);
+                }
+            }
+        };
+
+        template <>
+        struct std140_layout<float> : std140_scalar<float> { };
+
+        template <>
+        struct std140_layout<int> : std140_scalar<int> { };
+
+        template <>
+        struct std140_layout<unsigned int> : std140_scalar<unsigned int> { };
+
         template <>
-        struct glsl_alignment<glm::vec3> {
-            static constexpr size_t value = 16;
+        struct std140_layout<bool> {
+            static constexpr size_t alignment = 4;
+            static constexpr size_t size = 4;
+
+            static void pack(bool value, char* dst) {
+                std140_scalar<unsigned int>::pack(value ? 1u : 0u, dst);
+            }
         };
+
+        template <>
+        struct std140_layout<glm::vec2> : std140_vector<glm::vec2, float, 2> { };
+
+        template <>
+        struct std140_layout<glm::vec3> : std140_vector<glm::vec3, float, 3> { };
+
+        template <>
+        struct std140_layout<glm::vec4> : std140_vector<glm::vec4, float, 4> { };
+
+        template <>
+        struct std140_layout<glm::ivec2> : std140_vector<glm::ivec2, int, 2> { };
+
+        template <>
+        struct std140_layout<glm::ivec3> : std140_vector<glm::ivec3, int, 3> { };
+
+        template <>
+        struct std140_layout<glm::ivec4> : std140_vector<glm::ivec4, int, 4> { };
+
+        template <>
+        struct std140_layout<glm::uvec2> : std140_vector<glm::uvec2, unsigned int, 2> { };
+
+        template <>
+        struct std140_layout<glm::uvec3> : std140_vector<glm::uvec3, unsigned int, 3> { };
+
+        template <>
+        struct std140_layout<glm::uvec4> : std140_vector<glm::uvec4, unsigned int, 4> { };
+
+        template <>
+        struct std140_layout<glm::bvec2> : std140_vector<glm::bvec2, bool, 2> { };
+
+        template <>
+        struct std140_layout<glm::bvec3> : std140_vector<glm::bvec3, bool, 3> { };
+
+        template <>
+        struct std140_layout<glm::bvec4> : std140_vector<glm::bvec4, bool, 4> { };
+
+        template <>
+        struct std140_layout<glm::mat2> : std140_matrix<glm::mat2, glm::vec2, 2> { };
+
+        template <>
+        struct std140_layout<glm::mat3> : std140_matrix<glm::mat3, glm::vec3, 3> { };
+
+        template <>
+        struct std140_layout<glm::mat4> : std140_matrix<glm::mat4, glm::vec4, 4> { };
+
+        template <class T, size_t N>
+        struct std140_layout<T[N]> : std140_array<T, N> { };
+
+        template <class T, size_t N>
+        struct std140_layout<std::array<T, N>> : std140_array<T, N> { };
         #endif // DOX_SKIP_BLOCK
     } // namespace traits
 } // namespace Engine
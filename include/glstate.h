@@ -0,0 +1,248 @@
+/**
+  * \file include/glstate.h
+  * \brief Contains the definition of the GLState cache and of the render state objects.
+  * \author R.Chavignat
+  */
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <cstddef>
+#include <glbinding/gl33core/gl.h>
+
+namespace Engine {
+
+class Program;
+
+/**
+  * \class BlendState
+  * \brief Immutable blending configuration.
+  */
+class BlendState {
+    public:
+        /**
+          * \brief Constructor.
+          * \param enabled Enable blending
+          * \param src Source blending factor
+          * \param dst Destination blending factor
+          * \param equation Blending equation
+          */
+        explicit BlendState(bool enabled = false, gl::GLenum src = gl::GL_ONE, gl::GLenum dst = gl::GL_ZERO,
+                            gl::GLenum equation = gl::GL_FUNC_ADD);
+
+        /**
+          * \brief Return a state with blending disabled.
+          */
+        static BlendState opaque();
+        /**
+          * \brief Return a state for alpha blending.
+          */
+        static BlendState alpha();
+        /**
+          * \brief Return a state for additive blending.
+          */
+        static BlendState additive();
+
+        bool enabled() const;
+        gl::GLenum src() const;
+        gl::GLenum dst() const;
+        gl::GLenum equation() const;
+
+        /**
+          * \brief Make this state current.
+          */
+        void apply() const;
+
+    private:
+        const bool m_enabled;
+        const gl::GLenum m_src, m_dst, m_equation;
+};
+
+/**
+  * \class DepthState
+  * \brief Immutable depth test configuration.
+  */
+class DepthState {
+    public:
+        /**
+          * \brief Constructor.
+          * \param test Enable the depth test
+          * \param write Enable writing to the depth buffer
+          * \param func Depth comparison function
+          */
+        explicit DepthState(bool test = true, bool write = true, gl::GLenum func = gl::GL_LESS);
+
+        /**
+          * \brief Return a state with the depth test disabled.
+          */
+        static DepthState disabled();
+        /**
+          * \brief Return a state that tests against the depth buffer but doesn't
+          * write to it, as used for transparent objects.
+          */
+        static DepthState readOnly();
+
+        bool test() const;
+        bool write() const;
+        gl::GLenum func() const;
+
+        /**
+          * \brief Make this state current.
+          */
+        void apply() const;
+
+    private:
+        const bool m_test, m_write;
+        const gl::GLenum m_func;
+};
+
+/**
+  * \class CullState
+  * \brief Immutable face culling configuration.
+  */
+class CullState {
+    public:
+        /**
+          * \brief Constructor.
+          * \param enabled Enable face culling
+          * \param face Faces to cull
+          * \param frontFace Winding order of the front faces
+          */
+        explicit CullState(bool enabled = false, gl::GLenum face = gl::GL_BACK,
+                           gl::GLenum frontFace = gl::GL_CCW);
+
+        /**
+          * \brief Return a state culling the back faces.
+          */
+        static CullState back();
+
+        bool enabled() const;
+        gl::GLenum face() const;
+        gl::GLenum frontFace() const;
+
+        /**
+          * \brief Make this state current.
+          */
+        void apply() const;
+
+    private:
+        const bool m_enabled;
+        const gl::GLenum m_face, m_frontFace;
+};
+
+/**
+  * \class PipelineState
+  * \brief Immutable set of a program and the blend, depth and cull states.
+  * Applying it only issues the GL calls for what differs from the current state.
+  */
+class PipelineState {
+    public:
+        /**
+          * \brief Constructor.
+          * \param program Program to use, if not null. The PipelineState doesn't
+          * take ownership of the program.
+          */
+        PipelineState(Program const* program, BlendState const& blend = BlendState(),
+                      DepthState const& depth = DepthState(), CullState const& cull = CullState());
+
+        Program const* program() const;
+        BlendState const& blend() const;
+        DepthState const& depth() const;
+        CullState const& cull() const;
+
+        /**
+          * \brief Make this state current.
+          */
+        void apply() const;
+
+    private:
+        Program const* const m_program;
+        const BlendState m_blend;
+        const DepthState m_depth;
+        const CullState m_cull;
+};
+
+/**
+  * \class GLState
+  * \brief Cache of the current GL bindings and render states.
+  *
+  * Every engine class binds its objects through GLState, which only issues the
+  * GL call when the binding changes. GL calls made directly, bypassing the
+  * cache, must be followed by a call to \ref invalidate.
+  * The cache tracks a single GL context.
+  */
+class GLState {
+    public:
+        /**
+          * \struct Counters
+          * \brief Number of state changing calls issued to GL and filtered out
+          * since the last call to \ref resetCounters.
+          */
+        struct Counters {
+            size_t issued;
+            size_t skipped;
+        };
+
+        /** \brief Equivalent to glUseProgram. */
+        static void useProgram(gl::GLuint program);
+        /** \brief Equivalent to glBindVertexArray. */
+        static void bindVertexArray(gl::GLuint vao);
+        /**
+          * \brief Equivalent to glBindBuffer.
+          * The GL_ELEMENT_ARRAY_BUFFER binding is part of the VAO state, so it
+          * is tracked separately for each VAO.
+          */
+        static void bindBuffer(gl::GLenum target, gl::GLuint buffer);
+        /** \brief Equivalent to glBindBufferBase. */
+        static void bindBufferBase(gl::GLenum target, gl::GLuint index, gl::GLuint buffer);
+        /** \brief Equivalent to glBindBufferRange. */
+        static void bindBufferRange(gl::GLenum target, gl::GLuint index, gl::GLuint buffer,
+                                    gl::GLintptr offset, gl::GLsizeiptr size);
+        /** \brief Equivalent to glActiveTexture(GL_TEXTURE0 + unit). */
+        static void activeTexture(unsigned int unit);
+        /** \brief Equivalent to glBindTexture, on the active texture unit. */
+        static void bindTexture(gl::GLenum target, gl::GLuint texture);
+        /** \brief Equivalent to glBindFramebuffer. */
+        static void bindFramebuffer(gl::GLenum target, gl::GLuint fbo);
+
+        /** \brief Make the blend state current. */
+        static void apply(BlendState const& state);
+        /** \brief Make the depth state current. */
+        static void apply(DepthState const& state);
+        /** \brief Make the cull state current. */
+        static void apply(CullState const& state);
+
+        /** \brief Must be called before deleting a program. */
+        static void programDeleted(gl::GLuint program);
+        /** \brief Must be called before deleting a VAO. */
+        static void vertexArrayDeleted(gl::GLuint vao);
+        /** \brief Must be called before deleting a buffer. */
+        static void bufferDeleted(gl::GLuint buffer);
+        /** \brief Must be called before deleting a texture. */
+        static void textureDeleted(gl::GLuint texture);
+        /** \brief Must be called before deleting a framebuffer. */
+        static void framebufferDeleted(gl::GLuint fbo);
+
+        /**
+          * \brief Forget the cached state, so that the next calls are issued
+          * unconditionally. Call this after making GL calls that bypass the
+          * cache, or when changing the current context.
+          */
+        static void invalidate();
+
+        /**
+          * \brief Return the call counters.
+          */
+        static Counters const& counters();
+
+        /**
+          * \brief Reset the call counters.
+          */
+        static void resetCounters();
+
+    private:
+        GLState() = delete;
+};
+
+} // namespace Engine
+
+#endif
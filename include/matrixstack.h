@@ -52,6 +52,14 @@ class MatrixStack : std::stack<glm::mat4> {
       */
     void pop();
 
+    /**
+      * \brief Return the matrix that \ref push would place on top of a stack
+      * whose current top matrix is \p parent.
+      * This lets flattened scene storage compute the same world transforms as
+      * a traversal through a MatrixStack without maintaining a stack.
+      */
+    static glm::mat4 compose(glm::mat4 const& parent, glm::mat4 const& m);
+
     private:
         glm::mat4 m_current;
 };
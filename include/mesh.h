@@ -13,12 +13,17 @@
 #include <glm/glm.hpp>
 
 #include "attribute.h"
+#include "bounds.h"
+#include "mesharena.h"
+#include "meshoptimizer.h"
 #include "program.h"
 
 namespace Engine {
 
 class DrawableNode;
+class InstancedNode;
 class Texture;
+class VAO;
 
 /**
   * \class Mesh
@@ -26,6 +31,33 @@ class Texture;
   */
 class Mesh {
     public:
+        /**
+          * \struct QuantisationError
+          * \brief Largest error introduced by the quantised attribute formats,
+          * see \ref MeshBuilder::quantise. 0 for the attributes stored as floats.
+          */
+        struct QuantisationError {
+            /** Distance between a position and its quantised value */
+            float position;
+            /** Angle between a normal and its quantised value, in degrees */
+            float normal;
+            /** Difference between a texture coordinate and its quantised value */
+            float uv;
+            /** Difference between a color component and its quantised value */
+            float color;
+        };
+
+        /**
+          * \struct VertexCacheReport
+          * \brief Vertex cache efficiency of the indices before and after the
+          * optimisations selected with \ref MeshBuilder::optimize. 0 when the
+          * indices weren't optimised.
+          */
+        struct VertexCacheReport {
+            VertexCacheStats before;
+            VertexCacheStats after;
+        };
+
         /**
           * \brief Destructor
           */
@@ -62,11 +94,21 @@ class Mesh {
         const char* name() const;
 
         /**
-          * \brief Return an Object that is an instance of the mesh.
+          * \brief Return an Object that is an instance of the mesh. Every
+          * instance shares the VAO of the mesh, whatever its program.
           * TODO : refactor this
           */
         DrawableNode* instantiate(glm::mat4 const& position, Program* p, Texture const* tex = nullptr,
                                   gl::GLenum primitiveMode = gl::GL_TRIANGLES) const;
+        /**
+          * \brief Return a node drawing many instances of the mesh in a single
+          * draw call. The program must have a mat4 "i_world" vertex attribute.
+          * The node owns a VAO of its own, holding the instance attributes.
+          * Not supported for meshes allocated in a MeshArena or with quantised
+          * positions.
+          */
+        InstancedNode* instantiateInstanced(glm::mat4 const& position, Program* p, Texture const* tex = nullptr,
+                                            gl::GLenum primitiveMode = gl::GL_TRIANGLES) const;
 
         /**
           * \brief Return the number of vertices in the mesh.
@@ -76,6 +118,61 @@ class Mesh {
           * \brief Return the number of faces in the mesh.
           */
         unsigned int numFaces() const;
+        /**
+          * \brief Return the number of buffers holding the vertex attributes.
+          */
+        size_t vertexBufferCount() const;
+        /**
+          * \brief Return the VAO mapping the mesh attributes to the engine
+          * attribute locations, created on first use and shared by every
+          * instance of the mesh.
+          */
+        VAO* vao() const;
+        /**
+          * \brief Enable or disable an attribute of the VAO of the mesh, for
+          * every instance of the mesh.
+          * Not supported for meshes allocated in a MeshArena, whose VAO is
+          * shared with the other meshes of the same vertex format.
+          * \param location Location of the attribute, such as
+          * \ref NormalAttribute.
+          */
+        void enable_attribute(unsigned int location, bool enable = true);
+        /**
+          * \brief Return the MeshArena holding the mesh geometry, if any.
+          */
+        MeshArena* arena() const;
+        /**
+          * \brief Return the size of the vertex attributes in GPU memory, in
+          * bytes.
+          */
+        size_t vertexBytes() const;
+        /**
+          * \brief Return the size of the indices in GPU memory, in bytes.
+          */
+        size_t indexBytes() const;
+        /**
+          * \brief Return the error introduced by the quantised attributes.
+          */
+        QuantisationError const& quantisationError() const;
+        /**
+          * \brief Return the transform from the stored positions to the mesh
+          * space, the identity unless the positions are quantised.
+          */
+        glm::mat4 const& positionTransform() const;
+        /**
+          * \brief Return the vertex cache efficiency of the indices before and
+          * after their optimisation.
+          */
+        VertexCacheReport const& vertexCacheReport() const;
+
+        /**
+          * \brief Return the axis-aligned bounding box of the mesh vertices.
+          */
+        AABB const& aabb() const;
+        /**
+          * \brief Return the bounding sphere of the mesh vertices.
+          */
+        BoundingSphere const& bounding_sphere() const;
 
         // TODO: move these out of here
         /**
@@ -90,6 +187,7 @@ class Mesh {
 
     protected:
         friend class MeshBuilder;
+        friend class MeshCache;
         /**
           * \brief Constructor.
           * \param name %Mesh name
@@ -98,14 +196,34 @@ class Mesh {
           * Mesh, so they can be free'd on destruction.
           * \param nVerts Number of vertices in the Mesh.
           * \param nIndices Number of indices in the Mesh, if indexed.
+          * \param aabb Bounding box of the vertices.
+          * \param sphere Bounding sphere of the vertices.
+          * \param arena MeshArena holding the geometry, if any.
+          * \param allocation Geometry of the mesh in the arena, released on
+          * destruction.
           */
         Mesh(std::string const& name, AttributeMap attribs, std::vector<std::unique_ptr<VBO>>&& resources,
-             unsigned int nVerts, unsigned int nIndices);
+             unsigned int nVerts, unsigned int nIndices, AABB const& aabb, BoundingSphere const& sphere,
+             MeshArena* arena = nullptr, MeshArena::Allocation* allocation = nullptr);
 
         std::string m_name;
         AttributeMap m_attribs;
         std::vector<std::unique_ptr<VBO>> m_resources;
         const unsigned int m_nVertices, m_nIndices;
+        AABB m_aabb;
+        BoundingSphere m_sphere;
+        MeshArena* m_arena;
+        MeshArena::Allocation* m_allocation;
+        size_t m_vertexBytes, m_indexBytes;
+        QuantisationError m_quantisationError;
+        glm::mat4 m_positionTransform;
+        VertexCacheReport m_vertexCacheReport;
+        /* VAO shared by the instances, see vao() */
+        mutable std::unique_ptr<VAO> m_vao;
+
+        /* Create a VAO mapping the mesh attributes to the engine attribute
+         * locations, with the index buffer bound */
+        VAO* createVAO() const;
 
         /* No copy */
         Mesh(Mesh const& other) = delete;
@@ -115,9 +233,61 @@ class Mesh {
 /**
   * \class MeshBuilder
   * \brief Mesh factory class.
+  * The vertex attributes are kept until \ref build_mesh, which uploads them
+  * in the selected VertexLayout.
   */
 class MeshBuilder {
     public:
+        /**
+          * \enum VertexLayout
+          * \brief How the vertex attributes are stored in buffers.
+          */
+        enum class VertexLayout {
+            /** Every attribute of a vertex next to each other in a single buffer */
+            Interleaved,
+            /** Positions in their own buffer, the other attributes interleaved
+             *  in a second one, so position-only passes fetch less memory */
+            PositionSeparate,
+            /** One buffer per attribute */
+            Separate
+        };
+
+        /**
+          * \enum Quantise
+          * \brief Vertex data to store in compressed formats.
+          */
+        enum class Quantise : unsigned int {
+            None = 0,
+            /** 16 bit normalised positions relative to the bounding box. The
+             *  decoding is applied with the world transform, see
+             *  \ref Mesh::positionTransform */
+            Positions = 1 << 0,
+            /** Normals packed in GL_INT_2_10_10_10_REV */
+            Normals = 1 << 1,
+            /** Half float texture coordinates */
+            UVs = 1 << 2,
+            /** RGBA8 colors */
+            Colors = 1 << 3,
+            /** 16 bit indices when the vertex count allows it */
+            Indices = 1 << 4,
+            All = (1 << 5) - 1
+        };
+
+        /**
+          * \enum Optimize
+          * \brief Reordering of the indices and vertices of indexed meshes.
+          */
+        enum class Optimize : unsigned int {
+            None = 0,
+            /** Reorder the triangles for the post-transform vertex cache */
+            VertexCache = 1 << 0,
+            /** Reorder clusters of triangles to draw the outer ones first */
+            Overdraw = 1 << 1,
+            /** Reorder the vertices in the order the triangles use them */
+            VertexFetch = 1 << 2,
+            All = (1 << 3) - 1
+        };
+
         /**
           * \brief Constructor
           */
@@ -127,26 +297,59 @@ class MeshBuilder {
           */
         virtual ~MeshBuilder();
 
+        /**
+          * \brief Select how the vertex attributes are stored, Interleaved by
+          * default.
+          */
+        MeshBuilder& layout(VertexLayout l);
+
+        /**
+          * \brief Allocate the mesh geometry in \p arena instead of in buffers
+          * of its own. The attributes are interleaved whatever the layout and
+          * the indices are stored as 32 bit integers.
+          */
+        MeshBuilder& arena(MeshArena* arena);
+
+        /**
+          * \brief Select the vertex data stored in compressed formats, none by
+          * default. Quantised meshes can't be allocated in a MeshArena.
+          */
+        MeshBuilder& quantise(Quantise q);
+
+        /**
+          * \brief Select the optimisations of the index buffer, none by
+          * default. They are skipped for meshes without indices.
+          */
+        MeshBuilder& optimize(Optimize o);
+
         /**
           * \brief Specify the Mesh vertices.
           */
-        MeshBuilder& vertices(std::vector<glm::vec3> const& verts);
+        MeshBuilder& vertices(std::vector<glm::vec3> verts);
         /**
           * \brief Specify the Mesh normals.
           */
-        MeshBuilder& normals(std::vector<glm::vec3> const& norms);
+        MeshBuilder& normals(std::vector<glm::vec3> norms);
         /**
           * \brief Specify the Mesh vertex colors.
           */
-        MeshBuilder& colors(std::vector<glm::vec4> const& cols);
+        MeshBuilder& colors(std::vector<glm::vec4> cols);
         /**
           * \brief Specify the Mesh 2D texture coordinates.
           */
         MeshBuilder& uvs(std::vector<glm::vec2> const& uvs);
+        /**
+          * \brief Specify the Mesh 2D texture coordinates, without copying them.
+          */
+        MeshBuilder& uvs(std::vector<glm::vec2>&& uvs);
         /**
           * \brief Specify the Mesh 3D texture coordinates.
           */
         MeshBuilder& uvs(std::vector<glm::vec3> const& uvs);
+        /**
+          * \brief Specify the Mesh 3D texture coordinates, without copying them.
+          */
+        MeshBuilder& uvs(std::vector<glm::vec3>&& uvs);
         /**
           * \brief Specify the Mesh indices.
           */
@@ -159,9 +362,32 @@ class MeshBuilder {
           * \brief Specify the Mesh indices.
           */
         MeshBuilder& faces(std::vector<unsigned int>&& indices);
+        /**
+          * \brief Specify the Mesh indices, stored as \p type in the index
+          * buffer.
+          * \param indices Indices, which must all fit in \p type
+          * \param type Uchar, Ushort or Uint
+          */
+        MeshBuilder& faces(std::vector<unsigned int>&& indices, AttributeArray::Type type);
 
         /**
-          * \brief Build the mesh.
+          * \brief Validate the attributes, optimise the indices and quantise
+          * the attributes: everything \ref build_mesh does but the uploads.
+          * It doesn't use OpenGL, so it can run on any thread, for instance
+          * to convert many meshes in parallel. The attributes must not be
+          * changed afterwards.
+          */
+        MeshBuilder& prepare();
+
+        /**
+          * \brief Return the size of the buffers \ref build_mesh will upload,
+          * in bytes. Only valid once the builder is prepared.
+          */
+        size_t uploadSize() const;
+
+        /**
+          * \brief Build the mesh, calling \ref prepare first unless it was
+          * already called. Must be called on the thread of the OpenGL context.
           */
         std::unique_ptr<Mesh> build_mesh();
 
@@ -172,14 +398,73 @@ class MeshBuilder {
         MeshBuilder& operator=(MeshBuilder&& other) = delete;
 
     private:
+        /* Attribute array to upload, from the builder arrays or quantised */
+        struct Stream {
+            AttributeArray::Kind kind;
+            const char* data;
+            /* Size of the attribute of a vertex, in bytes */
+            size_t size;
+            int nComponents;
+            AttributeArray::Type type;
+            bool normalize;
+        };
+
         std::string m_meshName;
         AttributeMap m_meshAttribs;
         std::vector<std::unique_ptr<VBO>> m_resources;
         unsigned int m_nVertices, m_nNormals, m_nColors, m_nUVs, m_nIndices;
+        AABB m_aabb;
+        BoundingSphere m_sphere;
+        VertexLayout m_layout;
+        std::vector<glm::vec3> m_positions;
+        std::vector<glm::vec3> m_normals;
+        std::vector<glm::vec4> m_colors;
+        /* Texture coordinates, in the vector matching m_uvComponents */
+        std::vector<glm::vec2> m_uvs2D;
+        std::vector<glm::vec3> m_uvs3D;
+        int m_uvComponents;
+        std::vector<unsigned int> m_indices;
+        AttributeArray::Type m_indexType;
+        MeshArena* m_arena;
+        MeshArena::Allocation* m_allocation;
+        Quantise m_quantise;
+        Mesh::QuantisationError m_error;
+        glm::mat4 m_positionTransform;
+        size_t m_vertexBytes, m_indexBytes;
+        Optimize m_optimize;
+        Mesh::VertexCacheReport m_vertexCacheReport;
+        /* Quantised attributes, referenced by m_streams */
+        std::vector<char> m_packedPositions, m_packedNormals, m_packedColors, m_packedUVs;
+        std::vector<Stream> m_streams;
+        bool m_prepared;
 
         void validateMesh() const;
+        /* Texture coordinates, m_uvComponents floats per vertex */
+        const float* uvData() const;
+        /* Reorder the indices and vertices */
+        void optimizeIndices();
+        /* Quantise the vertex attributes and list the streams to upload */
+        void prepareStreams();
+        /* Upload the vertex attributes in the selected layout */
+        void uploadVertices();
+        /* Upload the indices in the type selected by prepare */
+        void uploadIndices();
+        /* Size of an index of m_indexType, in bytes */
+        size_t indexSize() const;
 };
 
+namespace traits {
+    template <>
+    struct enable_bitmask_operators<MeshBuilder::Quantise> {
+        static bool constexpr enable = true;
+    };
+
+    template <>
+    struct enable_bitmask_operators<MeshBuilder::Optimize> {
+        static bool constexpr enable = true;
+    };
+}
+
 } // namespace Engine
 
 #endif
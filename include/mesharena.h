@@ -0,0 +1,225 @@
+/**
+  * \file include/mesharena.h
+  * \brief Contains the definition of the MeshArena class.
+  * \author R.Chavignat
+  */
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include "vao.h"
+#include "vbo.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <glbinding/gl33core/gl.h>
+
+namespace Engine {
+
+/**
+  * \class RangeAllocator
+  * \brief First-fit allocator of ranges in [0, capacity), keeping the free
+  * ranges in a free list sorted by offset and merging neighbouring ones.
+  */
+class RangeAllocator {
+    public:
+        /** \brief Returned by \ref allocate when no free range is large enough. */
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        /**
+          * \brief Constructor.
+          * \param capacity Size of the managed space.
+          */
+        explicit RangeAllocator(size_t capacity = 0);
+
+        /**
+          * \brief Allocate a range and return its offset, or \ref npos.
+          * \param size Size of the range.
+          * \param alignment The offset is a multiple of \p alignment. The
+          * padding before it stays free.
+          */
+        size_t allocate(size_t size, size_t alignment = 1);
+
+        /**
+          * \brief Return a range to the free list.
+          */
+        void release(size_t offset, size_t size);
+
+        /**
+          * \brief Extend the managed space to \p capacity.
+          */
+        void grow(size_t capacity);
+
+        /**
+          * \brief Mark [0, used) as allocated and the rest of the space as free,
+          * after the allocations were packed at the start.
+          */
+        void reset(size_t used);
+
+        size_t capacity() const;
+        size_t used() const;
+
+        /**
+          * \brief Return the size of the largest free range.
+          */
+        size_t largestFree() const;
+
+    private:
+        size_t m_capacity;
+        size_t m_used;
+        /* Free ranges, offset to size */
+        std::map<size_t, size_t> m_free;
+};
+
+/**
+  * \class MeshArena
+  * \brief Sub-allocates the geometry of many meshes out of a few large buffers.
+  *
+  * Meshes sharing a vertex format share an interleaved vertex buffer and a
+  * VAO, and every index is stored in a single index buffer as 32 bit
+  * indices relative to the first vertex of its mesh. Meshes are drawn with
+  * glDrawElementsBaseVertex, so that the RenderQueue draws meshes of the same
+  * format one after the other without any buffer or VAO change.
+  *
+  * Buffers grow when full, keeping their GL names so that the VAOs remain
+  * valid. \ref compact packs the allocations at the start of the buffers once
+  * freed meshes leave holes.
+  */
+class MeshArena {
+    public:
+        /**
+          * \struct VertexFormat
+          * \brief Number of float components of each attribute, 0 when the
+          * attribute is missing. Positions always have 3.
+          */
+        struct VertexFormat {
+            int normals;
+            int colors;
+            int uvs;
+
+            /** \brief Size of an interleaved vertex, in bytes. */
+            size_t stride() const;
+            bool operator==(VertexFormat const& other) const;
+            /**
+              * \brief Create a VAO reading interleaved vertices of this format.
+              * The caller owns the returned VAO.
+              * \param vertices VBO containing the vertices
+              * \param indices VBO containing the indices
+              */
+            VAO* createVAO(VBO const& vertices, VBO const& indices) const;
+        };
+
+        /**
+          * \class Allocation
+          * \brief Geometry of a mesh in the arena. Its ranges move when the
+          * arena is compacted, so they are read at each draw.
+          */
+        class Allocation {
+            friend class MeshArena;
+            public:
+                unsigned int baseVertex() const;
+                unsigned int vertexCount() const;
+                unsigned int firstIndex() const;
+                unsigned int indexCount() const;
+
+            private:
+                Allocation() = default;
+
+                size_t m_pool;
+                size_t m_slot;
+                unsigned int m_baseVertex, m_nVertices;
+                unsigned int m_firstIndex, m_nIndices;
+        };
+
+        /**
+          * \brief Constructor. Requires a current GL context.
+          * \param vertices Initial capacity of each vertex buffer, in vertices.
+          * \param indices Initial capacity of the index buffer, in indices.
+          */
+        explicit MeshArena(size_t vertices = 1 << 16, size_t indices = 1 << 18);
+
+        /**
+          * \brief Destructor. The meshes allocated in the arena must be
+          * destroyed first.
+          */
+        ~MeshArena();
+
+        MeshArena(MeshArena const& other) = delete;
+        MeshArena(MeshArena&& other) = delete;
+        MeshArena& operator=(MeshArena const& other) = delete;
+        MeshArena& operator=(MeshArena&& other) = delete;
+
+        /**
+          * \brief Copy the geometry of a mesh to the arena.
+          * \param format Vertex format
+          * \param vertices Interleaved vertices, format.stride() bytes each
+          * \param nVertices Number of vertices
+          * \param indices Vertex indices, may be empty
+          */
+        Allocation* allocate(VertexFormat const& format, std::vector<char> const& vertices,
+                             unsigned int nVertices, std::vector<unsigned int> const& indices);
+
+        /**
+          * \brief Free the geometry of a mesh.
+          */
+        void release(Allocation* allocation);
+
+        /**
+          * \brief Move the allocations to the start of the buffers, removing
+          * the holes left by released meshes.
+          */
+        void compact();
+
+        /**
+          * \brief Return the VAO mapping the vertex buffer of an allocation to
+          * the engine attribute locations. It is shared by every allocation of
+          * the same vertex format and owned by the arena.
+          */
+        VAO* vao(Allocation const& allocation);
+
+        /**
+          * \brief Return the vertex buffer holding an allocation.
+          */
+        VBO const& vertexBuffer(Allocation const& allocation) const;
+
+        /**
+          * \brief Return the index buffer.
+          */
+        VBO const& indexBuffer() const;
+
+        /**
+          * \brief Return the number of buffer objects used by the arena.
+          */
+        size_t bufferCount() const;
+
+        /**
+          * \brief Return the number of live allocations.
+          */
+        size_t size() const;
+
+    private:
+        /* Vertex buffer shared by the meshes of a vertex format */
+        struct Pool {
+            VertexFormat format;
+            std::unique_ptr<VBO> vbo;
+            RangeAllocator vertices;
+            /* Created on first use */
+            std::unique_ptr<VAO> vao;
+        };
+
+        std::vector<Pool> m_pools;
+        VBO m_indices;
+        RangeAllocator m_indexRanges;
+        size_t m_initialVertices;
+        std::vector<std::unique_ptr<Allocation>> m_allocations;
+
+        size_t pool(VertexFormat const& format);
+        /* Reallocate a buffer, keeping its name and its first size bytes */
+        static void resize(VBO& vbo, size_t size, size_t capacity);
+        /* Allocate a range, growing the buffer if needed */
+        static size_t allocateRange(VBO& vbo, RangeAllocator& ranges, size_t size, size_t elementSize);
+};
+
+} // namespace Engine
+
+#endif
@@ -0,0 +1,127 @@
+/**
+  * \file include/meshcache.h
+  * \brief Contains the definition of the MeshCache class.
+  * \author R.Chavignat
+  */
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "sceneimporter.h"
+
+namespace Engine {
+
+/**
+  * \class MeshCache
+  * \brief On-disk cache of the meshes imported by the SceneImporter.
+  *
+  * The vertex and index buffers of the meshes of a file are stored as they
+  * are in GPU memory, in a binary file named after a hash of the file
+  * content, the import options and \ref FormatVersion. The next loads of the
+  * same content with the same options skip assimp and upload the buffers
+  * straight from a mapping of the cache file.
+  */
+class MeshCache {
+    public:
+        /**
+          * \brief Version of the cache file format, part of the cache key.
+          * To be incremented whenever the file format or the output of the
+          * MeshBuilder changes, so that the stale entries are rebuilt.
+          */
+        static constexpr std::uint32_t FormatVersion = 2;
+
+        /**
+          * \brief Constructor.
+          * \param directory Directory of the cache files, which must exist.
+          */
+        MeshCache(std::string const& directory);
+
+        /**
+          * \brief Destructor.
+          */
+        virtual ~MeshCache();
+
+        /**
+          * \brief Load the meshes of a file, from the cache if the file was
+          * already loaded with the same options. Otherwise the file is
+          * imported and the meshes are added to the cache.
+          *
+          * \param file Path of the file
+          * \param pp Postprocessing flags, see \ref SceneImporter::readFile
+          * \param layout Storage of the vertex attributes
+          * \param quantise Vertex data to store in compressed formats
+          * \param optimize Reordering of the indices and vertices
+          *
+          * \return The meshes of the file, in the order of
+          * \ref SceneImporter::meshes.
+          */
+        std::vector<std::unique_ptr<Mesh>> load(std::string const& file,
+                                                SceneImporter::PostProcess pp = SceneImporter::PostProcess::None,
+                                                MeshBuilder::VertexLayout layout = MeshBuilder::VertexLayout::Interleaved,
+                                                MeshBuilder::Quantise quantise = MeshBuilder::Quantise::None,
+                                                MeshBuilder::Optimize optimize = MeshBuilder::Optimize::None);
+
+        /**
+          * \brief Return the path of the cache file of a file loaded with the
+          * given options. The cache file may not exist yet.
+          */
+        std::string entry(std::string const& file,
+                          SceneImporter::PostProcess pp = SceneImporter::PostProcess::None,
+                          MeshBuilder::VertexLayout layout = MeshBuilder::VertexLayout::Interleaved,
+                          MeshBuilder::Quantise quantise = MeshBuilder::Quantise::None,
+                          MeshBuilder::Optimize optimize = MeshBuilder::Optimize::None) const;
+
+        /**
+          * \brief Return the number of loads served from the cache.
+          */
+        size_t hits() const;
+        /**
+          * \brief Return the number of loads that imported the file.
+          */
+        size_t misses() const;
+
+        /**
+          * \brief 64 bit hash of a block of memory, over 8 byte words mixed
+          * by MurmurHash3 rounds.
+          * \param data Start of the block
+          * \param size Size of the block, in bytes
+          * \param seed Hash to continue, to hash several blocks
+          */
+        static std::uint64_t hash(const void* data, size_t size, std::uint64_t seed = 0);
+
+        /* No copy */
+        MeshCache(MeshCache const& other) = delete;
+        MeshCache& operator=(MeshCache const& other) = delete;
+
+    private:
+        std::string m_directory;
+        size_t m_hits;
+        size_t m_misses;
+
+        /* Identity of a source file loaded with given options. The hash
+         * names the entry, the check and the size are stored in the entry and
+         * compared before trusting it, so that a collision of the hash alone
+         * doesn't load the meshes of another file. */
+        struct Key {
+            std::uint64_t hash;
+            /* Hash of the same data by an independent function */
+            std::uint64_t check;
+            std::uint64_t size;
+        };
+
+        Key key(std::string const& file, SceneImporter::PostProcess pp, MeshBuilder::VertexLayout layout,
+                MeshBuilder::Quantise quantise, MeshBuilder::Optimize optimize) const;
+        std::string path(Key const& key) const;
+        /* Return false if the entry doesn't exist or isn't valid */
+        bool read(std::string const& path, Key const& key, std::vector<std::unique_ptr<Mesh>>& meshes) const;
+        void write(std::string const& path, Key const& key, std::vector<std::unique_ptr<Mesh>> const& meshes) const;
+};
+
+} // namespace Engine
+
+#endif
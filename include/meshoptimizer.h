@@ -0,0 +1,76 @@
+/**
+  * \file include/meshoptimizer.h
+  * \brief Reordering of triangle lists for the post-transform vertex cache,
+  * overdraw and vertex fetch.
+  * \author R.Chavignat
+  */
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Engine {
+
+/**
+  * \struct VertexCacheStats
+  * \brief Efficiency of a triangle list with a FIFO post-transform cache.
+  */
+struct VertexCacheStats {
+    /** Average cache miss ratio: vertex shader invocations per triangle,
+     *  between 0.5 and 3 */
+    float acmr;
+    /** Average transform to vertex ratio: vertex shader invocations per
+     *  referenced vertex, 1 at best */
+    float atvr;
+};
+
+/**
+  * \brief Simulate a FIFO post-transform cache of \p cacheSize entries over a
+  * triangle list.
+  */
+VertexCacheStats analyzeVertexCache(std::vector<unsigned int> const& indices, size_t nVertices,
+                                    size_t cacheSize = 16);
+
+/**
+  * \brief Reorder the triangles of a triangle list to reuse the vertices
+  * that are still in the post-transform cache, with Forsyth's linear-speed
+  * algorithm.
+  */
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t nVertices);
+
+/**
+  * \brief Reorder the clusters of a cache-optimised triangle list so that the
+  * triangles facing away from the mesh center are drawn first, reducing
+  * overdraw from most viewpoints.
+  *
+  * The list is split where the cache is flushed, and where the ACMR of the
+  * current cluster is under \p threshold times the ACMR of the mesh, so that
+  * the ACMR stays within about \p threshold of the input.
+  */
+void optimizeOverdraw(std::vector<unsigned int>& indices, std::vector<glm::vec3> const& positions,
+                      float threshold = 1.05f);
+
+/**
+  * \brief Renumber the vertices in the order the triangles first use them,
+  * so that vertex fetches go through memory linearly. The vertices that no
+  * triangle uses are moved to the end.
+  *
+  * \return The new index of each vertex, to reorder the vertex attributes
+  * with \ref remapVertices.
+  */
+std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t nVertices);
+
+/**
+  * \brief Move the vertex attributes to the positions returned by
+  * \ref optimizeVertexFetch.
+  */
+template <class T>
+void remapVertices(std::vector<T>& attribute, std::vector<unsigned int> const& remap, size_t nComponents = 1);
+
+#include "meshoptimizer.inl"
+
+} // namespace Engine
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef MESH_OPTIMIZER_H
+#include "meshoptimizer.h"
+#endif
+
+template <class T>
+void remapVertices(std::vector<T>& attribute, std::vector<unsigned int> const& remap, size_t nComponents) {
+    std::vector<T> remapped(attribute.size());
+    for(size_t i = 0 ; i != remap.size() ; ++i) {
+        for(size_t c = 0 ; c != nComponents ; ++c) {
+            remapped[remap[i] * nComponents + c] = attribute[i * nComponents + c];
+        }
+    }
+    attribute = std::move(remapped);
+}
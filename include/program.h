@@ -59,6 +59,8 @@ class ProgramHandle {
 
 class Program;
 class ProgramBuilder;
+template <class T>
+class Uniform;
 
 /**
   * \class ShaderManager
@@ -126,9 +128,10 @@ class UniformBase {
 
     protected:
         /**
-          * \brief Upload the uniform to the GPU.
+          * \brief Upload the uniform to the GPU if it was modified.
+          * \return true if the value was uploaded.
           */
-        virtual void upload() = 0;
+        virtual bool upload() = 0;
 
         /**
           * \brief Default constructor
@@ -143,10 +146,39 @@ class UniformBase {
         /** \brief Uniform name */
         std::string m_name;
 
-        /** \brief Was uniform value modified since last GPU upload */
+        /** \brief Does the GPU hold the current value of the uniform */
         bool m_clean;
 };
 
+/**
+  * \class UniformHandle
+  * \brief Typed reference to a uniform of a Program, resolved once so that
+  * accessing the uniform doesn't involve any name lookup or cast.
+  * A handle is an index in the uniforms registered to a ProgramBuilder, it is
+  * valid for every Program built by that builder.
+  * \tparam T Uniform type
+  */
+template <class T>
+class UniformHandle {
+    friend class Program;
+    friend class ProgramBuilder;
+    public:
+        /**
+          * \brief Default constructor. Construct an invalid handle.
+          */
+        UniformHandle();
+
+        /**
+          * \brief Check if the handle refers to a uniform.
+          */
+        explicit operator bool() const;
+
+    private:
+        explicit UniformHandle(int index);
+
+        int m_index;
+};
+
 /**
   * \class Program
   * \brief Class for GPU programs
@@ -154,6 +186,16 @@ class UniformBase {
 class Program {
     friend class ProgramBuilder;
     public:
+        /**
+          * \struct UniformCounters
+          * \brief Number of uniforms uploaded and skipped because unchanged by
+          * \ref uploadUniforms since the last call to \ref resetUniformCounters.
+          */
+        struct UniformCounters {
+            size_t uploaded;
+            size_t skipped;
+        };
+
         Program();
 
         /**
@@ -209,10 +251,47 @@ class Program {
         UniformBase* getUniform(std::string const& name);
 
         /**
-          * \brief Upload uniforms to GPU
+          * \brief Return a handle to a uniform, invalid if the program has no
+          * uniform of that name and type. Resolve handles once, then access the
+          * uniform with \ref uniform.
+          */
+        template <class T>
+        UniformHandle<T> uniformHandle(std::string const& name) const;
+
+        /**
+          * \brief Return the uniform referred to by a valid handle.
+          */
+        template <class T>
+        Uniform<T>& uniform(UniformHandle<T> const& handle);
+
+        /**
+          * \brief Check if the program declares the per-object uniform block,
+          * see \ref ObjectBlock.
+          */
+        bool usesObjectBlock() const;
+
+        /**
+          * \brief Upload uniforms to GPU. The program is left current.
           */
         void uploadUniforms();
 
+        /**
+          * \brief Mark every uniform as modified so that the next call to
+          * \ref uploadUniforms uploads them all. Must be called when the program
+          * is relinked, since linking resets the uniform values.
+          */
+        void invalidateUniforms();
+
+        /**
+          * \brief Return the uniform upload counters.
+          */
+        UniformCounters const& uniformCounters() const;
+
+        /**
+          * \brief Reset the uniform upload counters, usually once per frame.
+          */
+        void resetUniformCounters();
+
         /**
           * \brief Check if the program is currently in use
           */
@@ -244,6 +323,8 @@ class Program {
 
         std::shared_ptr<ProgramHandle> m_id;
         std::vector<UniformBase*> m_uniforms;
+        UniformCounters m_uniformCounters;
+        bool m_objectBlock;
         static const Program* s_current;
 };
 
@@ -272,11 +353,17 @@ class Uniform : public UniformBase {
         virtual ~Uniform();
 
         /**
-          * \brief Set the uniform value, do not upload to the GPU.
+          * \brief Set the uniform value, do not upload to the GPU. The uniform
+          * is only marked as modified if the value changes.
           * \param value New value.
           */
         void set(T const& value);
 
+        /**
+          * \brief Return the uniform value.
+          */
+        T const& get() const;
+
     private:
         T m_value;
 
@@ -288,9 +375,10 @@ class Uniform : public UniformBase {
         Uniform(gl::GLint location, std::string const& name);
 
         /**
-          * \brief Upload uniform to GPU. Program must be in use.
+          * \brief Upload uniform to GPU if it was modified. Program must be in
+          * use.
           */
-        virtual void upload();
+        virtual bool upload();
 };
 
 /**
@@ -343,11 +431,33 @@ class ProgramBuilder {
          */
         ProgramBuilder& geometryShader(std::string const& file);
 
+        /**
+         * @brief Attach a shader compiled from source code in memory, for
+         * instance read on another thread. The shader isn't cached by the
+         * ShaderManager.
+         *
+         * @param type GL_VERTEX_SHADER, GL_FRAGMENT_SHADER or
+         * GL_GEOMETRY_SHADER
+         * @param source GLSL shader code
+         * @param name Name of the shader in the compilation errors
+         *
+         * @return Reference to the ProgramBuilder
+         */
+        ProgramBuilder& shaderSource(gl::GLenum type, std::string const& source, std::string const& name);
+
         /**
           * \brief Register a uniform
           */
         ProgramBuilder& uniform(std::string const& name, UniformType t);
 
+        /**
+          * \brief Register a uniform and set \p handle to refer to it in the
+          * built programs.
+          * \tparam T Uniform type, one of the types of \ref UniformType.
+          */
+        template <class T>
+        ProgramBuilder& uniform(std::string const& name, UniformHandle<T>& handle);
+
         /**
           * \brief Link the program and return the Program object
           */
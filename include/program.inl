@@ -7,10 +7,17 @@ Uniform<T>::~Uniform() { }
 
 template <class T>
 void Uniform<T>::set(T const& value) {
+    if(m_clean && m_value == value)
+        return;
     m_value = value;
     m_clean = false;
 }
 
+template <class T>
+T const& Uniform<T>::get() const {
+    return m_value;
+}
+
 template <class T>
 Uniform<T>::Uniform(gl::GLint location, std::string const& name) :
     UniformBase(location, name),
@@ -18,8 +25,82 @@ Uniform<T>::Uniform(gl::GLint location, std::string const& name) :
 { }
 
 template <class T>
-void Uniform<T>::upload() {
-    if(!m_clean) {
-        upload_uniform<T>(m_location, m_value);
+bool Uniform<T>::upload() {
+    // Uniforms not found in the program are never uploaded
+    if(m_clean || m_location == -1)
+        return false;
+    upload_uniform<T>(m_location, m_value);
+    m_clean = true;
+    return true;
+}
+
+template <class T>
+UniformHandle<T>::UniformHandle() :
+    m_index(-1)
+{ }
+
+template <class T>
+UniformHandle<T>::UniformHandle(int index) :
+    m_index(index)
+{ }
+
+template <class T>
+UniformHandle<T>::operator bool() const {
+    return m_index != -1;
+}
+
+template <class T>
+UniformHandle<T> Program::uniformHandle(std::string const& name) const {
+    for(size_t i = 0 ; i != m_uniforms.size() ; ++i) {
+        if(m_uniforms[i]->name() == name && dynamic_cast<Uniform<T>*>(m_uniforms[i]))
+            return UniformHandle<T>(static_cast<int>(i));
     }
+    return UniformHandle<T>();
+}
+
+template <class T>
+Uniform<T>& Program::uniform(UniformHandle<T> const& handle) {
+    // The type was checked when the handle was resolved
+    return *static_cast<Uniform<T>*>(m_uniforms[static_cast<size_t>(handle.m_index)]);
+}
+
+namespace traits {
+    /**
+     * @brief Meta-function returning the ProgramBuilder::UniformType of a type.
+     */
+    template <class T>
+    struct uniform_type;
+
+    #ifndef DOX_SKIP_BLOCK
+    template <>
+    struct uniform_type<glm::vec3> {
+        static constexpr ProgramBuilder::UniformType value = ProgramBuilder::Vec3;
+    };
+
+    template <>
+    struct uniform_type<glm::mat3> {
+        static constexpr ProgramBuilder::UniformType value = ProgramBuilder::Mat3;
+    };
+
+    template <>
+    struct uniform_type<glm::mat4> {
+        static constexpr ProgramBuilder::UniformType value = ProgramBuilder::Mat4;
+    };
+
+    template <>
+    struct uniform_type<int> {
+        static constexpr ProgramBuilder::UniformType value = ProgramBuilder::Int;
+    };
+
+    template <>
+    struct uniform_type<float> {
+        static constexpr ProgramBuilder::UniformType value = ProgramBuilder::Float;
+    };
+    #endif // DOX_SKIP_BLOCK
+} // namespace traits
+
+template <class T>
+ProgramBuilder& ProgramBuilder::uniform(std::string const& name, UniformHandle<T>& handle) {
+    handle = UniformHandle<T>(static_cast<int>(m_uniforms.size()));
+    return uniform(name, traits::uniform_type<T>::value);
 }
@@ -0,0 +1,239 @@
+/**
+  * \file include/renderqueue.h
+  * \brief Contains the definition of the RenderQueue class.
+  * \author R.Chavignat
+  */
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "uniformbuffers.h"
+#include "vbo.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Engine {
+
+class DrawableNode;
+
+/**
+  * \class RenderQueue
+  * \brief Sorts draw calls to minimize the GL state changes between them.
+  *
+  * Every draw call is given a 64-bit sort key built from its render pass,
+  * program, texture, VAO and view depth. Keys are radix sorted before
+  * submission, and the program, VAO and texture are only bound when they
+  * differ from the previous draw call.
+  * Opaque draw calls are grouped by state then sorted front-to-back within a
+  * group; transparent draw calls are sorted back-to-front first.
+  * When object uniforms are enabled, the world transforms of the draw calls
+  * whose program declares the per-object uniform block are written to an
+  * ObjectBuffer, uploaded once per submit.
+  * Consecutive draw calls of ArenaObject nodes sharing their program, VAO and
+  * texture, and not depending on any per-node uniform, are merged into a
+  * single multi-draw call, see \ref set_multi_draw.
+  */
+class RenderQueue {
+    public:
+        /**
+          * \enum Pass
+          * \brief Render passes, in submission order.
+          */
+        enum class Pass : std::uint8_t {
+            Opaque = 0,
+            Transparent = 1
+        };
+
+        /**
+          * \enum MultiDraw
+          * \brief How merged draw calls are issued.
+          */
+        enum class MultiDraw {
+            /** Don't merge draw calls */
+            Off,
+            /** glMultiDrawElementsBaseVertex, core since GL 3.2 */
+            BaseVertex,
+            /** glMultiDrawElementsIndirect with a CPU-filled indirect buffer,
+             *  requires ARB_multi_draw_indirect */
+            Indirect
+        };
+
+        /**
+          * \struct Stats
+          * \brief State changes and draw calls issued by the last \ref submit.
+          * Merged draw calls count as a single draw call, \ref merged is the
+          * number of queued draw calls they replaced.
+          */
+        struct Stats {
+            size_t programBinds;
+            size_t textureBinds;
+            size_t vaoBinds;
+            size_t drawCalls;
+            size_t merged;
+        };
+
+        /**
+          * \brief Constructor. Construct an empty queue.
+          */
+        RenderQueue();
+
+        /**
+          * \brief Destructor.
+          */
+        ~RenderQueue();
+
+        /**
+          * \brief Remove every draw call from the queue.
+          */
+        void clear();
+
+        /**
+          * \brief Queue a draw call.
+          * \param node Node to draw.
+          * \param world World transformation of the node. Must stay valid until
+          * the queue is submitted.
+          * \param depth Distance from the camera to the node, in view space.
+          */
+        void push(DrawableNode* node, glm::mat4 const* world, float depth);
+
+        /**
+          * \brief Return the number of queued draw calls.
+          */
+        size_t size() const;
+
+        /**
+          * \brief Enable or disable sorting. When sorting is disabled, draw calls
+          * are submitted in the order they were queued and each node binds its
+          * whole state, which is how the SceneGraph rendered without a queue.
+          */
+        void set_sorting(bool enable);
+
+        /**
+          * \brief Return true if sorting is enabled.
+          */
+        bool sorting() const;
+
+        /**
+          * \brief Enable or disable the per-object uniform buffer. The buffer
+          * is only used by the draw calls whose program declares the per-object
+          * uniform block, see \ref Program::usesObjectBlock.
+          */
+        void set_object_uniforms(bool enable);
+
+        /**
+          * \brief Return true if the per-object uniform buffer is enabled.
+          */
+        bool objectUniforms() const;
+
+        /**
+          * \brief Select how consecutive draw calls sharing their state are
+          * merged, BaseVertex by default. Indirect falls back to BaseVertex if
+          * the current context doesn't advertise ARB_multi_draw_indirect.
+          * Draw calls are only merged when sorting is enabled.
+          */
+        void set_multi_draw(MultiDraw mode);
+
+        /**
+          * \brief Return how draw calls are merged.
+          */
+        MultiDraw multiDraw() const;
+
+        /**
+          * \brief Check if the current context advertises
+          * ARB_multi_draw_indirect.
+          */
+        static bool indirectSupported();
+
+        /**
+          * \brief Sort the queued draw calls by key.
+          */
+        void sort();
+
+        /**
+          * \brief Issue the queued draw calls, sorting them first if sorting is
+          * enabled. The GL program, VAO and texture of the last draw call are
+          * left bound.
+          */
+        void submit();
+
+        /**
+          * \brief Return the statistics of the last \ref submit.
+          */
+        Stats const& stats() const;
+
+        /**
+          * \brief Build a sort key.
+          * \param pass Render pass.
+          * \param program Program index.
+          * \param texture Texture index.
+          * \param vao VAO index.
+          * \param depth View-space distance to the camera. Negative values are
+          * clamped to 0.
+          */
+        static std::uint64_t makeKey(Pass pass, std::uint32_t program, std::uint32_t texture,
+                                     std::uint32_t vao, float depth);
+
+        /**
+          * \brief Sort 64-bit keys in ascending order with an LSD radix sort,
+          * permuting the values in the same way.
+          * \param keys Keys to sort.
+          * \param values Values associated to the keys.
+          * \param tmpKeys Scratch buffer, resized as needed.
+          * \param tmpValues Scratch buffer, resized as needed.
+          */
+        static void radix_sort(std::vector<std::uint64_t>& keys, std::vector<std::uint32_t>& values,
+                               std::vector<std::uint64_t>& tmpKeys, std::vector<std::uint32_t>& tmpValues);
+
+    private:
+        struct Item {
+            DrawableNode* node;
+            glm::mat4 const* world;
+        };
+
+        std::vector<Item> m_items;
+        std::vector<std::uint64_t> m_keys;
+        std::vector<std::uint64_t> m_sortedKeys;
+        std::vector<std::uint32_t> m_order;
+        std::vector<std::uint64_t> m_tmpKeys;
+        std::vector<std::uint32_t> m_tmpOrder;
+        /* Small, stable indices for the resources, in order of first use, so
+         * that they fit in the sort key whatever their GL names are. Reset by
+         * clear() once they outgrow the key fields. */
+        std::unordered_map<const void*, std::uint32_t> m_programIds;
+        std::unordered_map<const void*, std::uint32_t> m_textureIds;
+        std::unordered_map<const void*, std::uint32_t> m_vaoIds;
+        bool m_sorting;
+        bool m_sorted;
+        Stats m_stats;
+        bool m_objectUniforms;
+        ObjectBuffer m_objects;
+        /* Slot of each draw call in m_objects, NoSlot if it doesn't use it */
+        std::vector<std::uint32_t> m_slots;
+        static constexpr std::uint32_t NoSlot = ~std::uint32_t(0);
+        MultiDraw m_multiDraw;
+        /* Arguments of the merged draw calls */
+        std::vector<gl::GLsizei> m_counts;
+        std::vector<const void*> m_offsets;
+        std::vector<gl::GLint> m_baseVertices;
+        /* Indirect draw commands, in the DrawElementsIndirectCommand layout */
+        std::vector<gl::GLuint> m_commands;
+        std::unique_ptr<VBO> m_indirect;
+
+        /* Write the object blocks in submission order and upload them */
+        void uploadObjects();
+        /* Bind the object block of a draw call, if it has one */
+        void bindObject(std::uint32_t i);
+        /* Return the number of draw calls from m_order[k] that can be merged */
+        size_t mergeable(size_t k) const;
+        /* Issue the draw calls m_order[k, k + n) in a single multi-draw call */
+        void multiDraw(size_t k, size_t n);
+
+        static std::uint32_t resourceId(std::unordered_map<const void*, std::uint32_t>& ids, const void* p);
+};
+
+} // namespace Engine
+
+#endif
@@ -12,6 +12,8 @@
 #define SCENEGRAPH_H
 
 #include <map>
+#include <future>
+#include <memory>
 #include <glbinding/gl33core/gl.h>
 #include "glm/glm.hpp"
 
@@ -19,11 +21,21 @@
 #include "vao.h"
 #include "vbo.h"
 #include "matrixstack.h"
+#include "scenestorage.h"
+#include "threadpool.h"
+#include "renderqueue.h"
+#include "bounds.h"
+#include "bvh.h"
+#include "uniformbuffers.h"
 #include "texture.h"
 #include "mesh.h"
+#include "streambuffer.h"
 
 namespace Engine {
 
+class SceneGraph;
+class DrawableNode;
+
 /** \class Node
  *  \brief Base class for nodes in a SceneGraph
            These nodes don't contain geometry themselves, and drawing them
@@ -52,6 +64,12 @@ class Node {
         void set_transform(glm::mat4 const& m);
 
     protected:
+        /* Parent node, nullptr if the node is a root */
+        Node* m_parent;
+        /* SceneGraph whose flattened storage contains this node, if any */
+        SceneGraph* m_graph;
+        /* Index of the node in the flattened storage of m_graph */
+        int m_index;
         /* Do we draw this node and its children? */
         bool m_enabled;
         /* Position relative to the parent node */
@@ -65,23 +83,229 @@ class Node {
 
         /* Return a new node identifier and increment the counter */
         int nextId();
+
+        /* Called when a node is added to or removed from the subtree of this
+         * node. Forwards the notification to the parent node. */
+        virtual void structureChanged();
 };
 
 /* Root node of a scenegraph. */
 class SceneGraph : public Node {
+    friend class Node;
+    friend class DrawableNode;
     public:
-        SceneGraph();
+        /**
+          * \struct CullStats
+          * \brief Culling statistics of the last render.
+          */
+        struct CullStats {
+            /** Number of enabled drawable nodes tested */
+            size_t tested;
+            /** Number of nodes outside of the frustum or too small on screen */
+            size_t culled;
+            /** Number of nodes queued for drawing */
+            size_t drawn;
+        };
+
+        /**
+          * \enum Storage
+          * \brief How the SceneGraph stores its nodes for rendering.
+          */
+        enum class Storage {
+            /** Traverse the Node hierarchy recursively through a MatrixStack. */
+            Hierarchical,
+            /** Flatten the hierarchy in a SceneStorage and compute the world
+             *  transforms in a single linear pass. */
+            Flat
+        };
+
+        explicit SceneGraph(Storage storage = Storage::Flat);
         ~SceneGraph();
         /* Render the scene */
         void render();
         /* Render a specific node */
         void render(int id);
 
+        /**
+          * \brief Return the storage mode of the SceneGraph.
+          */
+        Storage storage() const;
+
+        /**
+          * \brief Return the number of nodes whose world transform was
+          * computed during the last render.
+          * With flat storage, world transforms are cached and only the nodes
+          * moved by Node::set_transform and their descendants are updated.
+          */
+        size_t updatedNodes() const;
+
+        /**
+          * \brief Set the thread pool used to compute the world transforms
+          * with flat storage. The SceneGraph doesn't take ownership of the
+          * pool. Pass nullptr to compute them on the rendering thread only.
+          */
+        void set_thread_pool(ThreadPool* pool);
+
+        /**
+          * \brief Set the world to camera transformation, used to sort the draw
+          * calls by depth.
+          */
+        void set_view(glm::mat4 const& worldToCamera);
+
+        /**
+          * \brief Return the RenderQueue used to submit the draw calls with flat
+          * storage.
+          */
+        RenderQueue& renderQueue();
+
+        /**
+          * \brief Return the state changes and draw calls issued by the last
+          * render with flat storage.
+          */
+        RenderQueue::Stats const& renderStats() const;
+
+        /**
+          * \brief Set the projection matrix. Together with the view set by
+          * \ref set_view, it defines the frustum used to cull the drawable
+          * nodes with flat storage. Culling is active once a projection is set.
+          */
+        void set_projection(glm::mat4 const& projection);
+
+        /**
+          * \brief Enable or disable frustum culling.
+          */
+        void set_culling(bool enable);
+
+        /**
+          * \brief Cull the nodes whose bounding sphere covers less than the
+          * specified fraction of the viewport height. 0 disables the test.
+          */
+        void set_min_screen_size(float fraction);
+
+        /**
+          * \brief Return the culling statistics of the last render with flat
+          * storage.
+          */
+        CullStats const& cullStats() const;
+
+        /**
+          * \brief Maintain a BVH over the world bounds of the drawable nodes with
+          * flat storage, and use it for frustum culling instead of testing every
+          * node.
+          * Moving nodes refits the BVH. Once the moved nodes add up to
+          * \p rebuildFraction of the drawable nodes, the BVH is rebuilt, on the
+          * thread pool set by \ref set_thread_pool if any.
+          */
+        void set_bvh(bool enable, float rebuildFraction = 0.1f);
+
+        /**
+          * \brief Return the BVH, as updated by the last render. Its items are
+          * the drawable nodes in depth-first order.
+          */
+        BVH const& bvh() const;
+
+        /**
+          * \brief Return the drawable node whose bounds are hit first by the
+          * ray, nullptr if none. Requires the BVH, see \ref set_bvh: returns
+          * nullptr when it is disabled or not built since the last change of
+          * the graph structure, until the next render.
+          */
+        DrawableNode* pick(glm::vec3 const& origin, glm::vec3 const& direction) const;
+
+        /**
+          * \brief Append the drawable nodes whose bounds intersect the region to
+          * \p nodes. Requires the BVH, see \ref set_bvh: appends nothing when
+          * it is disabled or not built since the last change of the graph
+          * structure, until the next render.
+          */
+        void query(AABB const& region, std::vector<DrawableNode*>& nodes) const;
+
+        /**
+          * \brief Use the shared uniform buffers. Every render uploads the
+          * per-frame block (see \ref FrameBlock) from the view, projection and
+          * time, and binds it for all programs. With flat storage, the world
+          * transforms of the nodes whose program declares the per-object block
+          * are uploaded together, see \ref RenderQueue::set_object_uniforms.
+          */
+        void set_uniform_buffers(bool enable);
+
+        /**
+          * \brief Set the time written to the per-frame uniform block, in
+          * seconds.
+          */
+        void set_time(float seconds);
+
+    protected:
+        virtual void structureChanged() override;
+
     private:
+        Storage m_storageMode;
         MatrixStack m_matrixStack;
+        SceneStorage m_storage;
+        ThreadPool* m_threadPool;
+        RenderQueue m_queue;
+        glm::mat4 m_view;
+        glm::mat4 m_projection;
+        bool m_hasProjection;
+        bool m_culling;
+        float m_minScreenSize;
+        CullStats m_cullStats;
+        /* Bounding spheres of the drawables, indexed by drawable index */
+        SphereArray m_localBounds;
+        SphereArray m_worldBounds;
+        std::vector<std::uint8_t> m_visible;
+        /* Number of enabled drawables before each drawable index */
+        std::vector<size_t> m_enabledBefore;
+        /* Drawables whose world bounds changed during the last render */
+        std::vector<int> m_movedDrawables;
+        /* Drawables whose local bounds were changed by DrawableNode::set_bounds */
+        std::vector<int> m_changedBounds;
+        bool m_useBVH;
+        float m_bvhRebuildFraction;
+        BVH m_bvh;
+        /* World boxes of the drawables, unbounded ones are empty */
+        std::vector<AABB> m_worldBoxes;
+        /* Drawables that aren't in the BVH because they are never culled */
+        std::vector<int> m_unbounded;
+        std::vector<int> m_bvhHits;
+        bool m_bvhDirty;
+        size_t m_movedSinceBuild;
+        /* BVH being rebuilt on the thread pool */
+        std::shared_ptr<BVH> m_pendingBVH;
+        std::future<void> m_bvhBuild;
+        /* Drawable nodes in depth-first order, indexed by the storage drawable index */
+        std::vector<DrawableNode*> m_drawables;
+        /* Storage index of the drawable nodes, in depth-first order */
+        std::vector<int> m_drawableNodes;
+        /* Storage index of the direct children of the root, by id */
+        std::map<int, int> m_rootIndices;
+        bool m_structureDirty;
+        /* Number of world transforms computed by the hierarchical traversal */
+        size_t m_updatedNodes;
+        bool m_uniformBuffers;
+        float m_time;
+        /* Per-frame uniform block, created by the first render using it */
+        std::unique_ptr<UBO<FrameBlock>> m_frameUBO;
 
         /* Render a Node from a pointer */
         void render(Node* n);
+        /* Upload and bind the per-frame uniform block */
+        void uploadFrameUniforms();
+
+        /* Rebuild the flattened storage from the Node hierarchy */
+        void flatten();
+        /* Update the world transforms and queue the flattened nodes in [begin, end) */
+        void renderFlat(int begin, int end);
+        /* Update the world bounds of the drawables that moved */
+        void updateBounds();
+        /* Return true if the items of m_bvh are the current m_drawables */
+        bool bvhCurrent() const;
+        /* Refit or rebuild the BVH for the drawables that moved */
+        void updateBVH();
+        /* Test the drawables in [first, last) against the frustum */
+        void cull(Frustum const& frustum, size_t first, size_t last);
+        /* Queue the visible drawables in [first, last) found by the BVH */
+        void cullBVH(Frustum const& frustum, size_t first, size_t last);
 };
 
 /* Base class for nodes that can be rendered */
@@ -91,12 +315,44 @@ class DrawableNode : public Node {
     DrawableNode(glm::mat4 const& position, Program* prog, VAO* vao, unsigned int nPrimitives,
                  Texture const* tex = nullptr, gl::GLenum primitiveMode = gl::GL_TRIANGLES);
 
-    /* Render the node */
-    virtual void draw(glm::mat4 const& m) = 0;
+    /* Bind the program, VAO and texture of the node, then render it with
+     * drawCall(). Nodes without a program draw nothing. */
+    void draw(glm::mat4 const& m);
+    /* Issue the draw call only. The program, VAO and texture of the node must
+     * already be bound. */
+    virtual void drawCall(glm::mat4 const& m) = 0;
+    /* Return true if the RenderQueue can bind the state of the node and call
+     * drawCall(), instead of calling draw() which binds everything itself. */
+    virtual bool queueable() const;
+    /* Return the geometry of the node in a MeshArena if its draw call can be
+     * merged with the draw calls of the nodes sharing its program, VAO and
+     * texture: the node is queueable and draws with no per-node uniform.
+     * Null otherwise. */
+    virtual MeshArena::Allocation const* mergeableGeometry() const;
     void set_texture(Texture const* tex = nullptr);
     void set_program(Program* prog);
     void set_vao(VAO* vao);
+    /* Transparent nodes are rendered after the opaque ones, back-to-front */
+    void set_transparent(bool transparent = true);
+    /* Set the bounding sphere of the geometry, relative to the node. Nodes
+     * with unbounded spheres are never culled. */
+    void set_bounds(BoundingSphere const& bounds);
+    BoundingSphere const& bounds() const;
+    /* Set the transform applied to the geometry before the world transform,
+     * such as the decoding of quantised positions. Ignored by InstancedNode. */
+    void set_geometry_transform(glm::mat4 const& m);
+    glm::mat4 const& geometryTransform() const;
+
+    Texture const* texture() const;
+    Program* program() const;
+    VAO* vao() const;
+    bool transparent() const;
+    gl::GLenum primitiveMode() const;
 
+    /* Enable or disable an engine attribute of the VAO, by its name in the
+     * shaders. Deprecated: the VAO of a mesh is shared by all its instances,
+     * toggle the attribute for all of them with Mesh::enable_attribute. */
+    [[deprecated("The VAO is shared by every instance of the mesh, use Mesh::enable_attribute")]]
     void enable_attribute(std::string const& attr, bool enable = true);
 
     protected:
@@ -105,6 +361,12 @@ class DrawableNode : public Node {
     unsigned int m_nPrimitives;
     gl::GLenum m_primitiveMode;
     VAO* m_vao;
+    bool m_transparent;
+    BoundingSphere m_bounds;
+    glm::mat4 m_geometryTransform;
+    /* Handle to the "m_world" uniform of the program, resolved when the
+     * program is set so that drawing doesn't look it up by name */
+    UniformHandle<glm::mat4> m_worldHandle;
 };
 
 /* Drawable object with its own geometry, rendered with array rendering. */
@@ -112,11 +374,12 @@ class Object : public DrawableNode {
     friend DrawableNode* Mesh::instantiate(glm::mat4 const& position, Program* p, Texture const* tex,
                                            gl::GLenum primitiveMode) const;
     public:
-        // Takes ownership of the VAO
+        // The VAO isn't owned by the node, it may be shared with other nodes
         Object(glm::mat4 const& position, Program* p, VAO* vao, unsigned int n_primitives,
                Texture const* tex = nullptr, gl::GLenum primitiveMode = gl::GL_TRIANGLES);
         ~Object();
-        virtual void draw(glm::mat4 const& m);
+        virtual void drawCall(glm::mat4 const& m);
+        virtual bool queueable() const;
 
     private:
 };
@@ -130,7 +393,8 @@ class IndexedObject : public DrawableNode {
                       gl::GLenum indexType = gl::GL_UNSIGNED_SHORT,
                       gl::GLenum primitiveMode = gl::GL_TRIANGLES);
         ~IndexedObject();
-        virtual void draw(glm::mat4 const& m);
+        virtual void drawCall(glm::mat4 const& m);
+        virtual bool queueable() const;
 
     private:
         const VBO* m_ebo;
@@ -138,6 +402,93 @@ class IndexedObject : public DrawableNode {
         gl::GLenum m_indexType;
 };
 
+/* Drawable object whose geometry is sub-allocated in a MeshArena, rendered with
+ * base-vertex draws. The VAO is shared by every mesh of the same vertex format
+ * and owned by the arena. */
+class ArenaObject : public DrawableNode {
+    public:
+        ArenaObject(glm::mat4 const& position, Program* p, VAO* vao, MeshArena::Allocation const* allocation,
+                    Texture const* tex = nullptr, gl::GLenum primitiveMode = gl::GL_TRIANGLES);
+        ~ArenaObject();
+        virtual void drawCall(glm::mat4 const& m);
+        virtual bool queueable() const;
+        virtual MeshArena::Allocation const* mergeableGeometry() const;
+
+    private:
+        MeshArena::Allocation const* m_allocation;
+};
+
+/* Drawable object rendering geometry written to a StreamBuffer, which is set
+ * again with set_geometry every frame. The VAO is owned by the StreamBuffer. */
+class StreamObject : public DrawableNode {
+    public:
+        StreamObject(glm::mat4 const& position, Program* p, VAO* vao, Texture const* tex = nullptr,
+                     gl::GLenum primitiveMode = gl::GL_TRIANGLES);
+        ~StreamObject();
+        virtual void drawCall(glm::mat4 const& m);
+        virtual bool queueable() const;
+
+        /* Draw the geometry written to the stream buffer for this frame */
+        void set_geometry(StreamBuffer::Geometry const& geometry);
+
+    private:
+        StreamBuffer::Geometry m_geometry;
+};
+
+/* Drawable object rendering many instances of the same geometry in a single
+ * instanced draw call. The transform of each instance is stored in a VBO and
+ * passed to the mat4 "i_world" vertex attribute, relative to the node. */
+class InstancedNode : public DrawableNode {
+    public:
+        // Takes ownership of the VAO. If ebo is null, the geometry is drawn
+        // with array rendering and nElements is the number of vertices.
+        InstancedNode(glm::mat4 const& position, Program* p, VAO* vao, BoundingSphere const& meshBounds,
+                      const VBO* ebo, unsigned int nElements, Texture const* tex = nullptr,
+                      gl::GLenum indexType = gl::GL_UNSIGNED_SHORT,
+                      gl::GLenum primitiveMode = gl::GL_TRIANGLES);
+        ~InstancedNode();
+        virtual void drawCall(glm::mat4 const& m);
+        virtual bool queueable() const;
+
+        /* Add an instance and return its id */
+        int addInstance(glm::mat4 const& m);
+        /* Move an instance */
+        void set_instance(int id, glm::mat4 const& m);
+        /* Remove an instance, its id may be reused */
+        void removeInstance(int id);
+        glm::mat4 const& instance(int id) const;
+        size_t instanceCount() const;
+
+    private:
+        const VBO* m_ebo;
+        unsigned int m_nElements;
+        gl::GLenum m_indexType;
+        VBO m_instanceVBO;
+        /* Number of instances the VBO can hold */
+        size_t m_capacity;
+        /* Instance transforms, packed in the VBO order */
+        std::vector<glm::mat4> m_transforms;
+        /* Id of the instance at each slot, and slot of each id (-1 if free) */
+        std::vector<int> m_ids;
+        std::vector<int> m_slots;
+        std::vector<int> m_freeIds;
+        /* Range of slots modified since the last upload */
+        size_t m_dirtyBegin, m_dirtyEnd;
+        BoundingSphere m_meshBounds;
+        /* Box containing every instance. It grows with the instances, and is
+         * rebuilt on upload after instances are moved or removed. */
+        AABB m_instanceBox;
+        bool m_boundsDirty;
+
+        int slot(int id) const;
+        void markDirty(size_t slot);
+        void growBounds(glm::mat4 const& m);
+        /* Recompute the bounds from the instance transforms */
+        void rebuildBounds();
+        /* Upload the modified transforms to the VBO */
+        void upload();
+};
+
 } // namespace Engine
 
 #endif
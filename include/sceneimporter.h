@@ -16,6 +16,8 @@
 
 namespace Engine {
 
+class ThreadPool;
+
 /**
   * \class SceneImporter
   * \brief This class handles the import of scene geometry from files on the disk or in
@@ -75,10 +77,56 @@ class SceneImporter {
          * @brief Instantiate a mesh contained in the scene.
          *
          * @param mesh aiMesh to instantiate
+         * @param layout Storage of the vertex attributes
+         * @param quantise Vertex data to store in compressed formats
+         * @param optimize Reordering of the indices and vertices
          *
          * @return An instance of the Mesh.
          */
-        std::unique_ptr<Mesh> instantiateMesh(aiMesh const& mesh) const;
+        std::unique_ptr<Mesh> instantiateMesh(aiMesh const& mesh,
+                                              MeshBuilder::VertexLayout layout = MeshBuilder::VertexLayout::Interleaved,
+                                              MeshBuilder::Quantise quantise = MeshBuilder::Quantise::None,
+                                              MeshBuilder::Optimize optimize = MeshBuilder::Optimize::None) const;
+
+        /**
+         * @brief Instantiate every mesh of the loaded scene. The meshes are
+         * converted, optimised and quantised in parallel, then uploaded on the
+         * calling thread, which must be the thread of the OpenGL context.
+         *
+         * @param pool Threads converting the meshes along with the calling
+         * thread. If null, the meshes are converted on the calling thread.
+         * @param layout Storage of the vertex attributes
+         * @param quantise Vertex data to store in compressed formats
+         * @param optimize Reordering of the indices and vertices
+         *
+         * @return The meshes, in the order of \ref meshes.
+         */
+        std::vector<std::unique_ptr<Mesh>>
+        instantiateMeshes(ThreadPool* pool,
+                          MeshBuilder::VertexLayout layout = MeshBuilder::VertexLayout::Interleaved,
+                          MeshBuilder::Quantise quantise = MeshBuilder::Quantise::None,
+                          MeshBuilder::Optimize optimize = MeshBuilder::Optimize::None) const;
+
+        /**
+         * @brief Convert every mesh of the loaded scene to a prepared
+         * MeshBuilder, see \ref MeshBuilder::prepare, without using OpenGL.
+         * This is the part of \ref instantiateMeshes that can run on any
+         * thread, the meshes are built later on the thread of the OpenGL
+         * context.
+         *
+         * @param pool Threads converting the meshes along with the calling
+         * thread. If null, the meshes are converted on the calling thread.
+         * @param layout Storage of the vertex attributes
+         * @param quantise Vertex data to store in compressed formats
+         * @param optimize Reordering of the indices and vertices
+         *
+         * @return The builders, in the order of \ref meshes.
+         */
+        std::vector<std::unique_ptr<MeshBuilder>>
+        prepareMeshes(ThreadPool* pool,
+                      MeshBuilder::VertexLayout layout = MeshBuilder::VertexLayout::Interleaved,
+                      MeshBuilder::Quantise quantise = MeshBuilder::Quantise::None,
+                      MeshBuilder::Optimize optimize = MeshBuilder::Optimize::None) const;
 
         /**
           * \fn dropComponents
@@ -96,21 +144,10 @@ class SceneImporter {
     private:
         Assimp::Importer m_assimp;
 
-        template <size_t n>
-        static void readIndex(std::vector<unsigned char>& v1, std::vector<unsigned short>& v2,
-                              std::vector<unsigned int>& v3, aiFace* c);
+        /* Pass the attributes of mesh to the builder. Doesn't use OpenGL. */
+        static void convertMesh(aiMesh const& mesh, MeshBuilder& builder);
 };
 
-template<>
-void SceneImporter::readIndex<1>(std::vector<unsigned char>& v1, std::vector<unsigned short>& v2,
-                                std::vector<unsigned int>& v3, aiFace* c);
-template<>
-void SceneImporter::readIndex<2>(std::vector<unsigned char>& v1, std::vector<unsigned short>& v2,
-                                 std::vector<unsigned int>& v3, aiFace* c);
-template<>
-void SceneImporter::readIndex<4>(std::vector<unsigned char>& v1, std::vector<unsigned short>& v2,
-                                 std::vector<unsigned int>& v3, aiFace* c);
-
 namespace traits {
     template <>
     struct enable_bitmask_operators<SceneImporter::PostProcess> {
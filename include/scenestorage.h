@@ -0,0 +1,171 @@
+/**
+  * \file include/scenestorage.h
+  * \brief Contains the definition of the SceneStorage class.
+  * \author R.Chavignat
+  */
+#ifndef SCENE_STORAGE_H
+#define SCENE_STORAGE_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Engine {
+
+/**
+  * \class SceneStorage
+  * \brief Flattened, data-oriented storage for the nodes of a SceneGraph.
+  *
+  * Nodes are stored in depth-first order as a structure of arrays, so that a
+  * parent is always stored before its children and every subtree occupies a
+  * contiguous range of indices. World transforms can then be computed in a
+  * single linear pass over contiguous memory.
+  */
+class ThreadPool;
+
+class SceneStorage {
+    public:
+        /**
+          * \enum Flags
+          * \brief Per-node flags.
+          */
+        enum Flags : std::uint8_t {
+            /** The node and all its ancestors are enabled */
+            Enabled = 1 << 0,
+            /** The node is a DrawableNode */
+            Drawable = 1 << 1,
+            /** The local transform changed since the last world transform update */
+            Dirty = 1 << 2
+        };
+
+        /** \brief Parent index of the nodes that have no parent in the storage. */
+        static constexpr int NoParent = -1;
+
+        /**
+          * \brief Constructor. Construct an empty storage.
+          */
+        SceneStorage();
+
+        /**
+          * \brief Destructor.
+          */
+        ~SceneStorage();
+
+        /**
+          * \brief Remove every node from the storage.
+          */
+        void clear();
+
+        /**
+          * \brief Reserve memory for the specified number of nodes.
+          */
+        void reserve(size_t n);
+
+        /**
+          * \brief Return the number of nodes in the storage.
+          */
+        size_t size() const;
+
+        /**
+          * \brief Append a node at the end of the storage.
+          * Nodes must be appended in depth-first order, i.e. the parent must
+          * already be in the storage.
+          * \param parent Index of the parent node, or \ref NoParent.
+          * \param local Transformation of the node relative to its parent.
+          * \param flags Node flags.
+          * \param drawable Index of the node in the drawable list, -1 if the node
+          * isn't drawable.
+          * \return The index of the new node.
+          */
+        int append(int parent, glm::mat4 const& local, std::uint8_t flags, int drawable = -1);
+
+        /**
+          * \brief Mark the end of the subtree rooted at node \p i.
+          * Must be called once all the descendants of the node are appended.
+          */
+        void close_subtree(int i);
+
+        /**
+          * \brief Return the index of the parent of node \p i.
+          */
+        int parent(int i) const;
+        /**
+          * \brief Return the index one past the last node of the subtree rooted at \p i.
+          */
+        int subtree_end(int i) const;
+        /**
+          * \brief Return the flags of node \p i.
+          */
+        std::uint8_t flags(int i) const;
+        /**
+          * \brief Return the drawable index of node \p i, -1 if it isn't drawable.
+          */
+        int drawable(int i) const;
+
+        /**
+          * \brief Return the transformation of node \p i relative to its parent.
+          */
+        glm::mat4 const& local(int i) const;
+        /**
+          * \brief Set the transformation of node \p i relative to its parent.
+          * The node and its subtree are marked dirty.
+          */
+        void set_local(int i, glm::mat4 const& m);
+
+        /**
+          * \brief Return the world transformation of node \p i, as computed by the
+          * last call to \ref updateWorldTransforms.
+          */
+        glm::mat4 const& world(int i) const;
+
+        /**
+          * \brief Compute the world transforms of the dirty nodes and their
+          * descendants. The world transforms of the other nodes are cached from
+          * the previous update.
+          * The composition of transforms is done by MatrixStack::compose so
+          * the result is identical to a recursive traversal with a MatrixStack.
+          * \param pool If not null, independent subtrees are updated in
+          * parallel on the threads of the pool. The result doesn't depend on
+          * the number of threads.
+          * \return The number of nodes whose world transform was recomputed.
+          */
+        size_t updateWorldTransforms(ThreadPool* pool = nullptr);
+
+        /**
+          * \brief Return the number of nodes whose world transform was
+          * recomputed by the last call to \ref updateWorldTransforms.
+          */
+        size_t updatedNodes() const;
+
+        /**
+          * \brief Return the roots of the subtrees whose world transforms were
+          * recomputed by the last call to \ref updateWorldTransforms, in
+          * increasing order. The subtrees don't overlap.
+          */
+        std::vector<int> const& updatedRoots() const;
+
+    private:
+        std::vector<int> m_parents;
+        std::vector<int> m_subtreeEnds;
+        std::vector<glm::mat4> m_locals;
+        std::vector<glm::mat4> m_worlds;
+        std::vector<std::uint8_t> m_flags;
+        std::vector<int> m_drawables;
+        /* Nodes whose local transform changed since the last update */
+        std::vector<int> m_dirty;
+        /* Roots of the subtrees to update, and parallel tasks */
+        std::vector<int> m_roots;
+        std::vector<int> m_tasks;
+        /* Set when nodes were appended, every node must be updated */
+        bool m_allDirty;
+        size_t m_updatedNodes;
+
+        /* Compute the world transforms of the nodes in [begin, end) */
+        void updateRange(int begin, int end);
+        /* Update the subtrees rooted at m_roots on the threads of the pool */
+        void updateParallel(ThreadPool& pool);
+};
+
+} // namespace Engine
+
+#endif
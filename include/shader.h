@@ -2,6 +2,7 @@
 #define SHADER_H
 
 #include <istream>
+#include <string>
 #include <glbinding/gl33core/gl.h>
 
 namespace Engine {
@@ -43,7 +44,12 @@ class Shader {
 
     protected:
         Shader(std::string const& file, gl::GLenum t);
+        /* Compile source code already in memory */
+        Shader(gl::GLenum t, std::string const& source);
         gl::GLuint m_id;
+
+        /* Read the source code of a shader file */
+        static std::string readSource(std::string const& file);
 };
 
 } // namespace Engine
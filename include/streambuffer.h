@@ -0,0 +1,184 @@
+/**
+  * \file include/streambuffer.h
+  * \brief Contains the definition of the StreamBuffer class.
+  * \author R.Chavignat
+  */
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "fencedring.h"
+#include "mesharena.h"
+#include "vao.h"
+#include "vbo.h"
+
+#include <memory>
+#include <vector>
+#include <glbinding/gl33core/gl.h>
+
+namespace Engine {
+
+/**
+  * \class StreamBuffer
+  * \brief Ring buffer for the vertices and indices of geometry rebuilt every
+  * frame, such as text, UI, particles or debug lines.
+  *
+  * The geometry of a frame is written to ranges of a single buffer that never
+  * gets reallocated, and drawn with a base vertex from VAOs cached per vertex
+  * format, so that drawing dynamic geometry doesn't allocate any
+  * GL object once the VAOs exist. \ref endFrame fences the ranges of the frame,
+  * which are recycled once the GPU is done with them.
+  *
+  * With GL_ARB_buffer_storage the buffer is mapped persistently and the
+  * geometry is written directly in it. Otherwise it is written to a CPU copy
+  * and \ref flush copies it to the buffer with unsynchronised mappings, which
+  * must be done before drawing with it.
+  */
+class StreamBuffer {
+    public:
+        /**
+          * \struct Range
+          * \brief Range of the ring buffer.
+          */
+        struct Range {
+            ptrdiff_t offset;
+            size_t size;
+        };
+
+        /**
+          * \struct Geometry
+          * \brief Vertices and indices written with \ref write, to be drawn
+          * with glDrawElementsBaseVertex or glDrawArrays.
+          */
+        struct Geometry {
+            /** Index of the first vertex in the buffer */
+            gl::GLint baseVertex;
+            gl::GLsizei vertexCount;
+            /** Offset of the first index in the buffer, in bytes */
+            ptrdiff_t indexOffset;
+            gl::GLsizei indexCount;
+            /** GL_UNSIGNED_SHORT or GL_UNSIGNED_INT */
+            gl::GLenum indexType;
+        };
+
+        /**
+          * \brief Constructor. Requires a current GL context.
+          * \param size Size of the ring buffer, in bytes.
+          * \param frames Maximum number of frames in flight.
+          * \param persistent Map the buffer persistently if supported.
+          */
+        explicit StreamBuffer(size_t size = 16 << 20, unsigned int frames = 3, bool persistent = true);
+
+        /**
+          * \brief Destructor.
+          */
+        ~StreamBuffer();
+
+        StreamBuffer(StreamBuffer const& other) = delete;
+        StreamBuffer(StreamBuffer&& other) = delete;
+        StreamBuffer& operator=(StreamBuffer const& other) = delete;
+        StreamBuffer& operator=(StreamBuffer&& other) = delete;
+
+        /**
+          * \brief Allocate a range for the current frame. Throws a
+          * std::runtime_error if the ranges of the frame don't fit in the ring.
+          * \param size Size of the range, in bytes.
+          * \param alignment Alignment of the start of the range, in bytes.
+          */
+        Range allocate(size_t size, size_t alignment = 4);
+
+        /**
+          * \brief Return a pointer to write a range to, before the next
+          * allocation or \ref flush.
+          */
+        char* data(Range const& range);
+
+        /**
+          * \brief Write the geometry of a draw call.
+          * \param format Vertex format
+          * \param vertices Interleaved vertices, format.stride() bytes each
+          * \param nVertices Number of vertices
+          * \param indices Vertex indices relative to the first vertex, may be
+          * empty
+          */
+        Geometry write(MeshArena::VertexFormat const& format, const void* vertices, unsigned int nVertices,
+                       std::vector<unsigned short> const& indices);
+        /**
+          * \brief Write the geometry of a draw call with 32 bit indices.
+          */
+        Geometry write(MeshArena::VertexFormat const& format, const void* vertices, unsigned int nVertices,
+                       std::vector<unsigned int> const& indices);
+
+        /**
+          * \brief Make the ranges written since the last flush visible to the
+          * GPU.
+          */
+        void flush();
+
+        /**
+          * \brief Flush, and fence the ranges of the current frame so that they
+          * are recycled once the GPU has executed the frame.
+          */
+        void endFrame();
+
+        /**
+          * \brief Return the VAO mapping the vertices of a format to the
+          * engine attribute locations, with the buffer bound as index buffer.
+          * It is owned by the StreamBuffer.
+          */
+        VAO* vao(MeshArena::VertexFormat const& format);
+
+        /**
+          * \brief Return the ring buffer.
+          */
+        VBO const& buffer() const;
+
+        /**
+          * \brief Return true if the buffer is persistently mapped.
+          */
+        bool persistent() const;
+
+        /**
+          * \brief Return the size of the ring buffer, in bytes.
+          */
+        size_t size() const;
+
+        /**
+          * \brief Return the number of bytes used by the frames in flight and
+          * the current frame, alignment padding included.
+          */
+        size_t used() const;
+
+        /**
+          * \brief Return the number of times the ring waited for the GPU to
+          * recycle ranges.
+          */
+        size_t waits() const;
+
+        /**
+          * \brief Return true if the context supports GL_ARB_buffer_storage.
+          */
+        static bool persistentSupported();
+
+    private:
+        struct CachedVAO {
+            MeshArena::VertexFormat format;
+            std::unique_ptr<VAO> vao;
+        };
+
+        VBO m_buffer;
+        /* Persistent mapping of the buffer, or null */
+        char* m_mapped;
+        /* CPU copy of the buffer when it isn't persistently mapped */
+        std::vector<char> m_staging;
+        FencedRing m_ring;
+        std::vector<CachedVAO> m_vaos;
+
+        /* Copy [offset, offset + size) of the staging buffer to the buffer */
+        void upload(size_t offset, size_t size);
+        Geometry write(MeshArena::VertexFormat const& format, const void* vertices, unsigned int nVertices,
+                       const void* indices, size_t nIndices, size_t indexSize);
+};
+
+} // namespace Engine
+
+#endif
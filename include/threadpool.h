@@ -0,0 +1,84 @@
+/**
+  * \file include/threadpool.h
+  * \brief Contains the definition of the ThreadPool class.
+  * \author R.Chavignat
+  */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Engine {
+
+/**
+  * \class ThreadPool
+  * \brief A fixed-size pool of worker threads executing tasks from a shared queue.
+  */
+class ThreadPool {
+    public:
+        /**
+          * \brief Constructor.
+          * \param nThreads Number of worker threads. The thread calling
+          * \ref parallel_for also takes part in the work, so a pool of
+          * n - 1 threads uses n cores.
+          */
+        explicit ThreadPool(unsigned int nThreads = std::thread::hardware_concurrency());
+
+        /**
+          * \brief Destructor. Waits for the queued tasks to complete.
+          */
+        ~ThreadPool();
+
+        /* No copy or move */
+        ThreadPool(ThreadPool const& other) = delete;
+        ThreadPool& operator=(ThreadPool const& other) = delete;
+        ThreadPool(ThreadPool&& other) = delete;
+        ThreadPool& operator=(ThreadPool&& other) = delete;
+
+        /**
+          * \brief Return the number of worker threads.
+          */
+        unsigned int size() const;
+
+        /**
+          * \brief Queue a task for execution on a worker thread.
+          * \param f Callable object taking no parameter
+          * \return A future holding the result of the task.
+          */
+        template <class F>
+        std::future<typename std::result_of<F()>::type> submit(F&& f);
+
+        /**
+          * \brief Call f(i) for every i in [0, n), distributing the calls on
+          * the worker threads and the calling thread. Returns when every call
+          * has completed.
+          *
+          * If a call throws, the indices not started yet are skipped and the
+          * first exception is rethrown on the calling thread once the calls
+          * in progress have returned.
+          */
+        void parallel_for(size_t n, std::function<void(size_t)> const& f);
+
+    private:
+        std::vector<std::thread> m_threads;
+        std::queue<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_stop;
+
+        void enqueue(std::function<void()> task);
+        void worker();
+};
+
+#include "threadpool.inl"
+
+} // namespace Engine
+
+#endif
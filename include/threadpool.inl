@@ -0,0 +1,13 @@
+#ifndef THREADPOOL_H
+#include "threadpool.h"
+#endif
+
+template <class F>
+std::future<typename std::result_of<F()>::type> ThreadPool::submit(F&& f) {
+    using R = typename std::result_of<F()>::type;
+    // std::function needs a copyable target, so the packaged_task is shared
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    std::future<R> future = task->get_future();
+    enqueue([task] () { (*task)(); });
+    return future;
+}
@@ -10,6 +10,8 @@
 #include "utility.h"
 #include "gl_traits.h"
 
+#include <array>
+#include <cstring>
 #include <vector>
 
 namespace Engine {
@@ -46,7 +48,7 @@ namespace Engine {
         struct field_std140_offset {
             using T = field_type<U, i>;
             static constexpr ptrdiff_t value =
-                align<(field_std140_offset<U, i-1>::value + sizeof(field_type<U, i-1>)), glsl_alignment<T>::value>::value;
+                align<(field_std140_offset<U, i-1>::value + glsl_size<field_type<U, i-1>>::value), glsl_alignment<T>::value>::value;
         };
 
         /**
@@ -91,12 +93,12 @@ namespace Engine {
             static constexpr ptrdiff_t value = 0;
         };
 
-        // Private implementation of UBO::upload_std140
+        // Private implementation of pack_std140
         template <class U, unsigned int i>
-        struct uploadUBOStd140Impl {
-            static inline void f(U const& block, VBO& v);
+        struct packStd140Impl {
+            static inline void f(U const& block, char* dst);
 
-            static inline void upload_field(U const& block, VBO& v, ptrdiff_t offset);
+            static inline void pack_field(U const& block, char* dst);
         };
 #endif // DOX_SKIP_BLOCK
 
@@ -107,8 +109,44 @@ namespace Engine {
          * @tparam U Uniform block type
          */
         template <class U>
-        struct block_size : boost::mpl::size_t<field_std140_offset<U, n_fields<U>::value-1>::value + sizeof(field_type<U, n_fields<U>::value-1>)> { };
+        struct block_size : boost::mpl::size_t<field_std140_offset<U, n_fields<U>::value-1>::value + glsl_size<field_type<U, n_fields<U>::value-1>>::value> { };
 
+        /**
+         * @brief Check that the types listed by uniform_block_types fit in the
+         * uniform block type.
+         *
+         * @tparam U Uniform block type
+         */
+        template <class U>
+        struct block_types_match : std::integral_constant<bool,
+            (static_cast<size_t>(field_struct_offset<U, n_fields<U>::value-1>::value) +
+             sizeof(field_type<U, n_fields<U>::value-1>)) <= sizeof(U)> { };
+
+        /**
+         * @brief std140 layout of a uniform block nested in another block,
+         * aligned like a vec4 and padded to a multiple of its alignment.
+         *
+         * @tparam U Uniform block type
+         */
+        template <class U>
+        struct std140_layout {
+            static_assert(block_types_match<U>::value, "uniform_block_types doesn't match the block members");
+            static constexpr size_t alignment = 16;
+            static constexpr size_t size = align<block_size<U>::value, 16>::value;
+
+            static void pack(U const& value, char* dst);
+        };
+
+        /**
+         * @brief Copy the fields of a uniform block to their std140 offsets in
+         * \p dst. The padding bytes of \p dst are left untouched.
+         *
+         * @tparam U Uniform block type
+         * @param block Uniform block
+         * @param dst Destination, at least block_size<U>::value bytes long
+         */
+        template <class U>
+        inline void pack_std140(U const& block, void* dst);
 
     } // namespace traits
 
@@ -120,6 +158,9 @@ namespace Engine {
     template <class T>
     class UBO: public VBO {
         //static_assert(std::is_base_of<UniformBlock, T>::value, "UBO type parameter must inherit from UniformBlock");
+        static_assert(traits::block_types_match<T>::value, "uniform_block_types doesn't match the block members");
+        // Minimum value of GL_MAX_UNIFORM_BLOCK_SIZE
+        static_assert(traits::block_size<T>::value <= 16384, "Uniform block too large");
 
         public:
             /**
@@ -139,12 +180,21 @@ namespace Engine {
             virtual ~UBO();
 
             /**
-             * @brief Upload the uniform block to the GPU.
+             * @brief Upload the uniform block to the GPU. The block is packed
+             * in std140 layout and uploaded with a single call.
              *
              * @param hint Buffer usage hint
              */
             void upload_std140(gl::GLenum hint = gl::GL_DYNAMIC_DRAW);
 
+            /**
+             * @brief Upload the part of the uniform block modified since the
+             * last upload. The byte range spanning every modified field is
+             * uploaded with a single call, nothing is uploaded if the block
+             * didn't change.
+             */
+            void upload_std140_dirty();
+
             /*
              * @brief Upload an array of uniform blocks to the GPU.
              *
@@ -153,6 +203,12 @@ namespace Engine {
              */
             // TODO: implement this later as a class template specialization
             //void upload_std140(std::vector<T> const& data, GLenum hint = GL_DYNAMIC_DRAW);
+
+        private:
+            /* Content of the buffer in std140 layout, as last uploaded */
+            std::array<char, traits::block_size<T>::value> m_staging;
+            /* False until the whole block has been uploaded once */
+            bool m_uploaded;
     };
 
 #include "ubo.inl"
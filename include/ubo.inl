@@ -5,7 +5,9 @@
 template <class U>
 UBO<U>::UBO() :
     VBO(traits::block_size<U>::value),
-    data()
+    data(),
+    m_staging(),
+    m_uploaded(false)
 { }
 
 template <class U>
@@ -13,22 +15,53 @@ UBO<U>::~UBO() { }
 
 template <class U>
 void UBO<U>::upload_std140(gl::GLenum) {
-    traits::uploadUBOStd140Impl<U, 0>::f(data, *this);
+    traits::pack_std140(data, m_staging.data());
+    update_data(m_staging[0], m_staging.size(), 0);
+    m_uploaded = true;
+}
+
+template <class U>
+void UBO<U>::upload_std140_dirty() {
+    if(!m_uploaded) {
+        upload_std140();
+        return;
+    }
+    std::array<char, traits::block_size<U>::value> packed(m_staging);
+    traits::pack_std140(data, packed.data());
+    size_t first = 0;
+    while(first != packed.size() && packed[first] == m_staging[first])
+        ++first;
+    if(first == packed.size())
+        return;
+    size_t last = packed.size();
+    while(packed[last - 1] == m_staging[last - 1])
+        --last;
+    std::memcpy(m_staging.data() + first, packed.data() + first, last - first);
+    update_data(m_staging[first], last - first, static_cast<ptrdiff_t>(first));
 }
 
 namespace traits {
+    template <class U>
+    void std140_layout<U>::pack(U const& value, char* dst) {
+        pack_std140(value, dst);
+    }
+
+    template <class U>
+    inline void pack_std140(U const& block, void* dst) {
+        packStd140Impl<U, 0>::f(block, static_cast<char*>(dst));
+    }
+
     template <class U, unsigned int i>
-    inline void uploadUBOStd140Impl<U, i>::f(U const& block, VBO& v) {
-        upload_field(block, v, field_std140_offset<U, i>::value);
+    inline void packStd140Impl<U, i>::f(U const& block, char* dst) {
+        pack_field(block, dst);
         std::conditional<(i+1) < n_fields<U>::value,
-                         uploadUBOStd140Impl<U, i+1>,
-                         no_op<U const&, VBO&>>::type::f(block, v);
+                         packStd140Impl<U, i+1>,
+                         no_op<U const&, char*>>::type::f(block, dst);
     }
 
     template <class U, unsigned int i>
-    inline void uploadUBOStd140Impl<U, i>::
-    upload_field(U const& block, VBO& v, ptrdiff_t offset) {
-        using T = decltype(get_field<U, i>::value(block));
-        v.update_data<T>(get_field<U, i>::value(block), sizeof(T), offset);
+    inline void packStd140Impl<U, i>::pack_field(U const& block, char* dst) {
+        using T = field_type<U, i>;
+        std140_layout<T>::pack(get_field<U, i>::value(block), dst + field_std140_offset<U, i>::value);
     }
 } // namespace traits
@@ -0,0 +1,140 @@
+/**
+  * \file include/uniformbuffers.h
+  * \brief Contains the uniform blocks shared by every program and the
+  * ObjectBuffer class.
+  * \author R.Chavignat
+  */
+#ifndef UNIFORM_BUFFERS_H
+#define UNIFORM_BUFFERS_H
+
+#include "ubo.h"
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Engine {
+
+/**
+  * \brief Binding point of the per-frame uniform block. Programs declaring a
+  * uniform block named "Frame" have it bound there when they are built.
+  */
+constexpr unsigned int FrameBlockBinding = 0;
+
+/**
+  * \brief Binding point of the per-object uniform block. Programs declaring a
+  * uniform block named "Object" have it bound there when they are built.
+  */
+constexpr unsigned int ObjectBlockBinding = 1;
+
+/**
+  * \struct FrameBlock
+  * \brief Content of the per-frame uniform block, declared in GLSL as:
+  * \code
+  * layout(std140) uniform Frame {
+  *     mat4 view;
+  *     mat4 projection;
+  *     mat4 viewProjection;
+  *     vec3 cameraPosition;
+  *     float time;
+  * };
+  * \endcode
+  */
+struct FrameBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec3 cameraPosition;
+    float time;
+};
+
+/**
+  * \struct ObjectBlock
+  * \brief Content of the per-object uniform block, declared in GLSL as:
+  * \code
+  * layout(std140) uniform Object {
+  *     mat4 world;
+  *     mat3 normalTransform;
+  * };
+  * \endcode
+  */
+struct ObjectBlock {
+    glm::mat4 world;
+    glm::mat3 normalTransform;
+};
+
+namespace traits {
+    #ifndef DOX_SKIP_BLOCK
+    template <>
+    struct uniform_block_types<FrameBlock> {
+        using type = type_list<glm::mat4, glm::mat4, glm::mat4, glm::vec3, float>;
+    };
+
+    template <>
+    struct uniform_block_types<ObjectBlock> {
+        using type = type_list<glm::mat4, glm::mat3>;
+    };
+    #endif // DOX_SKIP_BLOCK
+} // namespace traits
+
+/**
+  * \class ObjectBuffer
+  * \brief Uniform buffer holding the ObjectBlock of every draw call of a frame.
+  *
+  * The blocks are packed in a staging buffer as they are pushed, then uploaded
+  * with a single call. Each draw call binds its own block with
+  * glBindBufferRange, so the blocks are spaced by the uniform buffer offset
+  * alignment of the implementation.
+  */
+class ObjectBuffer {
+    public:
+        /**
+          * \brief Constructor. The GL buffer is only created by the first
+          * upload, so a GL context isn't required until then.
+          */
+        ObjectBuffer();
+
+        /**
+          * \brief Destructor.
+          */
+        ~ObjectBuffer();
+
+        /**
+          * \brief Remove every block.
+          */
+        void clear();
+
+        /**
+          * \brief Add the block of an object.
+          * \param world World transformation of the object.
+          * \return Slot of the block, to pass to \ref bind.
+          */
+        unsigned int push(glm::mat4 const& world);
+
+        /**
+          * \brief Return the number of blocks.
+          */
+        size_t size() const;
+
+        /**
+          * \brief Upload every block to the GPU. The buffer is orphaned, so that
+          * the upload doesn't wait for the draw calls of the previous frame.
+          */
+        void upload();
+
+        /**
+          * \brief Bind the block in \p slot to \ref ObjectBlockBinding.
+          */
+        void bind(unsigned int slot);
+
+    private:
+        std::unique_ptr<VBO> m_buffer;
+        std::vector<char> m_staging;
+        /* Distance between two blocks, 0 until queried from GL */
+        size_t m_stride;
+        size_t m_count;
+};
+
+} // namespace Engine
+
+#endif
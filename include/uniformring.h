@@ -0,0 +1,126 @@
+/**
+  * \file include/uniformring.h
+  * \brief Contains the definition of the UniformRing class.
+  * \author R.Chavignat
+  */
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include "fencedring.h"
+#include "ubo.h"
+
+#include <vector>
+#include <glbinding/gl33core/gl.h>
+
+namespace Engine {
+
+/**
+  * \class UniformRing
+  * \brief Ring allocator handing out slices of a single uniform buffer for
+  * transient uniform blocks, such as per-draw material or object data.
+  *
+  * Slices are aligned on GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT so that each of
+  * them can be bound with glBindBufferRange. Blocks are written to a CPU copy
+  * of the buffer, then \ref flush copies the bytes written since the last
+  * flush to the buffer, which must be done before drawing with them.
+  * \ref endFrame fences the slices of the frame. They are recycled once the
+  * GPU is done with them, and the ring waits for the GPU when it runs out of
+  * space or when too many frames are in flight.
+  */
+class UniformRing {
+    public:
+        /**
+          * \struct Slice
+          * \brief Range of the ring buffer.
+          */
+        struct Slice {
+            ptrdiff_t offset;
+            size_t size;
+        };
+
+        /**
+          * \brief Constructor. Requires a current GL context.
+          * \param size Size of the ring buffer, in bytes.
+          * \param frames Maximum number of frames in flight.
+          */
+        explicit UniformRing(size_t size = 4 << 20, unsigned int frames = 3);
+
+        /**
+          * \brief Destructor.
+          */
+        ~UniformRing();
+
+        UniformRing(UniformRing const& other) = delete;
+        UniformRing(UniformRing&& other) = delete;
+        UniformRing& operator=(UniformRing const& other) = delete;
+        UniformRing& operator=(UniformRing&& other) = delete;
+
+        /**
+          * \brief Allocate a slice for the current frame. Throws a
+          * std::runtime_error if the slices of the frame don't fit in the ring.
+          * \param size Size of the slice, in bytes.
+          */
+        Slice allocate(size_t size);
+
+        /**
+          * \brief Allocate a slice and write a uniform block to it in the std140
+          * layout.
+          * \tparam T Uniform block type
+          */
+        template <class T>
+        Slice push(T const& block);
+
+        /**
+          * \brief Return a pointer to the CPU copy of a slice, to write to it
+          * until the next \ref flush.
+          */
+        char* data(Slice const& slice);
+
+        /**
+          * \brief Copy the slices written since the last flush to the buffer.
+          */
+        void flush();
+
+        /**
+          * \brief Bind a slice to an indexed uniform buffer binding point.
+          */
+        void bind(Slice const& slice, unsigned int binding);
+
+        /**
+          * \brief Flush, and fence the slices of the current frame so that they
+          * are recycled once the GPU has executed the frame.
+          */
+        void endFrame();
+
+        /**
+          * \brief Return the size of the ring buffer, in bytes.
+          */
+        size_t size() const;
+
+        /**
+          * \brief Return the number of bytes used by the frames in flight and
+          * the current frame, alignment padding included.
+          */
+        size_t used() const;
+
+        /**
+          * \brief Return the number of times the ring waited for the GPU to
+          * recycle slices.
+          */
+        size_t waits() const;
+
+    private:
+        VBO m_buffer;
+        std::vector<char> m_staging;
+        size_t m_alignment;
+        FencedRing m_ring;
+
+        /* Copy [offset, offset + size) of the staging buffer to the buffer */
+        void upload(size_t offset, size_t size);
+};
+
+#include "uniformring.inl"
+
+} // namespace Engine
+
+#endif
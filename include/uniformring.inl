@@ -0,0 +1,10 @@
+#ifndef UNIFORM_RING_H
+#include "uniformring.h"
+#endif
+
+template <class T>
+UniformRing::Slice UniformRing::push(T const& block) {
+    Slice s = allocate(traits::block_size<T>::value);
+    traits::pack_std140(block, data(s));
+    return s;
+}
@@ -55,6 +55,21 @@ class VAO {
                                  const gl::GLvoid* offset = NULL,
                                  gl::GLenum type = gl::GL_FLOAT,
                                  bool normalize = false);
+        /**
+          * \brief Set the rate at which the attribute advances during instanced
+          * rendering.
+          * \param index Attribute index
+          * \param divisor Number of instances drawn between two consecutive
+          * attribute values, 0 to advance once per vertex.
+          */
+        void vertexAttribDivisor(gl::GLuint index, gl::GLuint divisor);
+
+        /**
+          * \brief Set the index buffer used by the indexed draws. The binding
+          * is part of the VAO state.
+          * \param indices VBO containing the indices
+          */
+        void elementBuffer(VBO const& indices);
 
     private:
         gl::GLuint m_id;
@@ -2,6 +2,7 @@
 #define VBO_H
 
 #include <glbinding/gl33core/gl.h>
+#include <glbinding/gl/bitfield.h>
 #include <vector>
 
 #include "debug.h"
@@ -44,13 +45,60 @@ class VBO {
 
         void bindBase(gl::GLenum target, unsigned int index);
 
+        /**
+          * \brief Bind a range of the VBO to an indexed binding point.
+          * \param target OpenGL binding point.
+          * \param index Index of the binding point.
+          * \param offset Start of the range, in bytes.
+          * \param size Size of the range, in bytes.
+          */
+        void bindRange(gl::GLenum target, unsigned int index, ptrdiff_t offset, size_t size);
+
+        /**
+          * \brief Allocate storage for the VBO. The previous content is lost.
+          * \param size Size of the buffer, in bytes
+          * \param hint OpenGL buffer usage hint.
+          */
+        void allocate(size_t size, gl::GLenum hint = gl::GL_STATIC_DRAW);
+
+        /**
+          * \brief Replace the storage of the VBO by a new one of the same size
+          * and usage. Commands still using the previous storage don't have to
+          * complete before the buffer is written again, which is how streamed
+          * data should be updated every frame.
+          */
+        void orphan();
+
+        /**
+          * \brief Allocate immutable storage for the VBO, which can't be
+          * reallocated or orphaned afterwards. Requires OpenGL 4.4 or
+          * GL_ARB_buffer_storage.
+          * \param size Size of the buffer, in bytes
+          * \param flags Allowed uses of the storage, such as persistent mapping.
+          */
+        void storage(size_t size, gl::BufferStorageMask flags);
+
+        /**
+          * \brief Return the size of the buffer storage, in bytes.
+          */
+        size_t size() const;
+
         /**
           * \brief Upload data to the VBO.
           * \param data Data array
           * \param hint OpenGL buffer usage hint.
           */
         template <class T>
-        void upload_data(std::vector<T> data, gl::GLenum hint = gl::GL_STATIC_DRAW);
+        void upload_data(std::vector<T> const& data, gl::GLenum hint = gl::GL_STATIC_DRAW);
+
+        /**
+          * \brief Upload data to the VBO from memory the caller owns, such as
+          * a memory-mapped file or a partially filled array.
+          * \param data Start of the data
+          * \param size Size of the data, in bytes
+          * \param hint OpenGL buffer usage hint.
+          */
+        void upload_data(const void* data, size_t size, gl::GLenum hint = gl::GL_STATIC_DRAW);
 
         /**
          * @brief Update a block of data in the buffer
@@ -63,8 +111,51 @@ class VBO {
         template <class T>
         void update_data(T const& data, size_t size, ptrdiff_t offset);
 
+        /**
+          * \brief Copy a block of data from another buffer, on the GPU.
+          * \param src Buffer to copy from, may be this buffer if the ranges
+          * don't overlap.
+          * \param readOffset Start of the block in src, in bytes.
+          * \param writeOffset Where to copy the block in this buffer, in bytes.
+          * \param size Size of the block, in bytes.
+          */
+        void copy_data(VBO const& src, ptrdiff_t readOffset, ptrdiff_t writeOffset, size_t size);
+
+        /**
+          * \brief Read a block of data back from the buffer. This waits for
+          * the commands writing to the buffer to complete.
+          * \param data Where to copy the block.
+          * \param size Size of the block, in bytes.
+          * \param offset Start of the block in the buffer, in bytes.
+          */
+        void read_data(void* data, size_t size, ptrdiff_t offset = 0) const;
+
+        /**
+          * \brief Map a range of the buffer in client memory, for the data to
+          * be written in place instead of being copied from a staging array.
+          * The range must be unmapped before the buffer is used for drawing.
+          * \param offset Start of the range, in bytes.
+          * \param size Size of the range, in bytes.
+          * \param access GL_MAP_INVALIDATE_RANGE_BIT or
+          * GL_MAP_INVALIDATE_BUFFER_BIT when the previous content isn't needed,
+          * and GL_MAP_UNSYNCHRONIZED_BIT when the range isn't used by pending
+          * commands, so that mapping doesn't wait for the GPU.
+          * \return Pointer to the start of the range.
+          */
+        void* map_range(ptrdiff_t offset, size_t size,
+                        gl::BufferAccessMask access = gl::GL_MAP_WRITE_BIT | gl::GL_MAP_INVALIDATE_RANGE_BIT);
+
+        /**
+          * \brief Unmap the buffer.
+          * \return false if the content of the buffer was lost while it was
+          * mapped and must be uploaded again.
+          */
+        bool unmap();
+
     protected:
         gl::GLuint m_id;
+        size_t m_size;
+        gl::GLenum m_hint;
 };
 
 #include "vbo.inl"
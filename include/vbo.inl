@@ -3,10 +3,8 @@
 #endif
 
 template <class T>
-void VBO::upload_data(std::vector<T> data, gl::GLenum hint) {
-    bind();
-    gl::glBufferData(gl::GL_ARRAY_BUFFER, static_cast<gl::GLsizeiptr>(data.size()*sizeof(T)), data.data(), hint);
-    unbind();
+void VBO::upload_data(std::vector<T> const& data, gl::GLenum hint) {
+    upload_data(data.data(), data.size()*sizeof(T), hint);
 }
 
 template <class T>
@@ -0,0 +1,181 @@
+#include "assetloader.h"
+#include "image.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace gl;
+
+namespace Engine {
+
+namespace {
+    std::string readFile(std::string const& file) {
+        std::ifstream in(file);
+        if(!in.is_open())
+            throw std::runtime_error("Failed to open " + file);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+}
+
+AssetLoader::AssetLoader(unsigned int nThreads, double milliseconds, size_t bytes) :
+    m_milliseconds(milliseconds),
+    m_bytes(bytes),
+    m_mutex(),
+    m_cv(),
+    m_uploads(),
+    m_loading(0),
+    m_stats{0, 0, 0.},
+    m_pool(nThreads)
+{ }
+
+AssetLoader::~AssetLoader() { }
+
+void AssetLoader::budget(double milliseconds, size_t bytes) {
+    m_milliseconds = milliseconds;
+    m_bytes = bytes;
+}
+
+Asset<std::vector<std::unique_ptr<Mesh>>>
+AssetLoader::loadMeshes(std::string const& file, SceneImporter::PostProcess pp, MeshBuilder::VertexLayout layout,
+                        MeshBuilder::Quantise quantise, MeshBuilder::Optimize optimize) {
+    using Meshes = std::vector<std::unique_ptr<Mesh>>;
+    Asset<Meshes> asset;
+    asset.m_state = std::make_shared<Asset<Meshes>::State>();
+    auto state = asset.m_state;
+    state->ready = false;
+    submit<Meshes>(state, [file, pp, layout, quantise, optimize, state] () {
+        SceneImporter importer;
+        importer.readFile(file, pp);
+        auto builders = std::make_shared<std::vector<std::unique_ptr<MeshBuilder>>>(
+            importer.prepareMeshes(nullptr, layout, quantise, optimize));
+        auto meshes = std::make_shared<Meshes>();
+        std::vector<Upload> uploads;
+        // One upload per mesh, so that a scene of many meshes is spread over
+        // several frames
+        for(size_t i = 0 ; i != builders->size() ; ++i) {
+            uploads.push_back({(*builders)[i]->uploadSize(), guarded<Meshes>(state, [builders, meshes, i] () {
+                meshes->push_back((*builders)[i]->build_mesh());
+                (*builders)[i].reset();
+            })});
+        }
+        uploads.push_back({0, guarded<Meshes>(state, [meshes, state] () {
+            state->value.reset(new Meshes(std::move(*meshes)));
+            state->ready = true;
+        })});
+        return uploads;
+    });
+    return asset;
+}
+
+Asset<Texture> AssetLoader::loadTexture(std::string const& file) {
+    Asset<Texture> asset;
+    asset.m_state = std::make_shared<Asset<Texture>::State>();
+    auto state = asset.m_state;
+    state->ready = false;
+    submit<Texture>(state, [file, state] () {
+        auto image = std::make_shared<RGBImage>(RGBImage::load(file));
+        size_t bytes = static_cast<size_t>(image->width()) * static_cast<size_t>(image->height()) * 3;
+        return std::vector<Upload>{{bytes, guarded<Texture>(state, [image, state] () {
+            state->value.reset(new Texture(Texture::fromImage(*image)));
+            state->ready = true;
+        })}};
+    });
+    return asset;
+}
+
+Asset<Program> AssetLoader::loadProgram(std::string const& vertexShader, std::string const& fragmentShader,
+                                        std::function<void(ProgramBuilder&)> setup) {
+    Asset<Program> asset;
+    asset.m_state = std::make_shared<Asset<Program>::State>();
+    auto state = asset.m_state;
+    state->ready = false;
+    submit<Program>(state, [vertexShader, fragmentShader, setup, state] () {
+        std::string vs = readFile(vertexShader);
+        std::string fs = readFile(fragmentShader);
+        return std::vector<Upload>{{0, guarded<Program>(state, [vertexShader, fragmentShader, vs, fs, setup,
+                                                                state] () {
+            ProgramBuilder pb;
+            pb.shaderSource(GL_VERTEX_SHADER, vs, vertexShader)
+              .shaderSource(GL_FRAGMENT_SHADER, fs, fragmentShader);
+            if(setup)
+                setup(pb);
+            state->value.reset(new Program(pb.build()));
+            state->ready = true;
+        })}};
+    });
+    return asset;
+}
+
+size_t AssetLoader::update() {
+    auto start = std::chrono::steady_clock::now();
+    m_stats = {0, 0, 0.};
+    while(true) {
+        Upload upload;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_uploads.empty())
+                break;
+            if(m_stats.uploads != 0) {
+                double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                           start).count();
+                if((m_milliseconds > 0. && elapsed >= m_milliseconds) ||
+                   (m_bytes != 0 && m_stats.bytes + m_uploads.front().bytes > m_bytes))
+                    break;
+            }
+            upload = std::move(m_uploads.front());
+            m_uploads.pop_front();
+        }
+        upload.run();
+        ++m_stats.uploads;
+        m_stats.bytes += upload.bytes;
+    }
+    m_stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                     start).count();
+    return m_stats.uploads;
+}
+
+void AssetLoader::finish() {
+    double milliseconds = m_milliseconds;
+    size_t bytes = m_bytes;
+    m_milliseconds = 0.;
+    m_bytes = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] () { return m_loading == 0 || !m_uploads.empty(); });
+            if(m_loading == 0 && m_uploads.empty())
+                break;
+        }
+        update();
+    }
+    m_milliseconds = milliseconds;
+    m_bytes = bytes;
+}
+
+size_t AssetLoader::loading() const {
+    return m_loading;
+}
+
+size_t AssetLoader::queued() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_uploads.size();
+}
+
+AssetLoader::UpdateStats const& AssetLoader::lastUpdate() const { return m_stats; }
+
+void AssetLoader::complete(std::vector<Upload> uploads) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(Upload& u: uploads) {
+            m_uploads.push_back(std::move(u));
+        }
+        --m_loading;
+    }
+    m_cv.notify_all();
+}
+
+} // namespace Engine
@@ -2,6 +2,20 @@
 
 namespace Engine {
 
+int attributeLocation(std::string const& name) {
+    if(name == "v_position")
+        return PositionAttribute;
+    if(name == "v_normal")
+        return NormalAttribute;
+    if(name == "v_color")
+        return ColorAttribute;
+    if(name == "v_texCoord")
+        return TexCoordAttribute;
+    if(name == "i_world")
+        return InstanceWorldAttribute;
+    return -1;
+}
+
 AttributeArray::Layout::Layout() :
     m_nComponents(0),
     m_type(AttributeArray::Type::Float),
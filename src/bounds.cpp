@@ -0,0 +1,269 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TROLL_CULL_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TROLL_CULL_SSE
+#endif
+
+namespace Engine {
+
+AABB::AABB() :
+    m_min(std::numeric_limits<float>::max()),
+    m_max(std::numeric_limits<float>::lowest())
+{ }
+
+AABB::AABB(glm::vec3 const& min, glm::vec3 const& max) :
+    m_min(min),
+    m_max(max)
+{ }
+
+AABB AABB::fromPoints(std::vector<glm::vec3> const& points) {
+    AABB b;
+    for(auto const& p: points) {
+        b.expand(p);
+    }
+    return b;
+}
+
+bool AABB::empty() const {
+    return m_min.x > m_max.x || m_min.y > m_max.y || m_min.z > m_max.z;
+}
+
+glm::vec3 const& AABB::min() const { return m_min; }
+glm::vec3 const& AABB::max() const { return m_max; }
+glm::vec3 AABB::center() const { return (m_min + m_max) * 0.5f; }
+glm::vec3 AABB::extents() const { return (m_max - m_min) * 0.5f; }
+
+void AABB::expand(glm::vec3 const& p) {
+    m_min = glm::min(m_min, p);
+    m_max = glm::max(m_max, p);
+}
+
+void AABB::expand(AABB const& other) {
+    m_min = glm::min(m_min, other.m_min);
+    m_max = glm::max(m_max, other.m_max);
+}
+
+AABB AABB::transformed(glm::mat4 const& m) const {
+    if(empty())
+        return *this;
+    // Transform the center, and project the extents on each axis
+    glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.f));
+    glm::vec3 e = extents();
+    glm::vec3 r(0.f);
+    for(int i = 0 ; i != 3 ; ++i) {
+        for(int j = 0 ; j != 3 ; ++j) {
+            r[i] += std::abs(m[j][i]) * e[j];
+        }
+    }
+    return AABB(c - r, c + r);
+}
+
+BoundingSphere::BoundingSphere() :
+    m_center(0.f),
+    m_radius(-1.f)
+{ }
+
+BoundingSphere::BoundingSphere(glm::vec3 const& center, float radius) :
+    m_center(center),
+    m_radius(radius)
+{ }
+
+BoundingSphere BoundingSphere::fromPoints(std::vector<glm::vec3> const& points) {
+    if(points.empty())
+        return BoundingSphere();
+    glm::vec3 c = AABB::fromPoints(points).center();
+    float r2 = 0.f;
+    for(auto const& p: points) {
+        glm::vec3 d = p - c;
+        r2 = std::max(r2, glm::dot(d, d));
+    }
+    return BoundingSphere(c, std::sqrt(r2));
+}
+
+glm::vec3 const& BoundingSphere::center() const { return m_center; }
+float BoundingSphere::radius() const { return m_radius; }
+bool BoundingSphere::unbounded() const { return m_radius < 0.f; }
+
+BoundingSphere BoundingSphere::transformed(glm::mat4 const& m) const {
+    if(unbounded())
+        return *this;
+    float scale = std::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+                           std::max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+                                    glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))));
+    return BoundingSphere(glm::vec3(m * glm::vec4(m_center, 1.f)), m_radius * std::sqrt(scale));
+}
+
+Frustum::Frustum(glm::mat4 const& m) {
+    // Gribb-Hartmann: the planes are sums and differences of the matrix rows
+    glm::vec4 rows[4];
+    for(int i = 0 ; i != 4 ; ++i) {
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+    m_planes[Left] = rows[3] + rows[0];
+    m_planes[Right] = rows[3] - rows[0];
+    m_planes[Bottom] = rows[3] + rows[1];
+    m_planes[Top] = rows[3] - rows[1];
+    m_planes[Near] = rows[3] + rows[2];
+    m_planes[Far] = rows[3] - rows[2];
+    for(auto& p: m_planes) {
+        p = p / glm::length(glm::vec3(p));
+    }
+}
+
+glm::vec4 const& Frustum::plane(int i) const { return m_planes[i]; }
+
+bool Frustum::intersects(BoundingSphere const& s) const {
+    if(s.unbounded())
+        return true;
+    for(auto const& p: m_planes) {
+        if(glm::dot(glm::vec3(p), s.center()) + p.w < -s.radius())
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(AABB const& b) const {
+    if(b.empty())
+        return false;
+    glm::vec3 c = b.center(), e = b.extents();
+    for(auto const& p: m_planes) {
+        float r = e.x * std::abs(p.x) + e.y * std::abs(p.y) + e.z * std::abs(p.z);
+        if(glm::dot(glm::vec3(p), c) + p.w < -r)
+            return false;
+    }
+    return true;
+}
+
+void SphereArray::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    r.clear();
+}
+
+void SphereArray::resize(size_t n) {
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+    r.resize(n, -1.f);
+}
+
+size_t SphereArray::size() const { return r.size(); }
+
+void SphereArray::set(size_t i, BoundingSphere const& s) {
+    x[i] = s.center().x;
+    y[i] = s.center().y;
+    z[i] = s.center().z;
+    r[i] = s.radius();
+}
+
+BoundingSphere SphereArray::get(size_t i) const {
+    return BoundingSphere(glm::vec3(x[i], y[i], z[i]), r[i]);
+}
+
+namespace {
+    inline bool cullSphere(Frustum const& f, float x, float y, float z, float r, float minSize) {
+        if(r < 0.f)
+            return true;
+        float nearDist = 0.f;
+        for(int i = 0 ; i != 6 ; ++i) {
+            glm::vec4 const& p = f.plane(i);
+            // Same evaluation order as the SIMD paths
+            float d = (p.x * x + p.y * y) + (p.z * z + p.w);
+            if(d < -r)
+                return false;
+            if(i == Frustum::Near)
+                nearDist = d;
+        }
+        return r >= minSize * nearDist;
+    }
+}
+
+size_t cullSpheresScalar(Frustum const& f, const float* x, const float* y, const float* z, const float* r,
+                         size_t n, float minSize, std::uint8_t* visible) {
+    size_t count = 0;
+    for(size_t i = 0 ; i != n ; ++i) {
+        visible[i] = cullSphere(f, x[i], y[i], z[i], r[i], minSize);
+        count += visible[i];
+    }
+    return count;
+}
+
+size_t cullSpheres(Frustum const& f, const float* x, const float* y, const float* z, const float* r,
+                   size_t n, float minSize, std::uint8_t* visible) {
+    size_t i = 0, count = 0;
+#if defined(TROLL_CULL_AVX)
+    __m256 a[6], b[6], c[6], d[6];
+    for(int p = 0 ; p != 6 ; ++p) {
+        a[p] = _mm256_set1_ps(f.plane(p).x);
+        b[p] = _mm256_set1_ps(f.plane(p).y);
+        c[p] = _mm256_set1_ps(f.plane(p).z);
+        d[p] = _mm256_set1_ps(f.plane(p).w);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 size = _mm256_set1_ps(minSize);
+    for( ; i + 8 <= n ; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i),
+               vz = _mm256_loadu_ps(z + i), vr = _mm256_loadu_ps(r + i);
+        __m256 negR = _mm256_sub_ps(zero, vr);
+        __m256 inside = _mm256_cmp_ps(vr, vr, _CMP_EQ_OQ);
+        __m256 nearDist = zero;
+        for(int p = 0 ; p != 6 ; ++p) {
+            __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[p], vx), _mm256_mul_ps(b[p], vy)),
+                                        _mm256_add_ps(_mm256_mul_ps(c[p], vz), d[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negR, _CMP_GE_OQ));
+            if(p == Frustum::Near)
+                nearDist = dist;
+        }
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(vr, _mm256_mul_ps(size, nearDist), _CMP_GE_OQ));
+        inside = _mm256_or_ps(inside, _mm256_cmp_ps(vr, zero, _CMP_LT_OQ));
+        int mask = _mm256_movemask_ps(inside);
+        for(int k = 0 ; k != 8 ; ++k) {
+            visible[i + k] = (mask >> k) & 1;
+            count += visible[i + k];
+        }
+    }
+#elif defined(TROLL_CULL_SSE)
+    __m128 a[6], b[6], c[6], d[6];
+    for(int p = 0 ; p != 6 ; ++p) {
+        a[p] = _mm_set1_ps(f.plane(p).x);
+        b[p] = _mm_set1_ps(f.plane(p).y);
+        c[p] = _mm_set1_ps(f.plane(p).z);
+        d[p] = _mm_set1_ps(f.plane(p).w);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 size = _mm_set1_ps(minSize);
+    for( ; i + 4 <= n ; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i),
+               vz = _mm_loadu_ps(z + i), vr = _mm_loadu_ps(r + i);
+        __m128 negR = _mm_sub_ps(zero, vr);
+        __m128 inside = _mm_cmpeq_ps(vr, vr);
+        __m128 nearDist = zero;
+        for(int p = 0 ; p != 6 ; ++p) {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[p], vx), _mm_mul_ps(b[p], vy)),
+                                     _mm_add_ps(_mm_mul_ps(c[p], vz), d[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+            if(p == Frustum::Near)
+                nearDist = dist;
+        }
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(vr, _mm_mul_ps(size, nearDist)));
+        inside = _mm_or_ps(inside, _mm_cmplt_ps(vr, zero));
+        int mask = _mm_movemask_ps(inside);
+        for(int k = 0 ; k != 4 ; ++k) {
+            visible[i + k] = (mask >> k) & 1;
+            count += visible[i + k];
+        }
+    }
+#endif
+    return count + cullSpheresScalar(f, x + i, y + i, z + i, r + i, n - i, minSize, visible + i);
+}
+
+} // namespace Engine
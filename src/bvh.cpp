@@ -0,0 +1,410 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace Engine {
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    const int nBins = 16;
+    const int maxLeafSize = 4;
+    /* Leaves are forced to split past this size even if the SAH disagrees */
+    const int maxLeafSizeForced = 16;
+    /* Cost of traversing a node relative to testing an item */
+    const float traversalCost = 1.f;
+
+    double elapsed(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    bool sameBox(AABB const& a, AABB const& b) {
+        return a.min() == b.min() && a.max() == b.max();
+    }
+
+    bool overlaps(AABB const& a, AABB const& b) {
+        return a.min().x <= b.max().x && a.max().x >= b.min().x &&
+               a.min().y <= b.max().y && a.max().y >= b.min().y &&
+               a.min().z <= b.max().z && a.max().z >= b.min().z;
+    }
+
+    /* Slab test, return the entry parameter or infinity if the box is missed */
+    float intersect(AABB const& b, glm::vec3 const& origin, glm::vec3 const& invDir, float tMax) {
+        float tMin = 0.f;
+        for(int i = 0 ; i != 3 ; ++i) {
+            float t0 = (b.min()[i] - origin[i]) * invDir[i];
+            float t1 = (b.max()[i] - origin[i]) * invDir[i];
+            if(t0 > t1)
+                std::swap(t0, t1);
+            // NaN when the origin lies on a slab of a parallel ray, keep the bounds
+            tMin = (t0 > tMin) ? t0 : tMin;
+            tMax = (t1 < tMax) ? t1 : tMax;
+            if(tMin > tMax)
+                return std::numeric_limits<float>::infinity();
+        }
+        return tMin;
+    }
+
+    /* Box used during the build, cheaper to grow than an AABB */
+    struct Box {
+        float min[3];
+        float max[3];
+
+        Box() : min{inf, inf, inf}, max{-inf, -inf, -inf} { }
+
+        void grow(Box const& b) {
+            for(int i = 0 ; i != 3 ; ++i) {
+                min[i] = (b.min[i] < min[i]) ? b.min[i] : min[i];
+                max[i] = (b.max[i] > max[i]) ? b.max[i] : max[i];
+            }
+        }
+
+        void grow(float const* p) {
+            for(int i = 0 ; i != 3 ; ++i) {
+                min[i] = (p[i] < min[i]) ? p[i] : min[i];
+                max[i] = (p[i] > max[i]) ? p[i] : max[i];
+            }
+        }
+
+        float area() const {
+            if(min[0] > max[0])
+                return 0.f;
+            float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+            return 2.f * (dx * dy + dy * dz + dz * dx);
+        }
+
+        AABB aabb() const {
+            return AABB(glm::vec3(min[0], min[1], min[2]), glm::vec3(max[0], max[1], max[2]));
+        }
+
+        static const float inf;
+    };
+
+    const float Box::inf = std::numeric_limits<float>::infinity();
+
+    struct Bin {
+        Box box;
+        int count;
+    };
+
+    /* Item during the build */
+    struct Ref {
+        Box box;
+        float center[3];
+        int item;
+    };
+}
+
+BVH::BVH() :
+    m_nodes(),
+    m_items(),
+    m_boxes(),
+    m_leaves(),
+    m_timings{0., 0., 0.}
+{ }
+
+void BVH::build(std::vector<AABB> const& boxes) {
+    auto start = Clock::now();
+    m_nodes.clear();
+    m_items.clear();
+    m_boxes = boxes;
+    m_leaves.assign(boxes.size(), -1);
+
+    /* The items are partitioned by value rather than through their indices,
+     * so that every pass reads contiguous memory */
+    std::vector<Ref> refs;
+    refs.reserve(boxes.size());
+    for(size_t i = 0 ; i != boxes.size() ; ++i) {
+        if(boxes[i].empty())
+            continue;
+        Ref r;
+        for(int k = 0 ; k != 3 ; ++k) {
+            r.box.min[k] = boxes[i].min()[k];
+            r.box.max[k] = boxes[i].max()[k];
+            r.center[k] = 0.5f * (r.box.min[k] + r.box.max[k]);
+        }
+        r.item = static_cast<int>(i);
+        refs.push_back(r);
+    }
+    if(refs.empty()) {
+        m_timings.build = elapsed(start);
+        return;
+    }
+    m_nodes.reserve(2 * refs.size() / maxLeafSize + 1);
+    m_nodes.push_back({AABB(), 0, static_cast<int>(refs.size()), -1});
+
+    std::vector<int> stack(1, 0);
+    Bin bins[3][nBins];
+    Box leftBoxes[nBins];
+    int leftCounts[nBins];
+    while(!stack.empty()) {
+        int n = stack.back();
+        stack.pop_back();
+        int first = m_nodes[n].first, count = m_nodes[n].count;
+        auto begin = refs.begin() + first, end = begin + count;
+
+        Box box, centerBox;
+        for(auto it = begin ; it != end ; ++it) {
+            box.grow(it->box);
+            centerBox.grow(it->center);
+        }
+        m_nodes[n].box = box.aabb();
+
+        /* Binned SAH: bin the item centers along each axis, and evaluate the
+         * cost of splitting between each pair of bins. */
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1, bestSplit = 0;
+        float extent[3], scale[3];
+        for(int axis = 0 ; axis != 3 ; ++axis) {
+            extent[axis] = centerBox.max[axis] - centerBox.min[axis];
+            scale[axis] = (extent[axis] > 0.f) ? nBins / extent[axis] : 0.f;
+        }
+        if(count > 2) {
+            // A single pass bins the items along the three axes
+            for(auto& axisBins: bins) {
+                for(auto& b: axisBins) {
+                    b = {Box(), 0};
+                }
+            }
+            for(auto it = begin ; it != end ; ++it) {
+                for(int axis = 0 ; axis != 3 ; ++axis) {
+                    int b = std::min(nBins - 1, static_cast<int>((it->center[axis] - centerBox.min[axis]) * scale[axis]));
+                    bins[axis][b].box.grow(it->box);
+                    ++bins[axis][b].count;
+                }
+            }
+        }
+        for(int axis = 0 ; axis != 3 && count > 2 ; ++axis) {
+            if(extent[axis] <= 0.f)
+                continue;
+            Box acc;
+            int accCount = 0;
+            for(int b = 0 ; b != nBins - 1 ; ++b) {
+                acc.grow(bins[axis][b].box);
+                accCount += bins[axis][b].count;
+                leftBoxes[b] = acc;
+                leftCounts[b] = accCount;
+            }
+            acc = Box();
+            accCount = 0;
+            for(int b = nBins - 1 ; b != 0 ; --b) {
+                acc.grow(bins[axis][b].box);
+                accCount += bins[axis][b].count;
+                float cost = leftBoxes[b - 1].area() * leftCounts[b - 1] + acc.area() * accCount;
+                if(cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        float area = box.area();
+        float leafCost = static_cast<float>(count);
+        float splitCost = traversalCost + ((area > 0.f) ? bestCost / area : leafCost);
+        int mid;
+        if(bestAxis != -1 && (splitCost < leafCost || count > maxLeafSize)) {
+            float origin = centerBox.min[bestAxis];
+            auto it = std::partition(begin, end, [&] (Ref const& r) {
+                return std::min(nBins - 1, static_cast<int>((r.center[bestAxis] - origin) * scale[bestAxis])) < bestSplit;
+            });
+            mid = static_cast<int>(it - refs.begin());
+        }
+        else if(count > maxLeafSizeForced) {
+            // Every center in the same spot, split in the middle of the list
+            mid = first + count / 2;
+        }
+        else {
+            for(auto it = begin ; it != end ; ++it) {
+                m_leaves[it->item] = n;
+            }
+            continue;
+        }
+
+        int left = static_cast<int>(m_nodes.size());
+        m_nodes[n].first = left;
+        m_nodes[n].count = 0;
+        m_nodes.push_back({AABB(), first, mid - first, n});
+        m_nodes.push_back({AABB(), mid, first + count - mid, n});
+        stack.push_back(left + 1);
+        stack.push_back(left);
+    }
+    m_items.resize(refs.size());
+    for(size_t i = 0 ; i != refs.size() ; ++i) {
+        m_items[i] = refs[i].item;
+    }
+    m_timings.build = elapsed(start);
+}
+
+AABB BVH::nodeBox(Node const& n) const {
+    if(n.count == 0) {
+        AABB box = m_nodes[n.first].box;
+        box.expand(m_nodes[n.first + 1].box);
+        return box;
+    }
+    AABB box;
+    for(int i = n.first ; i != n.first + n.count ; ++i) {
+        box.expand(m_boxes[m_items[i]]);
+    }
+    return box;
+}
+
+void BVH::refit(std::vector<AABB> const& boxes) {
+    auto start = Clock::now();
+    m_boxes = boxes;
+    // Children are stored after their parent
+    for(auto it = m_nodes.rbegin() ; it != m_nodes.rend() ; ++it) {
+        it->box = nodeBox(*it);
+    }
+    m_timings.refit = elapsed(start);
+}
+
+void BVH::refit(std::vector<AABB> const& boxes, std::vector<int> const& items) {
+    auto start = Clock::now();
+    for(int i: items) {
+        m_boxes[i] = boxes[i];
+    }
+    for(int i: items) {
+        int n = m_leaves[i];
+        /* Stop walking up once a box doesn't change, the ancestors are then
+         * already up to date */
+        while(n != -1) {
+            AABB box = nodeBox(m_nodes[n]);
+            if(sameBox(box, m_nodes[n].box))
+                break;
+            m_nodes[n].box = box;
+            n = m_nodes[n].parent;
+        }
+    }
+    m_timings.refit = elapsed(start);
+}
+
+void BVH::query(Frustum const& f, std::vector<int>& items) const {
+    auto start = Clock::now();
+    if(m_nodes.empty()) {
+        m_timings.query = 0.;
+        return;
+    }
+    /* The mask holds the planes the node may still cross. Once a node is
+     * inside every plane, its whole subtree is accepted without testing. */
+    struct Entry {
+        int node;
+        unsigned int mask;
+    };
+    std::vector<Entry> stack(1, {0, 0x3fu});
+    while(!stack.empty()) {
+        Entry e = stack.back();
+        stack.pop_back();
+        Node const& n = m_nodes[e.node];
+        glm::vec3 c = n.box.center(), ext = n.box.extents();
+        unsigned int mask = e.mask;
+        bool outside = false;
+        for(int p = 0 ; p != 6 ; ++p) {
+            if(!(mask & (1u << p)))
+                continue;
+            glm::vec4 const& plane = f.plane(p);
+            float d = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+            float r = ext.x * std::abs(plane.x) + ext.y * std::abs(plane.y) + ext.z * std::abs(plane.z);
+            if(d < -r) {
+                outside = true;
+                break;
+            }
+            if(d >= r)
+                mask &= ~(1u << p);
+        }
+        if(outside)
+            continue;
+        if(n.count != 0) {
+            for(int i = n.first ; i != n.first + n.count ; ++i) {
+                if(!mask || f.intersects(m_boxes[m_items[i]]))
+                    items.push_back(m_items[i]);
+            }
+        }
+        else {
+            stack.push_back({n.first + 1, mask});
+            stack.push_back({n.first, mask});
+        }
+    }
+    m_timings.query = elapsed(start);
+}
+
+void BVH::query(AABB const& region, std::vector<int>& items) const {
+    auto start = Clock::now();
+    std::vector<int> stack;
+    if(!m_nodes.empty())
+        stack.push_back(0);
+    while(!stack.empty()) {
+        Node const& n = m_nodes[stack.back()];
+        stack.pop_back();
+        if(!overlaps(n.box, region))
+            continue;
+        if(n.count != 0) {
+            for(int i = n.first ; i != n.first + n.count ; ++i) {
+                if(overlaps(m_boxes[m_items[i]], region))
+                    items.push_back(m_items[i]);
+            }
+        }
+        else {
+            stack.push_back(n.first + 1);
+            stack.push_back(n.first);
+        }
+    }
+    m_timings.query = elapsed(start);
+}
+
+int BVH::raycast(glm::vec3 const& origin, glm::vec3 const& direction, float* t) const {
+    auto start = Clock::now();
+    glm::vec3 invDir(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+    float best = std::numeric_limits<float>::infinity();
+    int hit = -1;
+    std::vector<std::pair<int, float>> stack;
+    if(!m_nodes.empty())
+        stack.push_back({0, intersect(m_nodes[0].box, origin, invDir, best)});
+    while(!stack.empty()) {
+        auto e = stack.back();
+        stack.pop_back();
+        if(e.second >= best)
+            continue;
+        Node const& n = m_nodes[e.first];
+        if(n.count != 0) {
+            for(int i = n.first ; i != n.first + n.count ; ++i) {
+                float ti = intersect(m_boxes[m_items[i]], origin, invDir, best);
+                if(ti < best) {
+                    best = ti;
+                    hit = m_items[i];
+                }
+            }
+            continue;
+        }
+        /* Visit the nearest child first, so that the farthest one is likely
+         * pruned */
+        float tl = intersect(m_nodes[n.first].box, origin, invDir, best);
+        float tr = intersect(m_nodes[n.first + 1].box, origin, invDir, best);
+        std::pair<int, float> near(n.first, tl), far(n.first + 1, tr);
+        if(tr < tl)
+            std::swap(near, far);
+        if(far.second < best)
+            stack.push_back(far);
+        if(near.second < best)
+            stack.push_back(near);
+    }
+    if(t && hit != -1)
+        *t = best;
+    m_timings.query = elapsed(start);
+    return hit;
+}
+
+size_t BVH::size() const { return m_items.size(); }
+size_t BVH::nodeCount() const { return m_nodes.size(); }
+
+AABB const& BVH::bounds() const {
+    static const AABB empty;
+    return m_nodes.empty() ? empty : m_nodes[0].box;
+}
+
+BVH::Timings const& BVH::timings() const { return m_timings; }
+
+} // namespace Engine
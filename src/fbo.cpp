@@ -1,5 +1,6 @@
 #include "fbo.h"
 #include "debug.h"
+#include "glstate.h"
 
 using namespace gl;
 
@@ -12,8 +13,10 @@ FBO::FBO() :
 }
 
 FBO::~FBO() {
-    if(m_id)
+    if(m_id) {
+        GLState::framebufferDeleted(m_id);
         glDeleteFramebuffers(1, &m_id);
+    }
 }
 
 FBO::FBO(FBO&& other) :
@@ -29,11 +32,11 @@ FBO& FBO::operator=(FBO&& other) {
 }
 
 void FBO::bind(GLenum const& t) {
-    glBindFramebuffer(t, m_id);
+    GLState::bindFramebuffer(t, m_id);
 }
 
 void FBO::bind_default(GLenum const& t) {
-    glBindFramebuffer(t, 0);
+    GLState::bindFramebuffer(t, 0);
 }
 
 void FBO::attach(GLenum t, GLenum a, Texture& tex, GLint layer) {
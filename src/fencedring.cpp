@@ -0,0 +1,97 @@
+#include "fencedring.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <glbinding/gl/functions.h>
+
+using namespace gl;
+
+namespace Engine {
+
+FencedRing::FencedRing(std::string const& name, size_t size, unsigned int frames, Upload upload) :
+    m_name(name),
+    m_size(size),
+    m_maxFrames(std::max(frames, 1u)),
+    m_upload(std::move(upload)),
+    m_head(0),
+    m_used(0),
+    m_frameBytes(0),
+    m_flushed(0),
+    m_unflushed(0),
+    m_frames(),
+    m_waits(0)
+{ }
+
+FencedRing::~FencedRing() {
+    for(Frame& f: m_frames) {
+        glDeleteSync(f.fence);
+    }
+}
+
+size_t FencedRing::allocate(size_t size, size_t alignment) {
+    if(size > m_size)
+        throw std::runtime_error(m_name + " overflow: the range is larger than the ring.");
+    size_t offset = (m_head + alignment - 1) / alignment * alignment;
+    size_t needed = offset + size - m_head;
+    if(offset + size > m_size) {
+        // The end of the buffer is too short, skip it
+        needed = m_size - m_head + size;
+        offset = 0;
+    }
+    while(m_used + needed > m_size) {
+        if(m_frames.empty())
+            throw std::runtime_error(m_name + " overflow: the allocations of a frame don't fit in the ring.");
+        releaseFrame();
+    }
+    if(offset == 0 && m_head != 0 && m_unflushed != 0) {
+        // Flush the bytes before the wrap, so that the unflushed bytes stay contiguous
+        flush();
+    }
+    if(m_unflushed == 0)
+        m_flushed = offset;
+    m_head = offset + size;
+    m_used += needed;
+    m_frameBytes += needed;
+    m_unflushed = m_head - m_flushed;
+    return offset;
+}
+
+void FencedRing::flush() {
+    if(m_unflushed == 0)
+        return;
+    m_upload(m_flushed, m_unflushed);
+    m_flushed = m_head;
+    m_unflushed = 0;
+}
+
+void FencedRing::endFrame() {
+    flush();
+    if(m_frameBytes == 0)
+        return;
+    m_frames.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_NONE_BIT), m_frameBytes});
+    m_frameBytes = 0;
+    while(m_frames.size() > m_maxFrames) {
+        releaseFrame();
+    }
+}
+
+size_t FencedRing::size() const { return m_size; }
+size_t FencedRing::used() const { return m_used; }
+size_t FencedRing::waits() const { return m_waits; }
+
+void FencedRing::releaseFrame() {
+    Frame f = m_frames.front();
+    m_frames.pop_front();
+    GLenum status = glClientWaitSync(f.fence, SyncObjectMask::GL_NONE_BIT, 0);
+    if(status == GL_TIMEOUT_EXPIRED) {
+        ++m_waits;
+        // Flush the commands on the first wait only, or the fence may never signal
+        SyncObjectMask flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while(glClientWaitSync(f.fence, flags, 1000000) == GL_TIMEOUT_EXPIRED)
+            flags = SyncObjectMask::GL_NONE_BIT;
+    }
+    glDeleteSync(f.fence);
+    m_used -= f.bytes;
+}
+
+} // namespace Engine
@@ -0,0 +1,311 @@
+#include "glstate.h"
+#include "program.h"
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+using namespace gl;
+
+namespace Engine {
+
+namespace {
+    GLState::Counters s_counters = {0, 0};
+
+    /* A cached GL state value, unknown until it is first set */
+    template <class T>
+    struct Cached {
+        T value;
+        bool known;
+
+        Cached() : value(), known(false) { }
+
+        /* Update the value, return true if the GL call must be issued */
+        bool set(T const& v) {
+            if(known && value == v) {
+                ++s_counters.skipped;
+                return false;
+            }
+            value = v;
+            known = true;
+            ++s_counters.issued;
+            return true;
+        }
+
+        /* Forget the value if it refers to the object that is deleted */
+        void forget(T const& v) {
+            if(value == v)
+                known = false;
+        }
+    };
+
+    struct BufferRange {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+
+        bool operator==(BufferRange const& other) const {
+            return buffer == other.buffer && offset == other.offset && size == other.size;
+        }
+    };
+
+    struct State {
+        Cached<GLuint> program;
+        Cached<GLuint> vao;
+        Cached<GLuint> drawFramebuffer;
+        Cached<GLuint> readFramebuffer;
+        std::map<GLenum, Cached<GLuint>> buffers;
+        /* GL_ELEMENT_ARRAY_BUFFER binding of each VAO, a missing entry is unknown */
+        std::unordered_map<GLuint, GLuint> elementBuffers;
+        std::map<std::pair<GLenum, GLuint>, Cached<BufferRange>> indexedBuffers;
+        Cached<unsigned int> activeTexture;
+        std::map<std::pair<unsigned int, GLenum>, Cached<GLuint>> textures;
+        Cached<bool> blend;
+        Cached<std::pair<GLenum, GLenum>> blendFunc;
+        Cached<GLenum> blendEquation;
+        Cached<bool> depthTest;
+        Cached<bool> depthWrite;
+        Cached<GLenum> depthFunc;
+        Cached<bool> cull;
+        Cached<GLenum> cullFace;
+        Cached<GLenum> frontFace;
+    };
+
+    State s_state;
+
+    void setCapability(Cached<bool>& cache, GLenum cap, bool enable) {
+        if(cache.set(enable)) {
+            if(enable)
+                glEnable(cap);
+            else
+                glDisable(cap);
+        }
+    }
+}
+
+BlendState::BlendState(bool enabled, GLenum src, GLenum dst, GLenum equation) :
+    m_enabled(enabled),
+    m_src(src),
+    m_dst(dst),
+    m_equation(equation)
+{ }
+
+BlendState BlendState::opaque() { return BlendState(false); }
+BlendState BlendState::alpha() { return BlendState(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); }
+BlendState BlendState::additive() { return BlendState(true, GL_ONE, GL_ONE); }
+
+bool BlendState::enabled() const { return m_enabled; }
+GLenum BlendState::src() const { return m_src; }
+GLenum BlendState::dst() const { return m_dst; }
+GLenum BlendState::equation() const { return m_equation; }
+
+void BlendState::apply() const { GLState::apply(*this); }
+
+DepthState::DepthState(bool test, bool write, GLenum func) :
+    m_test(test),
+    m_write(write),
+    m_func(func)
+{ }
+
+DepthState DepthState::disabled() { return DepthState(false, false); }
+DepthState DepthState::readOnly() { return DepthState(true, false); }
+
+bool DepthState::test() const { return m_test; }
+bool DepthState::write() const { return m_write; }
+GLenum DepthState::func() const { return m_func; }
+
+void DepthState::apply() const { GLState::apply(*this); }
+
+CullState::CullState(bool enabled, GLenum face, GLenum frontFace) :
+    m_enabled(enabled),
+    m_face(face),
+    m_frontFace(frontFace)
+{ }
+
+CullState CullState::back() { return CullState(true); }
+
+bool CullState::enabled() const { return m_enabled; }
+GLenum CullState::face() const { return m_face; }
+GLenum CullState::frontFace() const { return m_frontFace; }
+
+void CullState::apply() const { GLState::apply(*this); }
+
+PipelineState::PipelineState(Program const* program, BlendState const& blend, DepthState const& depth,
+                             CullState const& cull) :
+    m_program(program),
+    m_blend(blend),
+    m_depth(depth),
+    m_cull(cull)
+{ }
+
+Program const* PipelineState::program() const { return m_program; }
+BlendState const& PipelineState::blend() const { return m_blend; }
+DepthState const& PipelineState::depth() const { return m_depth; }
+CullState const& PipelineState::cull() const { return m_cull; }
+
+void PipelineState::apply() const {
+    if(m_program)
+        m_program->use();
+    GLState::apply(m_blend);
+    GLState::apply(m_depth);
+    GLState::apply(m_cull);
+}
+
+void GLState::useProgram(GLuint program) {
+    if(s_state.program.set(program))
+        glUseProgram(program);
+}
+
+void GLState::bindVertexArray(GLuint vao) {
+    if(s_state.vao.set(vao))
+        glBindVertexArray(vao);
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+    if(target == GL_ELEMENT_ARRAY_BUFFER) {
+        if(!s_state.vao.known) {
+            ++s_counters.issued;
+            glBindBuffer(target, buffer);
+            return;
+        }
+        auto it = s_state.elementBuffers.find(s_state.vao.value);
+        if(it != s_state.elementBuffers.end() && it->second == buffer) {
+            ++s_counters.skipped;
+            return;
+        }
+        s_state.elementBuffers[s_state.vao.value] = buffer;
+        ++s_counters.issued;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if(s_state.buffers[target].set(buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    // -1 stands for the whole buffer
+    if(s_state.indexedBuffers[std::make_pair(target, index)].set({buffer, 0, -1})) {
+        glBindBufferBase(target, index, buffer);
+        // Also binds the generic binding point
+        s_state.buffers[target].value = buffer;
+        s_state.buffers[target].known = true;
+    }
+}
+
+void GLState::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    if(s_state.indexedBuffers[std::make_pair(target, index)].set({buffer, offset, size})) {
+        glBindBufferRange(target, index, buffer, offset, size);
+        s_state.buffers[target].value = buffer;
+        s_state.buffers[target].known = true;
+    }
+}
+
+void GLState::activeTexture(unsigned int unit) {
+    if(s_state.activeTexture.set(unit))
+        glActiveTexture(static_cast<GLenum>(static_cast<unsigned int>(GL_TEXTURE0) + unit));
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture) {
+    if(!s_state.activeTexture.known) {
+        GLint unit = 0;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &unit);
+        s_state.activeTexture.value = static_cast<unsigned int>(unit) - static_cast<unsigned int>(GL_TEXTURE0);
+        s_state.activeTexture.known = true;
+    }
+    if(s_state.textures[std::make_pair(s_state.activeTexture.value, target)].set(texture))
+        glBindTexture(target, texture);
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint fbo) {
+    if(target == GL_FRAMEBUFFER) {
+        if(s_state.drawFramebuffer.known && s_state.drawFramebuffer.value == fbo &&
+           s_state.readFramebuffer.known && s_state.readFramebuffer.value == fbo) {
+            ++s_counters.skipped;
+            return;
+        }
+        s_state.drawFramebuffer.value = s_state.readFramebuffer.value = fbo;
+        s_state.drawFramebuffer.known = s_state.readFramebuffer.known = true;
+        ++s_counters.issued;
+        glBindFramebuffer(target, fbo);
+        return;
+    }
+    Cached<GLuint>& cache = (target == GL_READ_FRAMEBUFFER) ? s_state.readFramebuffer : s_state.drawFramebuffer;
+    if(cache.set(fbo))
+        glBindFramebuffer(target, fbo);
+}
+
+void GLState::apply(BlendState const& state) {
+    setCapability(s_state.blend, GL_BLEND, state.enabled());
+    if(!state.enabled())
+        return;
+    if(s_state.blendFunc.set(std::make_pair(state.src(), state.dst())))
+        glBlendFunc(state.src(), state.dst());
+    if(s_state.blendEquation.set(state.equation()))
+        glBlendEquation(state.equation());
+}
+
+void GLState::apply(DepthState const& state) {
+    setCapability(s_state.depthTest, GL_DEPTH_TEST, state.test());
+    if(s_state.depthWrite.set(state.write()))
+        glDepthMask(state.write() ? GL_TRUE : GL_FALSE);
+    if(state.test() && s_state.depthFunc.set(state.func()))
+        glDepthFunc(state.func());
+}
+
+void GLState::apply(CullState const& state) {
+    setCapability(s_state.cull, GL_CULL_FACE, state.enabled());
+    if(!state.enabled())
+        return;
+    if(s_state.cullFace.set(state.face()))
+        glCullFace(state.face());
+    if(s_state.frontFace.set(state.frontFace()))
+        glFrontFace(state.frontFace());
+}
+
+void GLState::programDeleted(GLuint program) {
+    s_state.program.forget(program);
+}
+
+void GLState::vertexArrayDeleted(GLuint vao) {
+    s_state.vao.forget(vao);
+    s_state.elementBuffers.erase(vao);
+}
+
+void GLState::bufferDeleted(GLuint buffer) {
+    for(auto& b: s_state.buffers) {
+        b.second.forget(buffer);
+    }
+    for(auto it = s_state.elementBuffers.begin() ; it != s_state.elementBuffers.end() ; ) {
+        if(it->second == buffer)
+            it = s_state.elementBuffers.erase(it);
+        else
+            ++it;
+    }
+    for(auto& b: s_state.indexedBuffers) {
+        if(b.second.value.buffer == buffer)
+            b.second.known = false;
+    }
+}
+
+void GLState::textureDeleted(GLuint texture) {
+    for(auto& t: s_state.textures) {
+        t.second.forget(texture);
+    }
+}
+
+void GLState::framebufferDeleted(GLuint fbo) {
+    s_state.drawFramebuffer.forget(fbo);
+    s_state.readFramebuffer.forget(fbo);
+}
+
+void GLState::invalidate() {
+    s_state = State();
+}
+
+GLState::Counters const& GLState::counters() { return s_counters; }
+
+void GLState::resetCounters() {
+    s_counters = {0, 0};
+}
+
+} // namespace Engine
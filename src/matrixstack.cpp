@@ -23,12 +23,7 @@ glm::mat4 const& MatrixStack::top() const {
 }
 
 void MatrixStack::push(glm::mat4 const& m) {
-    glm::mat4 m2;
-    m2[0] = glm::normalize(m_current[0]);
-    m2[1] = glm::normalize(m_current[1]);
-    m2[2] = glm::normalize(m_current[2]);
-    m2[3] = m[3];
-    m_current = m * m2;
+    m_current = compose(m_current, m);
     stack::push(m_current);
 }
 
@@ -38,3 +33,12 @@ void MatrixStack::pop() {
         m_current = stack::top();
     }
 }
+
+glm::mat4 MatrixStack::compose(glm::mat4 const& parent, glm::mat4 const& m) {
+    glm::mat4 m2;
+    m2[0] = glm::normalize(parent[0]);
+    m2[1] = glm::normalize(parent[1]);
+    m2[2] = glm::normalize(parent[2]);
+    m2[3] = m[3];
+    return m * m2;
+}
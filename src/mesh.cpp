@@ -2,32 +2,95 @@
 #include "debug.h"
 #include "scenegraph.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
 using namespace gl;
 using namespace std;
 
 namespace Engine {
 
+namespace {
+    bool quantised(MeshBuilder::Quantise flags, MeshBuilder::Quantise q) {
+        return (flags & q) != MeshBuilder::Quantise::None;
+    }
+
+    template <class T>
+    void append(std::vector<char>& data, T const& value) {
+        size_t size = data.size();
+        data.resize(size + sizeof(T));
+        std::memcpy(&data[size], &value, sizeof(T));
+    }
+}
+
 Mesh::Mesh(std::string const& name, AttributeMap attribs, std::vector<std::unique_ptr<VBO>>&& resources,
-           unsigned int nVerts, unsigned int nIndices) :
+           unsigned int nVerts, unsigned int nIndices, AABB const& aabb, BoundingSphere const& sphere,
+           MeshArena* arena, MeshArena::Allocation* allocation) :
     m_name(name),
     m_attribs(std::move(attribs)),
     m_resources(std::move(resources)),
     m_nVertices(nVerts),
-    m_nIndices(nIndices) { }
+    m_nIndices(nIndices),
+    m_aabb(aabb),
+    m_sphere(sphere),
+    m_arena(arena),
+    m_allocation(allocation),
+    m_vertexBytes(0),
+    m_indexBytes(0),
+    m_quantisationError{0.f, 0.f, 0.f, 0.f},
+    m_positionTransform(1.f),
+    m_vertexCacheReport{{0.f, 0.f}, {0.f, 0.f}},
+    m_vao() { }
 
-Mesh::~Mesh() { }
+Mesh::~Mesh() {
+    if(m_arena)
+        m_arena->release(m_allocation);
+}
 
 Mesh::Mesh(Mesh&& other) :
     m_name(std::move(other.m_name)),
     m_attribs(std::move(other.m_attribs)),
     m_resources(std::move(other.m_resources)),
     m_nVertices(other.m_nVertices),
-    m_nIndices(other.m_nIndices) { }
+    m_nIndices(other.m_nIndices),
+    m_aabb(other.m_aabb),
+    m_sphere(other.m_sphere),
+    m_arena(other.m_arena),
+    m_allocation(other.m_allocation),
+    m_vertexBytes(other.m_vertexBytes),
+    m_indexBytes(other.m_indexBytes),
+    m_quantisationError(other.m_quantisationError),
+    m_positionTransform(other.m_positionTransform),
+    m_vertexCacheReport(other.m_vertexCacheReport),
+    m_vao(std::move(other.m_vao))
+{
+    other.m_arena = nullptr;
+    other.m_allocation = nullptr;
+}
 
 Mesh& Mesh::operator=(Mesh&& other) {
     m_name = std::move(other.m_name);
     m_attribs = std::move(other.m_attribs);
     m_resources = std::move(other.m_resources);
+    m_aabb = other.m_aabb;
+    m_sphere = other.m_sphere;
+    m_vertexBytes = other.m_vertexBytes;
+    m_indexBytes = other.m_indexBytes;
+    m_quantisationError = other.m_quantisationError;
+    m_positionTransform = other.m_positionTransform;
+    m_vertexCacheReport = other.m_vertexCacheReport;
+    m_vao = std::move(other.m_vao);
+    if(m_arena)
+        m_arena->release(m_allocation);
+    m_arena = other.m_arena;
+    m_allocation = other.m_allocation;
+    other.m_arena = nullptr;
+    other.m_allocation = nullptr;
     return *this;
 }
 
@@ -37,54 +100,101 @@ bool Mesh::hasUVs() const { return m_attribs.uvs.get(); }
 bool Mesh::isIndexed() const { return m_nIndices; }
 const char* Mesh::name() const { return m_name.c_str(); }
 
+VAO* Mesh::createVAO() const {
+    VAO* vao = new VAO();
+    auto attribute = [vao](AttributeArray const& a, GLuint index) {
+        AttributeArray::Layout const& l = a.layout;
+        vao->enableVertexAttribArray(index);
+        vao->vertexAttribPointer(*a.vbo, index, l.nComponents(), l.stride(), reinterpret_cast<void*>(l.offset()),
+                                 traits::gl_value<AttributeArray::Type>::value(l.type()), l.normalize());
+    };
+    attribute(m_attribs.positions, PositionAttribute);
+    if(m_attribs.normals)
+        attribute(*m_attribs.normals, NormalAttribute);
+    if(m_attribs.colors)
+        attribute(*m_attribs.colors, ColorAttribute);
+    if(m_attribs.uvs)
+        attribute(*m_attribs.uvs, TexCoordAttribute);
+    if(m_attribs.indices)
+        vao->elementBuffer(*(*m_attribs.indices).vbo);
+    return vao;
+}
+
+VAO* Mesh::vao() const {
+    if(!m_vao)
+        m_vao.reset(createVAO());
+    return m_vao.get();
+}
+
+void Mesh::enable_attribute(unsigned int location, bool enable) {
+    if(m_arena)
+        throw std::runtime_error("The attributes of a mesh in a MeshArena can't be toggled");
+    vao()->enableVertexAttribArray(location, enable);
+}
+
 DrawableNode* Mesh::instantiate(glm::mat4 const& position, Program* p, Texture const* tex,
                                 GLenum primitiveMode) const {
-    VAO* vao = new VAO();
-    GLuint attrIndex;
-    attrIndex = static_cast<unsigned int>(p->getAttributeLocation("v_position"));
-    const AttributeArray::Layout* l = &m_attribs.positions.layout;
-    vao->enableVertexAttribArray(attrIndex);
-    vao->vertexAttribPointer(*m_attribs.positions.vbo, attrIndex, l->nComponents(),
-                             l->stride(), reinterpret_cast<void*>(l->offset()),
-                             traits::gl_value<AttributeArray::Type>::value(l->type()), l->normalize());
-    if(m_attribs.normals) {
-        l = &(*m_attribs.normals).layout;
-        attrIndex = static_cast<unsigned int>(p->getAttributeLocation("v_normal"));
-        vao->enableVertexAttribArray(attrIndex);
-        vao->vertexAttribPointer(*(*m_attribs.normals).vbo, attrIndex, l->nComponents(),
-                                 l->stride(), reinterpret_cast<void*>(l->offset()),
-                                 traits::gl_value<AttributeArray::Type>::value(l->type()), l->normalize());
+    DrawableNode* node;
+    if(m_arena) {
+        node = new ArenaObject(position, p, m_arena->vao(*m_allocation), m_allocation, tex, primitiveMode);
+        node->set_bounds(m_sphere);
+        return node;
     }
-    if(m_attribs.colors) {
-        l = &(*m_attribs.colors).layout;
-        attrIndex = static_cast<unsigned int>(p->getAttributeLocation("v_color"));
-        vao->enableVertexAttribArray(attrIndex);
-        vao->vertexAttribPointer(*(*m_attribs.colors).vbo, attrIndex, l->nComponents(),
-                                 l->stride(), reinterpret_cast<void*>(l->offset()),
-                                 traits::gl_value<AttributeArray::Type>::value(l->type()), l->normalize());
+    if(isIndexed()) {
+        node = new IndexedObject(position, p, (*m_attribs.indices).vbo, vao(), m_nIndices, tex,
+                                 traits::gl_value<AttributeArray::Type>::value((*m_attribs.indices).layout.type()),
+                                 primitiveMode);
     }
-    if(m_attribs.uvs) {
-        l = &(*m_attribs.uvs).layout;
-        attrIndex = static_cast<unsigned int>(p->getAttributeLocation("v_texCoord"));
-        vao->enableVertexAttribArray(attrIndex);
-        vao->vertexAttribPointer(*(*m_attribs.uvs).vbo, attrIndex, l->nComponents(),
-                                 l->stride(), reinterpret_cast<void*>(l->offset()),
-                                 traits::gl_value<AttributeArray::Type>::value(l->type()), l->normalize());
+    else {
+        // TODO : assuming triangles for now
+        node = new Object(position, p, vao(), m_nVertices / 3, tex, primitiveMode);
     }
+    node->set_bounds(m_sphere);
+    node->set_geometry_transform(m_positionTransform);
+    return node;
+}
+
+InstancedNode* Mesh::instantiateInstanced(glm::mat4 const& position, Program* p, Texture const* tex,
+                                          GLenum primitiveMode) const {
+    if(m_arena)
+        throw runtime_error("Instanced rendering of meshes allocated in a MeshArena isn't supported");
+    if(m_attribs.positions.layout.type() != AttributeArray::Type::Float)
+        throw runtime_error("Instanced rendering of meshes with quantised positions isn't supported");
+    VAO* vao = createVAO();
+    InstancedNode* node;
     if(isIndexed()) {
-        return new IndexedObject(position, p, (*m_attribs.indices).vbo, vao, m_nIndices, tex,
+        node = new InstancedNode(position, p, vao, m_sphere, (*m_attribs.indices).vbo, m_nIndices, tex,
                                  traits::gl_value<AttributeArray::Type>::value((*m_attribs.indices).layout.type()),
                                  primitiveMode);
     }
     else {
-        // TODO : assuming triangles for now
-        return new Object(position, p, vao, m_nVertices / 3, tex, primitiveMode);
+        node = new InstancedNode(position, p, vao, m_sphere, nullptr, m_nVertices, tex, GL_UNSIGNED_INT,
+                                 primitiveMode);
     }
+    return node;
 }
 
 unsigned int Mesh::numVertices() const { return m_nVertices; }
 unsigned int Mesh::numFaces() const { return m_nIndices; }
 
+size_t Mesh::vertexBufferCount() const {
+    std::vector<const VBO*> buffers = {m_attribs.positions.vbo};
+    for(auto a: {m_attribs.normals.get(), m_attribs.colors.get(), m_attribs.uvs.get()}) {
+        if(a && std::find(buffers.begin(), buffers.end(), a->vbo) == buffers.end())
+            buffers.push_back(a->vbo);
+    }
+    return buffers.size();
+}
+MeshArena* Mesh::arena() const { return m_arena; }
+size_t Mesh::vertexBytes() const { return m_vertexBytes; }
+size_t Mesh::indexBytes() const { return m_indexBytes; }
+Mesh::QuantisationError const& Mesh::quantisationError() const { return m_quantisationError; }
+glm::mat4 const& Mesh::positionTransform() const { return m_positionTransform; }
+
+Mesh::VertexCacheReport const& Mesh::vertexCacheReport() const { return m_vertexCacheReport; }
+AABB const& Mesh::aabb() const { return m_aabb; }
+BoundingSphere const& Mesh::bounding_sphere() const { return m_sphere; }
+
 std::unique_ptr<Mesh> Mesh::quad() {
     MeshBuilder mb("Quad");
     mb.vertices({glm::vec3(-0.5f, 0.5f, 0.f), glm::vec3(0.5f, 0.5f, 0.f),
@@ -139,113 +249,450 @@ MeshBuilder::MeshBuilder(std::string const& name) :
     m_nNormals(0),
     m_nColors(0),
     m_nUVs(0),
-    m_nIndices(0) { }
+    m_nIndices(0),
+    m_aabb(),
+    m_sphere(),
+    m_layout(VertexLayout::Interleaved),
+    m_positions(),
+    m_normals(),
+    m_colors(),
+    m_uvs2D(),
+    m_uvs3D(),
+    m_uvComponents(0),
+    m_indices(),
+    m_indexType(AttributeArray::Type::Uint),
+    m_arena(nullptr),
+    m_allocation(nullptr),
+    m_quantise(Quantise::None),
+    m_error{0.f, 0.f, 0.f, 0.f},
+    m_positionTransform(1.f),
+    m_vertexBytes(0),
+    m_indexBytes(0),
+    m_optimize(Optimize::None),
+    m_vertexCacheReport{{0.f, 0.f}, {0.f, 0.f}},
+    m_packedPositions(),
+    m_packedNormals(),
+    m_packedColors(),
+    m_packedUVs(),
+    m_streams(),
+    m_prepared(false) { }
 
 MeshBuilder::~MeshBuilder() { }
 
-MeshBuilder& MeshBuilder::vertices(std::vector<glm::vec3> const& verts) {
-    auto vbo = std::make_unique<VBO>();
-    vbo->upload_data(verts);
+MeshBuilder& MeshBuilder::layout(VertexLayout l) {
+    m_layout = l;
+    return *this;
+}
+
+MeshBuilder& MeshBuilder::arena(MeshArena* arena) {
+    m_arena = arena;
+    return *this;
+}
+
+MeshBuilder& MeshBuilder::quantise(Quantise q) {
+    m_quantise = q;
+    return *this;
+}
+
+MeshBuilder& MeshBuilder::optimize(Optimize o) {
+    m_optimize = o;
+    return *this;
+}
+
+MeshBuilder& MeshBuilder::vertices(std::vector<glm::vec3> verts) {
     m_nVertices = verts.size();
-    m_meshAttribs.positions = AttributeArray(*vbo,
-                                             AttributeArray::Kind::Positions,
-                                             AttributeArray::Layout(3, AttributeArray::Type::Float));
-    m_resources.push_back(std::move(vbo));
+    m_aabb = AABB::fromPoints(verts);
+    m_sphere = BoundingSphere::fromPoints(verts);
+    m_positions = std::move(verts);
     return *this;
 }
 
-MeshBuilder& MeshBuilder::normals(std::vector<glm::vec3> const& norms) {
-    auto vbo = std::make_unique<VBO>();
-    vbo->upload_data(norms);
+MeshBuilder& MeshBuilder::normals(std::vector<glm::vec3> norms) {
     m_nNormals = norms.size();
-    m_meshAttribs.normals =
-        std::make_unique<AttributeArray>(*vbo,
-                                         AttributeArray::Kind::Normals,
-                                         AttributeArray::Layout(3, AttributeArray::Type::Float));
-    m_resources.push_back(std::move(vbo));
+    m_normals = std::move(norms);
     return *this;
 }
 
-MeshBuilder& MeshBuilder::colors(std::vector<glm::vec4> const& cols) {
-    auto vbo = std::make_unique<VBO>();
-    vbo->upload_data(cols);
+MeshBuilder& MeshBuilder::colors(std::vector<glm::vec4> cols) {
     m_nColors = cols.size();
-    m_meshAttribs.colors =
-        std::make_unique<AttributeArray>(*vbo,
-                                         AttributeArray::Kind::Colors,
-                                         AttributeArray::Layout(4, AttributeArray::Type::Float));
-    m_resources.push_back(std::move(vbo));
+    m_colors = std::move(cols);
     return *this;
 }
 
 MeshBuilder& MeshBuilder::uvs(std::vector<glm::vec2> const& uvs) {
-    auto vbo = std::make_unique<VBO>();
-    vbo->upload_data(uvs);
+    return this->uvs(std::vector<glm::vec2>(uvs));
+}
+
+MeshBuilder& MeshBuilder::uvs(std::vector<glm::vec2>&& uvs) {
     m_nUVs = uvs.size();
-    m_meshAttribs.uvs =
-        std::make_unique<AttributeArray>(*vbo,
-                                         AttributeArray::Kind::UVs,
-                                         AttributeArray::Layout(2, AttributeArray::Type::Float));
-    m_resources.push_back(std::move(vbo));
+    m_uvComponents = 2;
+    m_uvs2D = std::move(uvs);
+    m_uvs3D.clear();
     return *this;
 }
 
 MeshBuilder& MeshBuilder::uvs(std::vector<glm::vec3> const& uvs) {
-    auto vbo = std::make_unique<VBO>();
-    vbo->upload_data(uvs);
+    return this->uvs(std::vector<glm::vec3>(uvs));
+}
+
+MeshBuilder& MeshBuilder::uvs(std::vector<glm::vec3>&& uvs) {
     m_nUVs = uvs.size();
-    m_meshAttribs.uvs =
-        std::make_unique<AttributeArray>(*vbo,
-                                         AttributeArray::Kind::UVs,
-                                         AttributeArray::Layout(3, AttributeArray::Type::Float));
-    m_resources.push_back(std::move(vbo));
+    m_uvComponents = 3;
+    m_uvs3D = std::move(uvs);
+    m_uvs2D.clear();
     return *this;
 }
 
 MeshBuilder& MeshBuilder::faces(std::vector<unsigned char>&& indices) {
-    auto vbo = std::make_unique<VBO>();
-    vbo->upload_data(indices);
     m_nIndices = indices.size();
-    m_meshAttribs.indices =
-        std::make_unique<AttributeArray>(*vbo,
-                                         AttributeArray::Kind::Indices,
-                                         AttributeArray::Layout(0, AttributeArray::Type::Uchar));
-    m_resources.push_back(std::move(vbo));
+    m_indexType = AttributeArray::Type::Uchar;
+    m_indices.assign(indices.begin(), indices.end());
     return *this;
 }
 
 MeshBuilder& MeshBuilder::faces(std::vector<unsigned short>&& indices) {
-    auto vbo = std::make_unique<VBO>();
-    vbo->upload_data(indices);
     m_nIndices = indices.size();
-    m_meshAttribs.indices =
-        std::make_unique<AttributeArray>(*vbo,
-                                         AttributeArray::Kind::Indices,
-                                         AttributeArray::Layout(0, AttributeArray::Type::Ushort));
-    m_resources.push_back(std::move(vbo));
+    m_indexType = AttributeArray::Type::Ushort;
+    m_indices.assign(indices.begin(), indices.end());
     return *this;
 }
 
 MeshBuilder& MeshBuilder::faces(std::vector<unsigned int>&& indices) {
-    auto vbo = std::make_unique<VBO>();
-    vbo->upload_data(indices);
+    return faces(std::move(indices), AttributeArray::Type::Uint);
+}
+
+MeshBuilder& MeshBuilder::faces(std::vector<unsigned int>&& indices, AttributeArray::Type type) {
+    if(type != AttributeArray::Type::Uchar && type != AttributeArray::Type::Ushort &&
+       type != AttributeArray::Type::Uint)
+        throw std::runtime_error("Invalid index type");
     m_nIndices = indices.size();
-    m_meshAttribs.indices =
-        std::make_unique<AttributeArray>(*vbo,
-                                         AttributeArray::Kind::Indices,
-                                         AttributeArray::Layout(0, AttributeArray::Type::Uint));
-    m_resources.push_back(std::move(vbo));
+    m_indexType = type;
+    m_indices = std::move(indices);
     return *this;
 }
 
-std::unique_ptr<Mesh> MeshBuilder::build_mesh() {
+MeshBuilder& MeshBuilder::prepare() {
+    if(m_prepared)
+        return *this;
     validateMesh();
+    optimizeIndices();
+    prepareStreams();
+    if(quantised(m_quantise, Quantise::Indices) && m_indexType == AttributeArray::Type::Uint &&
+       m_nVertices <= std::numeric_limits<unsigned short>::max() + 1u)
+        m_indexType = AttributeArray::Type::Ushort;
+    m_prepared = true;
+    return *this;
+}
+
+size_t MeshBuilder::uploadSize() const {
+    size_t size = m_nIndices * indexSize();
+    for(Stream const& s: m_streams) {
+        size += s.size * m_nVertices;
+    }
+    return size;
+}
+
+std::unique_ptr<Mesh> MeshBuilder::build_mesh() {
+    prepare();
+    uploadVertices();
+    if(!m_arena)
+        uploadIndices();
     std::unique_ptr<Mesh> mesh;
-    mesh.reset(new Mesh(m_meshName, std::move(m_meshAttribs), std::move(m_resources), m_nVertices, m_nIndices));
+    mesh.reset(new Mesh(m_meshName, std::move(m_meshAttribs), std::move(m_resources), m_nVertices, m_nIndices,
+                        m_aabb, m_sphere, m_arena, m_allocation));
+    mesh->m_vertexBytes = m_vertexBytes;
+    mesh->m_indexBytes = m_indexBytes;
+    mesh->m_quantisationError = m_error;
+    mesh->m_positionTransform = m_positionTransform;
+    mesh->m_vertexCacheReport = m_vertexCacheReport;
+    m_allocation = nullptr;
+    m_error = {0.f, 0.f, 0.f, 0.f};
+    m_positionTransform = glm::mat4(1.f);
+    m_vertexCacheReport = {{0.f, 0.f}, {0.f, 0.f}};
+    m_vertexBytes = 0;
+    m_indexBytes = 0;
     m_nVertices = 0;
+    m_nNormals = 0;
+    m_nColors = 0;
+    m_nUVs = 0;
+    m_nIndices = 0;
+    m_positions.clear();
+    m_normals.clear();
+    m_colors.clear();
+    m_uvs2D.clear();
+    m_uvs3D.clear();
+    m_indices.clear();
+    m_packedPositions.clear();
+    m_packedNormals.clear();
+    m_packedColors.clear();
+    m_packedUVs.clear();
+    m_streams.clear();
+    m_prepared = false;
     return mesh;
 }
 
+void MeshBuilder::optimizeIndices() {
+    if(!m_nIndices || m_optimize == Optimize::None)
+        return;
+    m_vertexCacheReport.before = analyzeVertexCache(m_indices, m_nVertices);
+    if((m_optimize & Optimize::VertexCache) != Optimize::None)
+        optimizeVertexCache(m_indices, m_nVertices);
+    if((m_optimize & Optimize::Overdraw) != Optimize::None)
+        optimizeOverdraw(m_indices, m_positions);
+    if((m_optimize & Optimize::VertexFetch) != Optimize::None) {
+        std::vector<unsigned int> remap = optimizeVertexFetch(m_indices, m_nVertices);
+        remapVertices(m_positions, remap);
+        if(m_nNormals)
+            remapVertices(m_normals, remap);
+        if(m_nColors)
+            remapVertices(m_colors, remap);
+        if(m_nUVs && m_uvComponents == 2)
+            remapVertices(m_uvs2D, remap);
+        else if(m_nUVs)
+            remapVertices(m_uvs3D, remap);
+    }
+    m_vertexCacheReport.after = analyzeVertexCache(m_indices, m_nVertices);
+}
+
+void MeshBuilder::prepareStreams() {
+    if(quantised(m_quantise, Quantise::Positions)) {
+        /* Normalised coordinates in the bounding box. The scale is the same
+         * on every axis so that the normals are still valid once the decoding
+         * transform is applied. */
+        glm::vec3 size = m_aabb.max() - m_aabb.min();
+        float extent = std::max(std::max(size.x, size.y), size.z);
+        if(!(extent > 0.f))
+            extent = 1.f;
+        m_positionTransform = glm::scale(glm::translate(glm::mat4(1.f), m_aabb.min()), glm::vec3(extent));
+        m_packedPositions.reserve(m_nVertices * 4 * sizeof(std::uint16_t));
+        for(glm::vec3 const& p: m_positions) {
+            glm::vec3 q = (p - m_aabb.min()) / extent * 65535.f;
+            std::uint16_t packed[4] = {0, 0, 0, 0};
+            for(int c = 0 ; c != 3 ; ++c) {
+                q[c] = std::round(q[c]);
+                packed[c] = static_cast<std::uint16_t>(q[c]);
+            }
+            append(m_packedPositions, packed);
+            m_error.position = std::max(m_error.position, glm::length(m_aabb.min() + q / 65535.f * extent - p));
+        }
+        m_streams.push_back({AttributeArray::Kind::Positions, m_packedPositions.data(), 4 * sizeof(std::uint16_t), 4,
+                             AttributeArray::Type::Ushort, true});
+    }
+    else {
+        m_streams.push_back({AttributeArray::Kind::Positions, reinterpret_cast<const char*>(m_positions.data()),
+                             3 * sizeof(float), 3, AttributeArray::Type::Float, false});
+    }
+
+    if(m_nNormals && quantised(m_quantise, Quantise::Normals)) {
+        m_packedNormals.reserve(m_nVertices * sizeof(std::uint32_t));
+        for(glm::vec3 const& n: m_normals) {
+            float l = glm::length(n);
+            glm::vec3 u = l > 0.f ? n / l : n;
+            std::uint32_t packed = glm::packSnorm3x10_1x2(glm::vec4(u, 0.f));
+            append(m_packedNormals, packed);
+            glm::vec3 d = glm::vec3(glm::unpackSnorm3x10_1x2(packed));
+            if(l > 0.f && glm::length(d) > 0.f) {
+                float c = std::min(std::max(glm::dot(u, glm::normalize(d)), -1.f), 1.f);
+                m_error.normal = std::max(m_error.normal, std::acos(c) * 180.f / 3.14159265f);
+            }
+        }
+        m_streams.push_back({AttributeArray::Kind::Normals, m_packedNormals.data(), sizeof(std::uint32_t), 4,
+                             AttributeArray::Type::Int2101010Rev, true});
+    }
+    else if(m_nNormals) {
+        m_streams.push_back({AttributeArray::Kind::Normals, reinterpret_cast<const char*>(m_normals.data()),
+                             3 * sizeof(float), 3, AttributeArray::Type::Float, false});
+    }
+
+    if(m_nColors && quantised(m_quantise, Quantise::Colors)) {
+        m_packedColors.reserve(m_nVertices * sizeof(std::uint32_t));
+        for(glm::vec4 const& c: m_colors) {
+            std::uint32_t packed = glm::packUnorm4x8(c);
+            append(m_packedColors, packed);
+            glm::vec4 d = glm::unpackUnorm4x8(packed);
+            for(int i = 0 ; i != 4 ; ++i) {
+                m_error.color = std::max(m_error.color, std::abs(d[i] - std::min(std::max(c[i], 0.f), 1.f)));
+            }
+        }
+        m_streams.push_back({AttributeArray::Kind::Colors, m_packedColors.data(), sizeof(std::uint32_t), 4,
+                             AttributeArray::Type::Uchar, true});
+    }
+    else if(m_nColors) {
+        m_streams.push_back({AttributeArray::Kind::Colors, reinterpret_cast<const char*>(m_colors.data()),
+                             4 * sizeof(float), 4, AttributeArray::Type::Float, false});
+    }
+
+    if(m_nUVs && quantised(m_quantise, Quantise::UVs)) {
+        // 3D coordinates are padded to keep the attributes 4 bytes aligned
+        int nComponents = m_uvComponents == 2 ? 2 : 4;
+        size_t size = static_cast<size_t>(nComponents) * sizeof(std::uint16_t);
+        m_packedUVs.reserve(m_nVertices * size);
+        const float* uv = uvData();
+        for(size_t v = 0 ; v != m_nVertices ; ++v, uv += m_uvComponents) {
+            for(int c = 0 ; c != nComponents ; ++c) {
+                float f = c < m_uvComponents ? uv[c] : 0.f;
+                std::uint16_t packed = glm::packHalf1x16(f);
+                append(m_packedUVs, packed);
+                m_error.uv = std::max(m_error.uv, std::abs(glm::unpackHalf1x16(packed) - f));
+            }
+        }
+        m_streams.push_back({AttributeArray::Kind::UVs, m_packedUVs.data(), size, nComponents,
+                             AttributeArray::Type::Half, false});
+    }
+    else if(m_nUVs) {
+        m_streams.push_back({AttributeArray::Kind::UVs, reinterpret_cast<const char*>(uvData()),
+                             static_cast<size_t>(m_uvComponents) * sizeof(float), m_uvComponents,
+                             AttributeArray::Type::Float, false});
+    }
+}
+
+void MeshBuilder::uploadVertices() {
+    /* Size of an interleaved vertex of the streams in [first, last) */
+    auto vertexSize = [this](size_t first, size_t last) {
+        size_t stride = 0;
+        for(size_t s = first ; s != last ; ++s) {
+            stride += m_streams[s].size;
+        }
+        return stride;
+    };
+
+    /* Interleave the streams in [first, last) into data */
+    auto interleave = [this](size_t first, size_t last, size_t stride, char* data) {
+        size_t offset = 0;
+        for(size_t s = first ; s != last ; ++s) {
+            size_t size = m_streams[s].size;
+            for(size_t v = 0 ; v != m_nVertices ; ++v) {
+                std::memcpy(data + v * stride + offset, m_streams[s].data + v * size, size);
+            }
+            offset += size;
+        }
+    };
+
+    /* Point the attributes of the streams in [first, last) to vbo */
+    auto setAttributes = [this](VBO const& vbo, size_t first, size_t last, size_t stride) {
+        size_t offset = 0;
+        for(size_t s = first ; s != last ; ++s) {
+            // Tightly packed attributes keep a null stride
+            AttributeArray::Layout l(m_streams[s].nComponents, m_streams[s].type, (last - first > 1) ? stride : 0,
+                                     m_streams[s].normalize, static_cast<std::intptr_t>(offset));
+            offset += m_streams[s].size;
+            switch(m_streams[s].kind) {
+                case AttributeArray::Kind::Positions:
+                    m_meshAttribs.positions = AttributeArray(vbo, AttributeArray::Kind::Positions, l);
+                    break;
+                case AttributeArray::Kind::Normals:
+                    m_meshAttribs.normals = std::make_unique<AttributeArray>(vbo, AttributeArray::Kind::Normals, l);
+                    break;
+                case AttributeArray::Kind::Colors:
+                    m_meshAttribs.colors = std::make_unique<AttributeArray>(vbo, AttributeArray::Kind::Colors, l);
+                    break;
+                case AttributeArray::Kind::UVs:
+                    m_meshAttribs.uvs = std::make_unique<AttributeArray>(vbo, AttributeArray::Kind::UVs, l);
+                    break;
+                case AttributeArray::Kind::Indices:
+                    UNREACHABLE(0);
+            }
+        }
+    };
+
+    /* Upload the streams in [first, last) to a single buffer. A single stream
+     * is uploaded from the builder arrays, several are interleaved directly in
+     * the mapped buffer rather than in a staging copy. */
+    auto upload = [this, &vertexSize, &interleave, &setAttributes](size_t first, size_t last) {
+        size_t stride = vertexSize(first, last);
+        size_t size = stride * m_nVertices;
+        auto vbo = std::make_unique<VBO>();
+        if(last - first == 1) {
+            vbo->upload_data(m_streams[first].data, size);
+        }
+        else {
+            vbo->allocate(size);
+            do {
+                char* data = static_cast<char*>(vbo->map_range(0, size,
+                                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+                interleave(first, last, stride, data);
+            } while(!vbo->unmap());
+        }
+        m_vertexBytes += size;
+        setAttributes(*vbo, first, last, stride);
+        m_resources.push_back(std::move(vbo));
+    };
+
+    if(m_arena) {
+        size_t stride = vertexSize(0, m_streams.size());
+        std::vector<char> data(stride * m_nVertices);
+        interleave(0, m_streams.size(), stride, data.data());
+        m_vertexBytes += data.size();
+        MeshArena::VertexFormat format{m_nNormals ? 3 : 0, m_nColors ? 4 : 0, m_nUVs ? m_uvComponents : 0};
+        m_allocation = m_arena->allocate(format, data, m_nVertices, m_indices);
+        setAttributes(m_arena->vertexBuffer(*m_allocation), 0, m_streams.size(), stride);
+        m_indexBytes = m_nIndices * sizeof(unsigned int);
+        if(m_nIndices) {
+            m_meshAttribs.indices =
+                std::make_unique<AttributeArray>(m_arena->indexBuffer(),
+                                                 AttributeArray::Kind::Indices,
+                                                 AttributeArray::Layout(0, AttributeArray::Type::Uint));
+        }
+        return;
+    }
+
+    switch(m_layout) {
+        case VertexLayout::Interleaved:
+            upload(0, m_streams.size());
+            break;
+        case VertexLayout::PositionSeparate:
+            upload(0, 1);
+            if(m_streams.size() > 1)
+                upload(1, m_streams.size());
+            break;
+        case VertexLayout::Separate:
+            for(size_t s = 0 ; s != m_streams.size() ; ++s) {
+                upload(s, s + 1);
+            }
+            break;
+    }
+}
+
+void MeshBuilder::uploadIndices() {
+    if(!m_nIndices)
+        return;
+    auto vbo = std::make_unique<VBO>();
+    m_indexBytes = m_nIndices * indexSize();
+    if(m_indexType == AttributeArray::Type::Uint) {
+        vbo->upload_data(m_indices);
+    }
+    else {
+        // Narrowed while written to the mapped buffer
+        vbo->allocate(m_indexBytes);
+        do {
+            void* data = vbo->map_range(0, m_indexBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if(m_indexType == AttributeArray::Type::Uchar)
+                std::copy(m_indices.begin(), m_indices.end(), static_cast<unsigned char*>(data));
+            else
+                std::copy(m_indices.begin(), m_indices.end(), static_cast<unsigned short*>(data));
+        } while(!vbo->unmap());
+    }
+    m_meshAttribs.indices =
+        std::make_unique<AttributeArray>(*vbo,
+                                         AttributeArray::Kind::Indices,
+                                         AttributeArray::Layout(0, m_indexType));
+    m_resources.push_back(std::move(vbo));
+}
+
+size_t MeshBuilder::indexSize() const {
+    // The arena stores 32 bit indices whatever their type
+    if(m_arena)
+        return sizeof(unsigned int);
+    return m_indexType == AttributeArray::Type::Uchar ? sizeof(unsigned char) :
+           m_indexType == AttributeArray::Type::Ushort ? sizeof(unsigned short) :
+           sizeof(unsigned int);
+}
+
+const float* MeshBuilder::uvData() const {
+    return (m_uvComponents == 2) ? reinterpret_cast<const float*>(m_uvs2D.data()) :
+                                   reinterpret_cast<const float*>(m_uvs3D.data());
+}
+
 void MeshBuilder::validateMesh() const {
     if(!m_nVertices)
         throw std::runtime_error("Mesh has no geometry");
@@ -257,6 +704,16 @@ void MeshBuilder::validateMesh() const {
         throw std::runtime_error("Mesh doesn't have the same number of vertices and UVs");
     if(m_nIndices && m_nIndices % 3)
         throw std::runtime_error("Mesh number of vertex indices is not a multiple of 3");
+    // The indices must also fit the index type they are narrowed to
+    unsigned int limit = m_nVertices;
+    if(m_indexType == AttributeArray::Type::Uchar)
+        limit = std::min(limit, std::numeric_limits<unsigned char>::max() + 1u);
+    else if(m_indexType == AttributeArray::Type::Ushort)
+        limit = std::min(limit, std::numeric_limits<unsigned short>::max() + 1u);
+    if(std::any_of(m_indices.begin(), m_indices.end(), [limit] (unsigned int i) { return i >= limit; }))
+        throw std::runtime_error("Mesh has vertex indices out of range");
+    if(m_arena && m_quantise != Quantise::None)
+        throw std::runtime_error("Quantised meshes can't be allocated in a MeshArena");
 }
 
 } // namespace Engine
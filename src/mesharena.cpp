@@ -0,0 +1,271 @@
+#include "mesharena.h"
+#include "attribute.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+using namespace gl;
+
+namespace Engine {
+
+constexpr size_t RangeAllocator::npos;
+
+RangeAllocator::RangeAllocator(size_t capacity) :
+    m_capacity(0),
+    m_used(0),
+    m_free()
+{
+    grow(capacity);
+}
+
+size_t RangeAllocator::allocate(size_t size, size_t alignment) {
+    for(auto it = m_free.begin() ; it != m_free.end() ; ++it) {
+        size_t start = it->first;
+        size_t offset = (start + alignment - 1) / alignment * alignment;
+        if(it->second < offset - start + size)
+            continue;
+        size_t remaining = it->second - (offset - start) - size;
+        m_free.erase(it);
+        if(offset != start)
+            m_free.emplace(start, offset - start);
+        if(remaining)
+            m_free.emplace(offset + size, remaining);
+        m_used += size;
+        return offset;
+    }
+    return npos;
+}
+
+void RangeAllocator::release(size_t offset, size_t size) {
+    if(!size)
+        return;
+    m_used -= size;
+    auto next = m_free.lower_bound(offset);
+    // Merge with the following free range
+    if(next != m_free.end() && next->first == offset + size) {
+        size += next->second;
+        next = m_free.erase(next);
+    }
+    // Merge with the preceding free range
+    if(next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if(prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    m_free.emplace(offset, size);
+}
+
+void RangeAllocator::grow(size_t capacity) {
+    if(capacity <= m_capacity)
+        return;
+    size_t added = capacity - m_capacity;
+    size_t offset = m_capacity;
+    m_capacity = capacity;
+    // The new space is free, release() merges it with a free range at the end
+    m_used += added;
+    release(offset, added);
+}
+
+void RangeAllocator::reset(size_t used) {
+    m_free.clear();
+    m_used = used;
+    if(used < m_capacity)
+        m_free.emplace(used, m_capacity - used);
+}
+
+size_t RangeAllocator::capacity() const { return m_capacity; }
+size_t RangeAllocator::used() const { return m_used; }
+
+size_t RangeAllocator::largestFree() const {
+    size_t largest = 0;
+    for(auto const& r: m_free) {
+        largest = std::max(largest, r.second);
+    }
+    return largest;
+}
+
+size_t MeshArena::VertexFormat::stride() const {
+    return static_cast<size_t>(3 + normals + colors + uvs) * sizeof(float);
+}
+
+bool MeshArena::VertexFormat::operator==(VertexFormat const& other) const {
+    return normals == other.normals && colors == other.colors && uvs == other.uvs;
+}
+
+VAO* MeshArena::VertexFormat::createVAO(VBO const& vertices, VBO const& indices) const {
+    VAO* vao = new VAO();
+    GLsizei vertexStride = static_cast<GLsizei>(stride());
+    size_t offset = 0;
+    auto attribute = [&](GLuint index, int nComponents) {
+        if(!nComponents)
+            return;
+        vao->enableVertexAttribArray(index);
+        vao->vertexAttribPointer(vertices, index, nComponents, vertexStride, reinterpret_cast<void*>(offset));
+        offset += static_cast<size_t>(nComponents) * sizeof(float);
+    };
+    attribute(PositionAttribute, 3);
+    attribute(NormalAttribute, normals);
+    attribute(ColorAttribute, colors);
+    attribute(TexCoordAttribute, uvs);
+    vao->elementBuffer(indices);
+    return vao;
+}
+
+unsigned int MeshArena::Allocation::baseVertex() const { return m_baseVertex; }
+unsigned int MeshArena::Allocation::vertexCount() const { return m_nVertices; }
+unsigned int MeshArena::Allocation::firstIndex() const { return m_firstIndex; }
+unsigned int MeshArena::Allocation::indexCount() const { return m_nIndices; }
+
+MeshArena::MeshArena(size_t vertices, size_t indices) :
+    m_pools(),
+    m_indices(),
+    m_indexRanges(indices),
+    m_initialVertices(vertices),
+    m_allocations()
+{
+    m_indices.allocate(indices * sizeof(unsigned int));
+}
+
+MeshArena::~MeshArena() { }
+
+MeshArena::Allocation* MeshArena::allocate(VertexFormat const& format, std::vector<char> const& vertices,
+                                           unsigned int nVertices, std::vector<unsigned int> const& indices) {
+    size_t stride = format.stride();
+    if(!nVertices || vertices.size() != nVertices * stride)
+        throw std::runtime_error("Vertex data doesn't match the vertex format");
+    size_t p = pool(format);
+    Pool& pool = m_pools[p];
+    std::unique_ptr<Allocation> a(new Allocation());
+    a->m_pool = p;
+    a->m_slot = m_allocations.size();
+    a->m_nVertices = nVertices;
+    a->m_baseVertex = static_cast<unsigned int>(allocateRange(*pool.vbo, pool.vertices, nVertices, stride));
+    pool.vbo->update_data(vertices[0], vertices.size(), static_cast<ptrdiff_t>(a->m_baseVertex * stride));
+    a->m_nIndices = static_cast<unsigned int>(indices.size());
+    a->m_firstIndex = 0;
+    if(!indices.empty()) {
+        a->m_firstIndex = static_cast<unsigned int>(allocateRange(m_indices, m_indexRanges, indices.size(),
+                                                                  sizeof(unsigned int)));
+        m_indices.update_data(indices[0], indices.size() * sizeof(unsigned int),
+                              static_cast<ptrdiff_t>(a->m_firstIndex * sizeof(unsigned int)));
+    }
+    m_allocations.push_back(std::move(a));
+    return m_allocations.back().get();
+}
+
+void MeshArena::release(Allocation* allocation) {
+    m_pools[allocation->m_pool].vertices.release(allocation->m_baseVertex, allocation->m_nVertices);
+    m_indexRanges.release(allocation->m_firstIndex, allocation->m_nIndices);
+    size_t slot = allocation->m_slot;
+    std::swap(m_allocations[slot], m_allocations.back());
+    m_allocations[slot]->m_slot = slot;
+    m_allocations.pop_back();
+}
+
+void MeshArena::compact() {
+    std::vector<Allocation*> sorted;
+    sorted.reserve(m_allocations.size());
+    for(auto const& a: m_allocations) {
+        sorted.push_back(a.get());
+    }
+
+    /* Pack the vertices of each pool in a temporary buffer, in the order they
+     * are in the pool, then copy them back at the start of the pool */
+    for(size_t p = 0 ; p != m_pools.size() ; ++p) {
+        Pool& pool = m_pools[p];
+        size_t stride = pool.format.stride();
+        std::vector<Allocation*> allocations;
+        std::copy_if(sorted.begin(), sorted.end(), std::back_inserter(allocations),
+                     [p](Allocation* a) { return a->m_pool == p; });
+        std::sort(allocations.begin(), allocations.end(),
+                  [](Allocation* a, Allocation* b) { return a->m_baseVertex < b->m_baseVertex; });
+        size_t used = pool.vertices.used();
+        if(used) {
+            VBO tmp(used * stride);
+            size_t offset = 0;
+            for(Allocation* a: allocations) {
+                tmp.copy_data(*pool.vbo, static_cast<ptrdiff_t>(a->m_baseVertex * stride),
+                              static_cast<ptrdiff_t>(offset * stride), a->m_nVertices * stride);
+                a->m_baseVertex = static_cast<unsigned int>(offset);
+                offset += a->m_nVertices;
+            }
+            pool.vbo->copy_data(tmp, 0, 0, used * stride);
+        }
+        pool.vertices.reset(used);
+    }
+
+    std::sort(sorted.begin(), sorted.end(),
+              [](Allocation* a, Allocation* b) { return a->m_firstIndex < b->m_firstIndex; });
+    size_t used = m_indexRanges.used();
+    if(used) {
+        VBO tmp(used * sizeof(unsigned int));
+        size_t offset = 0;
+        for(Allocation* a: sorted) {
+            if(!a->m_nIndices)
+                continue;
+            tmp.copy_data(m_indices, static_cast<ptrdiff_t>(a->m_firstIndex * sizeof(unsigned int)),
+                          static_cast<ptrdiff_t>(offset * sizeof(unsigned int)),
+                          a->m_nIndices * sizeof(unsigned int));
+            a->m_firstIndex = static_cast<unsigned int>(offset);
+            offset += a->m_nIndices;
+        }
+        m_indices.copy_data(tmp, 0, 0, used * sizeof(unsigned int));
+    }
+    m_indexRanges.reset(used);
+}
+
+VAO* MeshArena::vao(Allocation const& allocation) {
+    Pool& pool = m_pools[allocation.m_pool];
+    if(pool.vao)
+        return pool.vao.get();
+
+    pool.vao.reset(pool.format.createVAO(*pool.vbo, m_indices));
+    return pool.vao.get();
+}
+
+VBO const& MeshArena::vertexBuffer(Allocation const& allocation) const {
+    return *m_pools[allocation.m_pool].vbo;
+}
+
+VBO const& MeshArena::indexBuffer() const { return m_indices; }
+
+size_t MeshArena::bufferCount() const { return m_pools.size() + 1; }
+
+size_t MeshArena::size() const { return m_allocations.size(); }
+
+size_t MeshArena::pool(VertexFormat const& format) {
+    for(size_t p = 0 ; p != m_pools.size() ; ++p) {
+        if(m_pools[p].format == format)
+            return p;
+    }
+    Pool pool{format, std::make_unique<VBO>(), RangeAllocator(m_initialVertices), nullptr};
+    pool.vbo->allocate(m_initialVertices * format.stride());
+    m_pools.push_back(std::move(pool));
+    return m_pools.size() - 1;
+}
+
+void MeshArena::resize(VBO& vbo, size_t size, size_t capacity) {
+    if(!size) {
+        vbo.allocate(capacity);
+        return;
+    }
+    VBO tmp(size);
+    tmp.copy_data(vbo, 0, 0, size);
+    vbo.allocate(capacity);
+    vbo.copy_data(tmp, 0, 0, size);
+}
+
+size_t MeshArena::allocateRange(VBO& vbo, RangeAllocator& ranges, size_t size, size_t elementSize) {
+    size_t offset = ranges.allocate(size);
+    if(offset != RangeAllocator::npos)
+        return offset;
+    size_t capacity = std::max(2 * ranges.capacity(), ranges.capacity() + size);
+    resize(vbo, ranges.capacity() * elementSize, capacity * elementSize);
+    ranges.grow(capacity);
+    return ranges.allocate(size);
+}
+
+} // namespace Engine
@@ -0,0 +1,402 @@
+#include "meshcache.h"
+#include "vbo.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace Engine {
+
+namespace {
+    constexpr char kMagic[4] = {'T', 'M', 'C', 'H'};
+    /* Alignment of the buffers in the file */
+    constexpr std::uint64_t kAlignment = 16;
+    /* Attributes of a mesh, indexed by AttributeArray::Kind */
+    constexpr size_t kAttributes = 5;
+
+    /* The file starts with a Header, followed by a MeshRecord per mesh and
+     * the content of the buffers. Every field is written in the byte order of
+     * the machine, the cache isn't meant to be shared between platforms. */
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint64_t check;
+        /* Size of the source file */
+        std::uint64_t sourceSize;
+        std::uint32_t nMeshes;
+        std::uint32_t padding;
+    };
+
+    struct AttributeRecord {
+        /* Index of the buffer in the MeshRecord, -1 if the mesh doesn't have
+         * the attribute */
+        std::int32_t buffer;
+        std::int32_t nComponents;
+        std::uint32_t type;
+        std::uint32_t normalize;
+        std::uint64_t stride;
+        std::int64_t offset;
+    };
+
+    struct BufferRecord {
+        /* Offset of the content from the start of the file */
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    struct MeshRecord {
+        char name[64];
+        std::uint32_t nVertices;
+        std::uint32_t nIndices;
+        std::uint32_t nBuffers;
+        std::uint32_t padding;
+        AttributeRecord attributes[kAttributes];
+        BufferRecord buffers[kAttributes];
+        float aabbMin[3];
+        float aabbMax[3];
+        float sphereCenter[3];
+        float sphereRadius;
+        float positionTransform[16];
+        float quantisationError[4];
+        float vertexCache[4];
+        std::uint64_t vertexBytes;
+        std::uint64_t indexBytes;
+    };
+
+    static_assert(std::is_trivially_copyable<Header>::value && std::is_trivially_copyable<MeshRecord>::value,
+                  "The cache records are copied to and from the file as is.");
+
+    std::uint64_t rotl(std::uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    /* MurmurHash3 round, every bit of the word changes about half the bits of
+     * the hash */
+    std::uint64_t murmurRound(std::uint64_t h, std::uint64_t word) {
+        word *= 0x87c37b91114253d5ull;
+        word = rotl(word, 31);
+        word *= 0x4cf5ad432745937full;
+        h ^= word;
+        h = rotl(h, 27);
+        return h * 5 + 0x52dce729;
+    }
+
+    /* xxHash64 round, for the check hash */
+    std::uint64_t xxRound(std::uint64_t h, std::uint64_t word) {
+        h += word * 0xc2b2ae3d27d4eb4full;
+        h = rotl(h, 31);
+        return h * 0x9e3779b185ebca87ull;
+    }
+
+    /* MurmurHash3 finaliser, spreads the last rounds over every bit */
+    std::uint64_t fmix(std::uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /* Load the word at i, the last one padded with zeroes */
+    std::uint64_t word(const unsigned char* bytes, size_t size, size_t i) {
+        std::uint64_t w = 0;
+        std::memcpy(&w, bytes + i, std::min(sizeof(w), size - i));
+        return w;
+    }
+
+    /* Both hashes of a block in a single pass, the source files can be
+     * hundreds of MB */
+    void hashBlock(const void* data, size_t size, std::uint64_t& h, std::uint64_t& check) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for(size_t i = 0 ; i < size ; i += sizeof(std::uint64_t)) {
+            std::uint64_t w = word(bytes, size, i);
+            h = murmurRound(h, w);
+            check = xxRound(check, w);
+        }
+        h = fmix(h ^ size);
+        check = fmix(check ^ size);
+    }
+
+    std::uint64_t alignOffset(std::uint64_t offset) {
+        return (offset + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    AttributeArray const* attribute(AttributeMap const& attribs, size_t kind) {
+        switch(static_cast<AttributeArray::Kind>(kind)) {
+            case AttributeArray::Kind::Positions: return &attribs.positions;
+            case AttributeArray::Kind::Normals: return attribs.normals.get();
+            case AttributeArray::Kind::Colors: return attribs.colors.get();
+            case AttributeArray::Kind::UVs: return attribs.uvs.get();
+            case AttributeArray::Kind::Indices: return attribs.indices.get();
+        }
+        return nullptr;
+    }
+}
+
+constexpr std::uint32_t MeshCache::FormatVersion;
+
+MeshCache::MeshCache(std::string const& directory) :
+    m_directory(directory),
+    m_hits(0),
+    m_misses(0)
+{ }
+
+MeshCache::~MeshCache() { }
+
+std::vector<std::unique_ptr<Mesh>> MeshCache::load(std::string const& file, SceneImporter::PostProcess pp,
+                                                   MeshBuilder::VertexLayout layout, MeshBuilder::Quantise quantise,
+                                                   MeshBuilder::Optimize optimize) {
+    Key k = key(file, pp, layout, quantise, optimize);
+    std::string p = path(k);
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    if(read(p, k, meshes)) {
+        ++m_hits;
+        return meshes;
+    }
+
+    ++m_misses;
+    SceneImporter importer;
+    importer.readFile(file, pp);
+    for(const aiMesh* m: importer.meshes()) {
+        meshes.push_back(importer.instantiateMesh(*m, layout, quantise, optimize));
+    }
+    write(p, k, meshes);
+    return meshes;
+}
+
+std::string MeshCache::entry(std::string const& file, SceneImporter::PostProcess pp,
+                             MeshBuilder::VertexLayout layout, MeshBuilder::Quantise quantise,
+                             MeshBuilder::Optimize optimize) const {
+    return path(key(file, pp, layout, quantise, optimize));
+}
+
+size_t MeshCache::hits() const { return m_hits; }
+size_t MeshCache::misses() const { return m_misses; }
+
+std::uint64_t MeshCache::hash(const void* data, size_t size, std::uint64_t seed) {
+    std::uint64_t h = seed;
+    std::uint64_t check = 0;
+    hashBlock(data, size, h, check);
+    return h;
+}
+
+MeshCache::Key MeshCache::key(std::string const& file, SceneImporter::PostProcess pp,
+                              MeshBuilder::VertexLayout layout, MeshBuilder::Quantise quantise,
+                              MeshBuilder::Optimize optimize) const {
+    using namespace boost::interprocess;
+    Key k = {0, 0x27d4eb2f165667c5ull, 0};
+    try {
+        file_mapping mapping(file.c_str(), read_only);
+        mapped_region region(mapping, read_only);
+        region.advise(mapped_region::advice_sequential);
+        k.size = region.get_size();
+        hashBlock(region.get_address(), region.get_size(), k.hash, k.check);
+    }
+    catch(interprocess_exception const& e) {
+        throw std::runtime_error("Failed to read " + file + ": " + e.what());
+    }
+    std::uint32_t options[5] = {FormatVersion, static_cast<std::uint32_t>(pp), static_cast<std::uint32_t>(layout),
+                                static_cast<std::uint32_t>(quantise), static_cast<std::uint32_t>(optimize)};
+    hashBlock(options, sizeof(options), k.hash, k.check);
+    return k;
+}
+
+std::string MeshCache::path(Key const& key) const {
+    std::ostringstream s;
+    s << m_directory << '/' << std::hex << std::setw(16) << std::setfill('0') << key.hash << ".tmc";
+    return s.str();
+}
+
+bool MeshCache::read(std::string const& path, Key const& key, std::vector<std::unique_ptr<Mesh>>& meshes) const {
+    using namespace boost::interprocess;
+    try {
+        file_mapping mapping(path.c_str(), read_only);
+        mapped_region region(mapping, read_only);
+        const char* base = static_cast<const char*>(region.get_address());
+        size_t size = region.get_size();
+
+        Header header;
+        if(size < sizeof(header))
+            return false;
+        std::memcpy(&header, base, sizeof(header));
+        if(std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != FormatVersion ||
+           header.key != key.hash || header.check != key.check || header.sourceSize != key.size)
+            return false;
+        if(size < sizeof(Header) + static_cast<std::uint64_t>(header.nMeshes) * sizeof(MeshRecord))
+            return false;
+        std::vector<MeshRecord> records(header.nMeshes);
+        std::memcpy(records.data(), base + sizeof(Header), records.size() * sizeof(MeshRecord));
+
+        // Check the whole file before uploading anything, a truncated entry
+        // is imported again
+        for(MeshRecord const& r: records) {
+            if(r.nBuffers > kAttributes || r.attributes[0].buffer < 0)
+                return false;
+            for(size_t b = 0 ; b != r.nBuffers ; ++b) {
+                if(r.buffers[b].offset > size || r.buffers[b].size > size - r.buffers[b].offset)
+                    return false;
+            }
+            for(AttributeRecord const& a: r.attributes) {
+                if(a.buffer >= static_cast<std::int32_t>(r.nBuffers))
+                    return false;
+            }
+        }
+
+        for(MeshRecord const& r: records) {
+            std::vector<std::unique_ptr<VBO>> resources;
+            for(size_t b = 0 ; b != r.nBuffers ; ++b) {
+                resources.emplace_back(new VBO());
+                resources.back()->upload_data(base + r.buffers[b].offset, r.buffers[b].size);
+            }
+            auto array = [&](size_t kind) {
+                AttributeRecord const& a = r.attributes[kind];
+                if(a.buffer < 0)
+                    return std::unique_ptr<AttributeArray>();
+                AttributeArray::Layout l(a.nComponents, static_cast<AttributeArray::Type>(a.type),
+                                         a.stride, a.normalize != 0, static_cast<std::intptr_t>(a.offset));
+                return std::unique_ptr<AttributeArray>(
+                    new AttributeArray(*resources[a.buffer], static_cast<AttributeArray::Kind>(kind), l));
+            };
+            AttributeMap attribs;
+            attribs.positions = std::move(*array(static_cast<size_t>(AttributeArray::Kind::Positions)));
+            attribs.normals = array(static_cast<size_t>(AttributeArray::Kind::Normals));
+            attribs.colors = array(static_cast<size_t>(AttributeArray::Kind::Colors));
+            attribs.uvs = array(static_cast<size_t>(AttributeArray::Kind::UVs));
+            attribs.indices = array(static_cast<size_t>(AttributeArray::Kind::Indices));
+
+            AABB aabb(glm::vec3(r.aabbMin[0], r.aabbMin[1], r.aabbMin[2]),
+                      glm::vec3(r.aabbMax[0], r.aabbMax[1], r.aabbMax[2]));
+            BoundingSphere sphere(glm::vec3(r.sphereCenter[0], r.sphereCenter[1], r.sphereCenter[2]),
+                                  r.sphereRadius);
+            std::unique_ptr<Mesh> mesh(new Mesh(std::string(r.name, std::find(r.name, r.name + sizeof(r.name), '\0')),
+                                                std::move(attribs), std::move(resources), r.nVertices, r.nIndices,
+                                                aabb, sphere));
+            mesh->m_vertexBytes = r.vertexBytes;
+            mesh->m_indexBytes = r.indexBytes;
+            mesh->m_quantisationError = {r.quantisationError[0], r.quantisationError[1], r.quantisationError[2],
+                                         r.quantisationError[3]};
+            std::memcpy(&mesh->m_positionTransform[0][0], r.positionTransform, sizeof(r.positionTransform));
+            mesh->m_vertexCacheReport = {{r.vertexCache[0], r.vertexCache[1]}, {r.vertexCache[2], r.vertexCache[3]}};
+            meshes.push_back(std::move(mesh));
+        }
+    }
+    catch(interprocess_exception const&) {
+        // No entry yet
+        return false;
+    }
+    return true;
+}
+
+void MeshCache::write(std::string const& path, Key const& key,
+                      std::vector<std::unique_ptr<Mesh>> const& meshes) const {
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = FormatVersion;
+    header.key = key.hash;
+    header.check = key.check;
+    header.sourceSize = key.size;
+    header.nMeshes = static_cast<std::uint32_t>(meshes.size());
+    header.padding = 0;
+
+    std::vector<MeshRecord> records(meshes.size());
+    // Buffers in the order of their content in the file
+    std::vector<std::pair<const VBO*, std::uint64_t>> buffers;
+    std::uint64_t offset = alignOffset(sizeof(Header) + records.size() * sizeof(MeshRecord));
+    size_t largest = 0;
+    for(size_t i = 0 ; i != meshes.size() ; ++i) {
+        Mesh const& m = *meshes[i];
+        // The geometry of the arena meshes is shared with other meshes
+        if(m.arena())
+            return;
+        MeshRecord& r = records[i];
+        std::memset(&r, 0, sizeof(r));
+        std::strncpy(r.name, m.name(), sizeof(r.name) - 1);
+        r.nVertices = m.m_nVertices;
+        r.nIndices = m.m_nIndices;
+
+        std::vector<const VBO*> meshBuffers;
+        for(size_t k = 0 ; k != kAttributes ; ++k) {
+            AttributeArray const* a = attribute(m.m_attribs, k);
+            AttributeRecord& ar = r.attributes[k];
+            ar.buffer = -1;
+            if(!a)
+                continue;
+            auto it = std::find(meshBuffers.begin(), meshBuffers.end(), a->vbo);
+            if(it == meshBuffers.end()) {
+                size_t size = a->vbo->size();
+                r.buffers[meshBuffers.size()] = {offset, size};
+                buffers.push_back({a->vbo, offset});
+                offset = alignOffset(offset + size);
+                largest = std::max(largest, size);
+                it = meshBuffers.insert(meshBuffers.end(), a->vbo);
+            }
+            ar.buffer = static_cast<std::int32_t>(it - meshBuffers.begin());
+            ar.nComponents = a->layout.nComponents();
+            ar.type = static_cast<std::uint32_t>(a->layout.type());
+            ar.normalize = a->layout.normalize();
+            ar.stride = a->layout.stride();
+            ar.offset = a->layout.offset();
+        }
+        r.nBuffers = static_cast<std::uint32_t>(meshBuffers.size());
+
+        glm::vec3 const& min = m.m_aabb.min();
+        glm::vec3 const& max = m.m_aabb.max();
+        glm::vec3 center = m.m_sphere.center();
+        for(int c = 0 ; c != 3 ; ++c) {
+            r.aabbMin[c] = min[c];
+            r.aabbMax[c] = max[c];
+            r.sphereCenter[c] = center[c];
+        }
+        r.sphereRadius = m.m_sphere.radius();
+        std::memcpy(r.positionTransform, &m.m_positionTransform[0][0], sizeof(r.positionTransform));
+        Mesh::QuantisationError const& e = m.m_quantisationError;
+        r.quantisationError[0] = e.position;
+        r.quantisationError[1] = e.normal;
+        r.quantisationError[2] = e.uv;
+        r.quantisationError[3] = e.color;
+        Mesh::VertexCacheReport const& v = m.m_vertexCacheReport;
+        r.vertexCache[0] = v.before.acmr;
+        r.vertexCache[1] = v.before.atvr;
+        r.vertexCache[2] = v.after.acmr;
+        r.vertexCache[3] = v.after.atvr;
+        r.vertexBytes = m.m_vertexBytes;
+        r.indexBytes = m.m_indexBytes;
+    }
+
+    // Written next to the entry and renamed, so that an interrupted write
+    // doesn't leave a truncated entry behind
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    // The cache is only an optimisation, the meshes are loaded anyway
+    if(!out.is_open())
+        return;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(MeshRecord)));
+    const char padding[kAlignment] = {};
+    std::vector<char> data(largest);
+    for(auto const& b: buffers) {
+        std::uint64_t position = static_cast<std::uint64_t>(out.tellp());
+        out.write(padding, static_cast<std::streamsize>(b.second - position));
+        b.first->read_data(data.data(), b.first->size());
+        out.write(data.data(), static_cast<std::streamsize>(b.first->size()));
+    }
+    out.close();
+    if(!out) {
+        std::remove(tmp.c_str());
+        return;
+    }
+    std::remove(path.c_str());
+    std::rename(tmp.c_str(), path.c_str());
+}
+
+} // namespace Engine
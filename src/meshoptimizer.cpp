@@ -0,0 +1,296 @@
+#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Engine {
+
+namespace {
+    /* Size of the LRU cache modelled by the vertex cache optimisation */
+    constexpr size_t kCacheSize = 32;
+    constexpr unsigned int kNone = std::numeric_limits<unsigned int>::max();
+
+    /* Forsyth's vertex score, favouring the vertices that are in the cache and
+     * the ones that have few triangles left to draw */
+    float vertexScore(int cachePosition, unsigned int remaining) {
+        if(!remaining)
+            return -1.f;
+        float score = 0.f;
+        if(cachePosition >= 0) {
+            if(cachePosition < 3) {
+                // The vertices of the last triangle are scored lower so that
+                // strips don't get too long
+                score = 0.75f;
+            }
+            else {
+                float s = 1.f - static_cast<float>(cachePosition - 3) / (kCacheSize - 3);
+                score = std::pow(s, 1.5f);
+            }
+        }
+        return score + 2.f / std::sqrt(static_cast<float>(remaining));
+    }
+
+    /* Per-triangle cache misses of a FIFO cache */
+    std::vector<unsigned char> cacheMisses(std::vector<unsigned int> const& indices, size_t nVertices,
+                                           size_t cacheSize) {
+        std::vector<unsigned char> misses(indices.size() / 3, 0);
+        // Time at which a vertex entered the cache, which is enough to model
+        // a FIFO: a vertex is in the cache while less than cacheSize vertices
+        // entered it after
+        std::vector<size_t> entered(nVertices, 0);
+        size_t time = cacheSize + 1;
+        for(size_t t = 0 ; t != misses.size() ; ++t) {
+            for(size_t k = 0 ; k != 3 ; ++k) {
+                unsigned int v = indices[3 * t + k];
+                if(time - entered[v] > cacheSize) {
+                    entered[v] = time++;
+                    ++misses[t];
+                }
+            }
+        }
+        return misses;
+    }
+}
+
+VertexCacheStats analyzeVertexCache(std::vector<unsigned int> const& indices, size_t nVertices,
+                                    size_t cacheSize) {
+    VertexCacheStats stats{0.f, 0.f};
+    if(indices.empty())
+        return stats;
+    std::vector<unsigned char> misses = cacheMisses(indices, nVertices, cacheSize);
+    size_t transformed = 0;
+    for(unsigned char m: misses) {
+        transformed += m;
+    }
+    std::vector<bool> used(nVertices, false);
+    size_t nUsed = 0;
+    for(unsigned int i: indices) {
+        if(!used[i]) {
+            used[i] = true;
+            ++nUsed;
+        }
+    }
+    stats.acmr = static_cast<float>(transformed) / misses.size();
+    stats.atvr = static_cast<float>(transformed) / nUsed;
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t nVertices) {
+    size_t nTriangles = indices.size() / 3;
+    if(nTriangles < 2)
+        return;
+
+    // Triangles using each vertex, the ones already drawn are moved past the
+    // end of the live range
+    std::vector<unsigned int> remaining(nVertices, 0);
+    for(unsigned int i: indices) {
+        ++remaining[i];
+    }
+    std::vector<unsigned int> first(nVertices + 1, 0);
+    for(size_t v = 0 ; v != nVertices ; ++v) {
+        first[v + 1] = first[v] + remaining[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+        for(size_t t = 0 ; t != nTriangles ; ++t) {
+            for(size_t k = 0 ; k != 3 ; ++k) {
+                adjacency[fill[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+            }
+        }
+    }
+
+    std::vector<int> cachePosition(nVertices, -1);
+    std::vector<float> score(nVertices);
+    for(size_t v = 0 ; v != nVertices ; ++v) {
+        score[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScore(nTriangles);
+    for(size_t t = 0 ; t != nTriangles ; ++t) {
+        triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+    }
+    std::vector<bool> drawn(nTriangles, false);
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    std::vector<unsigned int> cache, next;
+    cache.reserve(kCacheSize + 3);
+    next.reserve(kCacheSize + 3);
+    // First triangle not drawn yet, used when no triangle in the cache is
+    // left to draw
+    size_t cursor = 0;
+    unsigned int best = static_cast<unsigned int>(
+        std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+
+    for(size_t n = 0 ; n != nTriangles ; ++n) {
+        if(best == kNone) {
+            while(drawn[cursor]) {
+                ++cursor;
+            }
+            best = static_cast<unsigned int>(cursor);
+        }
+        drawn[best] = true;
+        unsigned int const* tri = &indices[3 * best];
+        output.insert(output.end(), tri, tri + 3);
+
+        // Push the vertices of the triangle at the front of the cache
+        next.assign(tri, tri + 3);
+        for(unsigned int v: cache) {
+            if(v != tri[0] && v != tri[1] && v != tri[2])
+                next.push_back(v);
+        }
+        for(size_t k = 0 ; k != 3 ; ++k) {
+            unsigned int v = tri[k];
+            auto begin = adjacency.begin() + first[v];
+            auto end = begin + remaining[v];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            --remaining[v];
+        }
+        std::swap(cache, next);
+        // next now holds the vertices pushed out of the cache
+        next.assign(cache.begin() + std::min(cache.size(), kCacheSize), cache.end());
+        if(cache.size() > kCacheSize)
+            cache.resize(kCacheSize);
+        for(unsigned int v: next) {
+            cachePosition[v] = -1;
+        }
+
+        // Rescore the vertices in the cache and the ones that left it, and
+        // their triangles
+        for(size_t i = 0 ; i != cache.size() ; ++i) {
+            cachePosition[cache[i]] = static_cast<int>(i);
+        }
+        best = kNone;
+        float bestScore = -std::numeric_limits<float>::max();
+        auto rescore = [&](unsigned int v) {
+            float s = vertexScore(cachePosition[v], remaining[v]);
+            float delta = s - score[v];
+            score[v] = s;
+            for(unsigned int i = first[v] ; i != first[v] + remaining[v] ; ++i) {
+                unsigned int t = adjacency[i];
+                triangleScore[t] += delta;
+            }
+        };
+        for(unsigned int v: next) {
+            rescore(v);
+        }
+        for(unsigned int v: cache) {
+            rescore(v);
+        }
+        for(unsigned int v: cache) {
+            for(unsigned int i = first[v] ; i != first[v] + remaining[v] ; ++i) {
+                unsigned int t = adjacency[i];
+                if(triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+    indices = std::move(output);
+}
+
+void optimizeOverdraw(std::vector<unsigned int>& indices, std::vector<glm::vec3> const& positions,
+                      float threshold) {
+    size_t nTriangles = indices.size() / 3;
+    if(nTriangles < 2)
+        return;
+
+    constexpr size_t cacheSize = 16;
+    std::vector<unsigned char> misses = cacheMisses(indices, positions.size(), cacheSize);
+    size_t totalMisses = 0;
+    for(unsigned char m: misses) {
+        totalMisses += m;
+    }
+    float acmr = static_cast<float>(totalMisses) / nTriangles;
+
+    // Split the list in clusters starting where the cache is flushed, or where
+    // the current cluster, drawn first with an empty cache, would reuse the
+    // cache well enough. The misses of the cluster are counted with a cache
+    // flushed at its start.
+    std::vector<size_t> clusters;
+    std::vector<size_t> entered(positions.size(), 0);
+    size_t time = cacheSize + 1;
+    size_t clusterMisses = 0;
+    for(size_t t = 0 ; t != nTriangles ; ++t) {
+        size_t size = clusters.empty() ? 0 : t - clusters.back();
+        bool flushed = misses[t] == 3;
+        bool efficient = size && static_cast<float>(clusterMisses) / size <= threshold * acmr;
+        if(clusters.empty() || flushed || efficient) {
+            clusters.push_back(t);
+            clusterMisses = 0;
+            time += cacheSize;
+        }
+        for(size_t k = 0 ; k != 3 ; ++k) {
+            unsigned int v = indices[3 * t + k];
+            if(time - entered[v] > cacheSize) {
+                entered[v] = time++;
+                ++clusterMisses;
+            }
+        }
+    }
+    clusters.push_back(nTriangles);
+
+    glm::vec3 meshCenter(0.f);
+    float meshArea = 0.f;
+    std::vector<glm::vec3> centers(clusters.size() - 1);
+    std::vector<glm::vec3> normals(clusters.size() - 1);
+    for(size_t c = 0 ; c + 1 != clusters.size() ; ++c) {
+        glm::vec3 center(0.f), normal(0.f);
+        float area = 0.f;
+        for(size_t t = clusters[c] ; t != clusters[c + 1] ; ++t) {
+            glm::vec3 const& a = positions[indices[3 * t]];
+            glm::vec3 const& b = positions[indices[3 * t + 1]];
+            glm::vec3 const& d = positions[indices[3 * t + 2]];
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(n);
+            center += (a + b + d) * (triangleArea / 3.f);
+            normal += n;
+            area += triangleArea;
+        }
+        meshCenter += center;
+        meshArea += area;
+        centers[c] = area > 0.f ? center / area : positions[indices[3 * clusters[c]]];
+        normals[c] = normal;
+    }
+    if(meshArea > 0.f)
+        meshCenter = meshCenter / meshArea;
+
+    // Clusters facing away from the center occlude the others from most
+    // viewpoints, so they are drawn first
+    std::vector<float> key(clusters.size() - 1);
+    for(size_t c = 0 ; c != key.size() ; ++c) {
+        float length = glm::length(normals[c]);
+        key[c] = length > 0.f ? glm::dot(centers[c] - meshCenter, normals[c] / length) : 0.f;
+    }
+    std::vector<size_t> order(key.size());
+    for(size_t c = 0 ; c != order.size() ; ++c) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&key](size_t a, size_t b) { return key[a] > key[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for(size_t c: order) {
+        output.insert(output.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * clusters[c + 1]);
+    }
+    indices = std::move(output);
+}
+
+std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t nVertices) {
+    std::vector<unsigned int> remap(nVertices, kNone);
+    unsigned int next = 0;
+    for(unsigned int& i: indices) {
+        if(remap[i] == kNone)
+            remap[i] = next++;
+        i = remap[i];
+    }
+    for(unsigned int& r: remap) {
+        if(r == kNone)
+            r = next++;
+    }
+    return remap;
+}
+
+} // namespace Engine
@@ -1,6 +1,9 @@
 #include "program.h"
+#include "attribute.h"
 #include "utility.h"
 #include "debug.h"
+#include "glstate.h"
+#include "uniformbuffers.h"
 
 #include <algorithm>
 #include <sstream>
@@ -16,7 +19,8 @@ ProgramHandle::ProgramHandle(GLuint handle) :
 { }
 
 ProgramHandle::~ProgramHandle() {
-    glDeleteShader(m_handle);
+    GLState::programDeleted(m_handle);
+    glDeleteProgram(m_handle);
 }
 
 GLuint ProgramHandle::value() const {
@@ -39,17 +43,23 @@ ProgramBuilder ShaderManager::buildProgram() { return ProgramBuilder(*this); }
 
 Program::Program() :
     m_id(0),
-    m_uniforms()
+    m_uniforms(),
+    m_uniformCounters{0, 0},
+    m_objectBlock(false)
 { }
 
 Program::Program(std::shared_ptr<ProgramHandle> id, std::vector<UniformBase*> uniforms) :
     m_id(id),
-    m_uniforms(uniforms)
+    m_uniforms(uniforms),
+    m_uniformCounters{0, 0},
+    m_objectBlock(false)
 { }
 
 Program::Program(Program&& other) :
     m_id(other.m_id),
-    m_uniforms(std::move(other.m_uniforms))
+    m_uniforms(std::move(other.m_uniforms)),
+    m_uniformCounters(other.m_uniformCounters),
+    m_objectBlock(other.m_objectBlock)
 {
     other.m_id = 0;
 }
@@ -60,6 +70,8 @@ Program& Program::operator=(Program&& other) {
     }
     m_id = other.m_id;
     m_uniforms = std::move(other.m_uniforms);
+    m_uniformCounters = other.m_uniformCounters;
+    m_objectBlock = other.m_objectBlock;
     other.m_id = 0;
     return *this;
 }
@@ -102,12 +114,12 @@ std::string Program::info_log() const {
 
 
 void Program::use() const {
-    glUseProgram(m_id->value());
+    GLState::useProgram(m_id->value());
     s_current = this;
 }
 
 void Program::noProgram() {
-    glUseProgram(0);
+    GLState::useProgram(0);
     s_current = nullptr;
 }
 
@@ -121,14 +133,28 @@ UniformBase* Program::getUniform(std::string const& name) {
 }
 
 void Program::uploadUniforms() {
-    const Program* previous = s_current;
-    if(!is_current())
-        use();
+    use();
     for(auto it = m_uniforms.begin() ; it != m_uniforms.end() ; ++it) {
-        (*it)->upload();
+        if((*it)->upload())
+            ++m_uniformCounters.uploaded;
+        else
+            ++m_uniformCounters.skipped;
     }
-    if(previous != this && previous != nullptr)
-        previous->use();
+}
+
+bool Program::usesObjectBlock() const { return m_objectBlock; }
+
+void Program::invalidateUniforms() {
+    for(auto& it: m_uniforms) {
+        it->m_clean = false;
+    }
+}
+
+Program::UniformCounters const& Program::uniformCounters() const { return m_uniformCounters; }
+
+void Program::resetUniformCounters() {
+    m_uniformCounters.uploaded = 0;
+    m_uniformCounters.skipped = 0;
 }
 
 bool Program::is_current() const { return this == s_current; }
@@ -200,6 +226,19 @@ ProgramBuilder& ProgramBuilder::geometryShader(std::string const& file) {
     return *this;
 }
 
+ProgramBuilder& ProgramBuilder::shaderSource(GLenum type, std::string const& source, std::string const& name) {
+    Shader* s = new Shader(type, source);
+    if(!*s) {
+        std::ostringstream ss;
+        ss << "Shader compilation error in " << name << std::endl
+           << "Info:" << std::endl << s->info_log();
+        delete s;
+        throw std::runtime_error(ss.str());
+    }
+    m_shaders.push_back(s);
+    return *this;
+}
+
 ProgramBuilder& ProgramBuilder::uniform(std::string const& name, UniformType t) {
     m_uniforms.push_back(std::pair<std::string, UniformType>(name, t));
     return *this;
@@ -213,6 +252,12 @@ Program ProgramBuilder::build() {
         glAttachShader(h->value(), shader->m_id);
     }
 
+    // Engine attributes have the same location in every program
+    glBindAttribLocation(h->value(), PositionAttribute, "v_position");
+    glBindAttribLocation(h->value(), NormalAttribute, "v_normal");
+    glBindAttribLocation(h->value(), ColorAttribute, "v_color");
+    glBindAttribLocation(h->value(), TexCoordAttribute, "v_texCoord");
+    glBindAttribLocation(h->value(), InstanceWorldAttribute, "i_world");
     glLinkProgram(h->value());
     for(auto shader: shaders) {
         glDetachShader(h->value(), shader->m_id);
@@ -246,6 +291,15 @@ Program ProgramBuilder::build() {
     #undef TYPE
     Program p(h, v);
     v.clear();
+    // Bind the blocks shared by every program to their engine binding points
+    GLuint frameBlock = glGetUniformBlockIndex(h->value(), "Frame");
+    if(frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(h->value(), frameBlock, FrameBlockBinding);
+    GLuint objectBlock = glGetUniformBlockIndex(h->value(), "Object");
+    if(objectBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(h->value(), objectBlock, ObjectBlockBinding);
+        p.m_objectBlock = true;
+    }
     if(!p) {
         std::ostringstream ss;
         ss << "Shader program link error." << std::endl
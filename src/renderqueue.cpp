@@ -0,0 +1,340 @@
+#include "renderqueue.h"
+#include "scenegraph.h"
+#include "program.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <glbinding/gl/functions.h>
+
+using namespace gl;
+
+namespace Engine {
+
+namespace {
+    /* Key layout, from the most significant bit:
+     *   Opaque:      pass (1) | program (13) | texture (13) | vao (13) | depth (24)
+     *   Transparent: pass (1) | ~depth (24) | program (13) | texture (13) | vao (13) */
+    constexpr unsigned int resourceBits = 13;
+    constexpr unsigned int depthBits = 24;
+    constexpr std::uint64_t resourceMask = (std::uint64_t(1) << resourceBits) - 1;
+    constexpr std::uint64_t depthMask = (std::uint64_t(1) << depthBits) - 1;
+
+    /* The bit pattern of a non-negative float increases with its value, so
+     * its upper bits make a good fixed-size depth key. */
+    std::uint64_t depthKey(float depth) {
+        if(!(depth > 0.f))
+            depth = 0.f;
+        std::uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return (bits >> (32 - depthBits)) & depthMask;
+    }
+
+    /* Fields of a DrawElementsIndirectCommand */
+    constexpr size_t commandSize = 5;
+}
+
+constexpr std::uint32_t RenderQueue::NoSlot;
+
+RenderQueue::RenderQueue() :
+    m_items(),
+    m_keys(),
+    m_sortedKeys(),
+    m_order(),
+    m_tmpKeys(),
+    m_tmpOrder(),
+    m_programIds(),
+    m_textureIds(),
+    m_vaoIds(),
+    m_sorting(true),
+    m_sorted(false),
+    m_stats{0, 0, 0, 0, 0},
+    m_objectUniforms(false),
+    m_objects(),
+    m_slots(),
+    m_multiDraw(MultiDraw::BaseVertex),
+    m_counts(),
+    m_offsets(),
+    m_baseVertices(),
+    m_commands(),
+    m_indirect()
+{ }
+
+RenderQueue::~RenderQueue() { }
+
+void RenderQueue::clear() {
+    m_items.clear();
+    m_keys.clear();
+    m_sorted = false;
+    /* The maps keep every resource ever queued, deleted ones included. Start
+     * over once the ids no longer fit in the key fields, rather than let the
+     * new resources alias the old ones. */
+    for(auto* ids: {&m_programIds, &m_textureIds, &m_vaoIds}) {
+        if(ids->size() > resourceMask)
+            ids->clear();
+    }
+}
+
+void RenderQueue::push(DrawableNode* node, glm::mat4 const* world, float depth) {
+    Pass pass = node->transparent() ? Pass::Transparent : Pass::Opaque;
+    m_keys.push_back(makeKey(pass,
+                             resourceId(m_programIds, node->program()),
+                             resourceId(m_textureIds, node->texture()),
+                             resourceId(m_vaoIds, node->vao()),
+                             depth));
+    m_items.push_back({node, world});
+    m_sorted = false;
+}
+
+size_t RenderQueue::size() const { return m_items.size(); }
+
+void RenderQueue::set_sorting(bool enable) { m_sorting = enable; }
+bool RenderQueue::sorting() const { return m_sorting; }
+
+void RenderQueue::set_object_uniforms(bool enable) { m_objectUniforms = enable; }
+bool RenderQueue::objectUniforms() const { return m_objectUniforms; }
+
+void RenderQueue::set_multi_draw(MultiDraw mode) {
+    if(mode == MultiDraw::Indirect && !indirectSupported())
+        mode = MultiDraw::BaseVertex;
+    m_multiDraw = mode;
+}
+
+RenderQueue::MultiDraw RenderQueue::multiDraw() const { return m_multiDraw; }
+
+bool RenderQueue::indirectSupported() {
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for(GLint i = 0 ; i < n ; ++i) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if(ext && std::strcmp(ext, "GL_ARB_multi_draw_indirect") == 0)
+            return true;
+    }
+    return false;
+}
+
+void RenderQueue::sort() {
+    if(m_sorted)
+        return;
+    m_sortedKeys = m_keys;
+    m_order.resize(m_items.size());
+    std::iota(m_order.begin(), m_order.end(), 0u);
+    radix_sort(m_sortedKeys, m_order, m_tmpKeys, m_tmpOrder);
+    m_sorted = true;
+}
+
+void RenderQueue::submit() {
+    m_stats = {0, 0, 0, 0, 0};
+    if(m_sorting)
+        sort();
+    if(m_objectUniforms)
+        uploadObjects();
+    if(m_sorting && m_multiDraw == MultiDraw::Indirect && !m_items.empty()) {
+        /* Orphan the indirect buffer, the merged draw calls of the frame are
+         * written to it one after the other */
+        if(!m_indirect)
+            m_indirect.reset(new VBO());
+        size_t size = m_items.size() * commandSize * sizeof(GLuint);
+        if(size > m_indirect->size())
+            m_indirect->allocate(size, GL_STREAM_DRAW);
+        else
+            m_indirect->orphan();
+        m_commands.clear();
+    }
+    if(!m_sorting) {
+        for(std::uint32_t i = 0 ; i != m_items.size() ; ++i) {
+            Item const& item = m_items[i];
+            bindObject(i);
+            item.node->draw(*item.world);
+            ++m_stats.programBinds;
+            ++m_stats.vaoBinds;
+            ++m_stats.textureBinds;
+            ++m_stats.drawCalls;
+        }
+        return;
+    }
+
+    /* Nothing is assumed about the bindings at the start of the frame */
+    bool known = false;
+    Program* program = nullptr;
+    VAO* vao = nullptr;
+    Texture const* tex = nullptr;
+    for(size_t k = 0 ; k != m_order.size() ; ++k) {
+        std::uint32_t i = m_order[k];
+        Item const& item = m_items[i];
+        DrawableNode* node = item.node;
+        bindObject(i);
+        if(!node->queueable()) {
+            /* The node binds and unbinds its own state */
+            node->draw(*item.world);
+            ++m_stats.programBinds;
+            ++m_stats.vaoBinds;
+            ++m_stats.textureBinds;
+            ++m_stats.drawCalls;
+            known = false;
+            continue;
+        }
+        if(!known || node->program() != program) {
+            program = node->program();
+            program->use();
+            ++m_stats.programBinds;
+        }
+        if(!known || node->vao() != vao) {
+            vao = node->vao();
+            vao->bind();
+            ++m_stats.vaoBinds;
+        }
+        if(!known || node->texture() != tex) {
+            tex = node->texture();
+            if(tex)
+                tex->bind();
+            else
+                Texture::unbind();
+            ++m_stats.textureBinds;
+        }
+        known = true;
+        size_t n = mergeable(k);
+        if(n > 1) {
+            multiDraw(k, n);
+            k += n - 1;
+        }
+        else {
+            node->drawCall(*item.world);
+        }
+        ++m_stats.drawCalls;
+    }
+}
+
+RenderQueue::Stats const& RenderQueue::stats() const { return m_stats; }
+
+void RenderQueue::uploadObjects() {
+    m_objects.clear();
+    m_slots.assign(m_items.size(), NoSlot);
+    auto add = [this](std::uint32_t i) {
+        Item const& item = m_items[i];
+        if(item.node->program() && item.node->program()->usesObjectBlock())
+            m_slots[i] = m_objects.push(*item.world * item.node->geometryTransform());
+    };
+    /* Write the blocks in the order they are drawn */
+    if(m_sorting) {
+        for(std::uint32_t i: m_order) {
+            add(i);
+        }
+    }
+    else {
+        for(std::uint32_t i = 0 ; i != m_items.size() ; ++i) {
+            add(i);
+        }
+    }
+    m_objects.upload();
+}
+
+void RenderQueue::bindObject(std::uint32_t i) {
+    if(m_objectUniforms && m_slots[i] != NoSlot)
+        m_objects.bind(m_slots[i]);
+}
+
+size_t RenderQueue::mergeable(size_t k) const {
+    auto geometry = [this](std::uint32_t i) {
+        if(m_objectUniforms && m_slots[i] != NoSlot)
+            return static_cast<MeshArena::Allocation const*>(nullptr);
+        return m_items[i].node->mergeableGeometry();
+    };
+    if(m_multiDraw == MultiDraw::Off || !geometry(m_order[k]))
+        return 1;
+    DrawableNode const* first = m_items[m_order[k]].node;
+    size_t n = 1;
+    for(size_t j = k + 1 ; j != m_order.size() ; ++j, ++n) {
+        DrawableNode const* node = m_items[m_order[j]].node;
+        if(node->program() != first->program() || node->vao() != first->vao() ||
+           node->texture() != first->texture() || node->primitiveMode() != first->primitiveMode() ||
+           !geometry(m_order[j]))
+            break;
+    }
+    return n;
+}
+
+void RenderQueue::multiDraw(size_t k, size_t n) {
+    DrawableNode const* first = m_items[m_order[k]].node;
+    first->program()->uploadUniforms();
+    if(m_multiDraw == MultiDraw::Indirect) {
+        size_t start = m_commands.size();
+        for(size_t j = k ; j != k + n ; ++j) {
+            MeshArena::Allocation const* a = m_items[m_order[j]].node->mergeableGeometry();
+            // count, instanceCount, firstIndex, baseVertex, baseInstance
+            m_commands.insert(m_commands.end(), {a->indexCount(), 1u, a->firstIndex(), a->baseVertex(), 0u});
+        }
+        m_indirect->update_data(m_commands[start], n * commandSize * sizeof(GLuint),
+                                static_cast<ptrdiff_t>(start * sizeof(GLuint)));
+        m_indirect->bind(GL_DRAW_INDIRECT_BUFFER);
+        glMultiDrawElementsIndirect(first->primitiveMode(), GL_UNSIGNED_INT,
+                                    reinterpret_cast<const void*>(start * sizeof(GLuint)),
+                                    static_cast<GLsizei>(n), 0);
+    }
+    else {
+        m_counts.clear();
+        m_offsets.clear();
+        m_baseVertices.clear();
+        for(size_t j = k ; j != k + n ; ++j) {
+            MeshArena::Allocation const* a = m_items[m_order[j]].node->mergeableGeometry();
+            m_counts.push_back(static_cast<GLsizei>(a->indexCount()));
+            m_offsets.push_back(reinterpret_cast<const void*>(a->firstIndex() * sizeof(GLuint)));
+            m_baseVertices.push_back(static_cast<GLint>(a->baseVertex()));
+        }
+        glMultiDrawElementsBaseVertex(first->primitiveMode(), m_counts.data(), GL_UNSIGNED_INT,
+                                      m_offsets.data(), static_cast<GLsizei>(n), m_baseVertices.data());
+    }
+    m_stats.merged += n;
+}
+
+std::uint64_t RenderQueue::makeKey(Pass pass, std::uint32_t program, std::uint32_t texture,
+                                   std::uint32_t vao, float depth) {
+    std::uint64_t state = ((program & resourceMask) << (2 * resourceBits)) |
+                          ((texture & resourceMask) << resourceBits) |
+                          (vao & resourceMask);
+    std::uint64_t d = depthKey(depth);
+    if(pass == Pass::Opaque)
+        return (state << depthBits) | d;
+    return (std::uint64_t(1) << 63) | ((~d & depthMask) << (3 * resourceBits)) | state;
+}
+
+void RenderQueue::radix_sort(std::vector<std::uint64_t>& keys, std::vector<std::uint32_t>& values,
+                             std::vector<std::uint64_t>& tmpKeys, std::vector<std::uint32_t>& tmpValues) {
+    size_t n = keys.size();
+    tmpKeys.resize(n);
+    tmpValues.resize(n);
+    for(unsigned int shift = 0 ; shift != 64 ; shift += 8) {
+        size_t counts[256] = {};
+        for(size_t i = 0 ; i != n ; ++i) {
+            ++counts[(keys[i] >> shift) & 0xFF];
+        }
+        /* Skip the pass if every key has the same digit, which is common for
+         * the upper bits of the resource indices */
+        if(n == 0 || counts[(keys[0] >> shift) & 0xFF] == n)
+            continue;
+        size_t offset = 0;
+        for(size_t& c: counts) {
+            size_t count = c;
+            c = offset;
+            offset += count;
+        }
+        for(size_t i = 0 ; i != n ; ++i) {
+            size_t dst = counts[(keys[i] >> shift) & 0xFF]++;
+            tmpKeys[dst] = keys[i];
+            tmpValues[dst] = values[i];
+        }
+        keys.swap(tmpKeys);
+        values.swap(tmpValues);
+    }
+}
+
+std::uint32_t RenderQueue::resourceId(std::unordered_map<const void*, std::uint32_t>& ids, const void* p) {
+    auto it = ids.find(p);
+    if(it != ids.end())
+        return it->second;
+    std::uint32_t id = static_cast<std::uint32_t>(ids.size());
+    ids.emplace(p, id);
+    return id;
+}
+
+} // namespace Engine
@@ -1,11 +1,19 @@
 #include "scenegraph.h"
 #include "glm/gtc/matrix_inverse.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stack>
+
 using namespace gl;
 
 namespace Engine {
 
 Node::Node(glm::mat4 const& position, std::string const& name, bool enabled) :
+    m_parent(nullptr),
+    m_graph(nullptr),
+    m_index(-1),
     m_enabled(enabled),
     m_position(position),
     m_children(),
@@ -22,6 +30,8 @@ Node::~Node() {
 int Node::addChild(Node* n) {
     int i = nextId();
     m_children.insert(std::pair<int, Node*>(i, n));
+    n->m_parent = this;
+    structureChanged();
     return i;
 }
 
@@ -29,6 +39,7 @@ void Node::removeChildById(int id) {
     try {
         delete m_children.at(id);
         m_children.erase(id);
+        structureChanged();
     }
     catch(std::out_of_range) { }
 }
@@ -47,20 +58,70 @@ glm::mat4 Node::transform() const {
 
 void Node::set_transform(glm::mat4 const& m) {
     m_position = m;
+    if(m_graph)
+        m_graph->m_storage.set_local(m_index, m);
 }
 
 int Node::nextId() {
     return m_id++;
 }
 
-SceneGraph::SceneGraph() :
+void Node::structureChanged() {
+    if(m_parent)
+        m_parent->structureChanged();
+}
+
+SceneGraph::SceneGraph(Storage storage) :
     Node(),
-    m_matrixStack()
+    m_storageMode(storage),
+    m_matrixStack(),
+    m_storage(),
+    m_threadPool(nullptr),
+    m_queue(),
+    m_view(1.f),
+    m_projection(1.f),
+    m_hasProjection(false),
+    m_culling(true),
+    m_minScreenSize(0.f),
+    m_cullStats{0, 0, 0},
+    m_localBounds(),
+    m_worldBounds(),
+    m_visible(),
+    m_enabledBefore(1, 0),
+    m_movedDrawables(),
+    m_changedBounds(),
+    m_useBVH(false),
+    m_bvhRebuildFraction(0.1f),
+    m_bvh(),
+    m_worldBoxes(),
+    m_unbounded(),
+    m_bvhHits(),
+    m_bvhDirty(true),
+    m_movedSinceBuild(0),
+    m_pendingBVH(),
+    m_bvhBuild(),
+    m_drawables(),
+    m_drawableNodes(),
+    m_rootIndices(),
+    m_structureDirty(true),
+    m_updatedNodes(0),
+    m_uniformBuffers(false),
+    m_time(0.f),
+    m_frameUBO()
 { }
 
 SceneGraph::~SceneGraph() { }
 
 void SceneGraph::render() {
+    if(m_uniformBuffers)
+        uploadFrameUniforms();
+    if(m_storageMode == Storage::Flat) {
+        if(m_structureDirty)
+            flatten();
+        renderFlat(0, static_cast<int>(m_storage.size()));
+        return;
+    }
+    m_updatedNodes = 0;
     for(auto it = m_children.begin() ; it != m_children.end() ; ++it) {
         Node* n = it->second;
         render(n);
@@ -68,6 +129,17 @@ void SceneGraph::render() {
 }
 
 void SceneGraph::render(int id) {
+    if(m_uniformBuffers)
+        uploadFrameUniforms();
+    if(m_storageMode == Storage::Flat) {
+        if(m_structureDirty)
+            flatten();
+        auto it = m_rootIndices.find(id);
+        if(it != m_rootIndices.end())
+            renderFlat(it->second, m_storage.subtree_end(it->second));
+        return;
+    }
+    m_updatedNodes = 0;
     try {
         Node* n = m_children.at(id);
         render(n);
@@ -75,8 +147,310 @@ void SceneGraph::render(int id) {
     catch(std::out_of_range) { }
 }
 
+SceneGraph::Storage SceneGraph::storage() const { return m_storageMode; }
+
+size_t SceneGraph::updatedNodes() const {
+    return (m_storageMode == Storage::Flat) ? m_storage.updatedNodes() : m_updatedNodes;
+}
+
+void SceneGraph::set_thread_pool(ThreadPool* pool) {
+    m_threadPool = pool;
+}
+
+void SceneGraph::set_view(glm::mat4 const& worldToCamera) {
+    m_view = worldToCamera;
+}
+
+RenderQueue& SceneGraph::renderQueue() { return m_queue; }
+
+RenderQueue::Stats const& SceneGraph::renderStats() const { return m_queue.stats(); }
+
+void SceneGraph::set_projection(glm::mat4 const& projection) {
+    m_projection = projection;
+    m_hasProjection = true;
+}
+
+void SceneGraph::set_culling(bool enable) {
+    m_culling = enable;
+}
+
+void SceneGraph::set_min_screen_size(float fraction) {
+    m_minScreenSize = fraction;
+}
+
+SceneGraph::CullStats const& SceneGraph::cullStats() const { return m_cullStats; }
+
+void SceneGraph::set_uniform_buffers(bool enable) {
+    m_uniformBuffers = enable;
+    m_queue.set_object_uniforms(enable);
+}
+
+void SceneGraph::set_time(float seconds) {
+    m_time = seconds;
+}
+
+void SceneGraph::uploadFrameUniforms() {
+    if(!m_frameUBO)
+        m_frameUBO.reset(new UBO<FrameBlock>());
+    FrameBlock& frame = m_frameUBO->data;
+    frame.view = m_view;
+    frame.projection = m_projection;
+    frame.viewProjection = m_projection * m_view;
+    frame.cameraPosition = glm::vec3(glm::inverse(m_view)[3]);
+    frame.time = m_time;
+    m_frameUBO->upload_std140_dirty();
+    m_frameUBO->bindBase(GL_UNIFORM_BUFFER, FrameBlockBinding);
+}
+
+void SceneGraph::set_bvh(bool enable, float rebuildFraction) {
+    if(enable && !m_useBVH)
+        m_bvhDirty = true;
+    m_useBVH = enable;
+    m_bvhRebuildFraction = rebuildFraction;
+}
+
+BVH const& SceneGraph::bvh() const { return m_bvh; }
+
+bool SceneGraph::bvhCurrent() const {
+    // The drawables of a changed structure may have been deleted
+    return m_useBVH && !m_bvhDirty && !m_structureDirty;
+}
+
+DrawableNode* SceneGraph::pick(glm::vec3 const& origin, glm::vec3 const& direction) const {
+    if(!bvhCurrent())
+        return nullptr;
+    int i = m_bvh.raycast(origin, direction);
+    return (i < 0 || static_cast<size_t>(i) >= m_drawables.size()) ? nullptr : m_drawables[static_cast<size_t>(i)];
+}
+
+void SceneGraph::query(AABB const& region, std::vector<DrawableNode*>& nodes) const {
+    if(!bvhCurrent())
+        return;
+    std::vector<int> items;
+    m_bvh.query(region, items);
+    for(int i: items) {
+        if(i >= 0 && static_cast<size_t>(i) < m_drawables.size())
+            nodes.push_back(m_drawables[static_cast<size_t>(i)]);
+    }
+}
+
+void SceneGraph::structureChanged() {
+    m_structureDirty = true;
+}
+
+void SceneGraph::flatten() {
+    m_storage.clear();
+    m_drawables.clear();
+    m_drawableNodes.clear();
+    m_rootIndices.clear();
+    m_localBounds.clear();
+    m_changedBounds.clear();
+
+    /* Iterative depth-first traversal, children are visited in id order like
+     * the recursive traversal. A node is popped twice: once to append it, and
+     * once after all its descendants were appended to close its subtree. */
+    struct Entry {
+        Node* node;
+        int parent;
+        int index;
+        int id;
+    };
+    std::stack<Entry, std::vector<Entry>> stack;
+    for(auto it = m_children.rbegin() ; it != m_children.rend() ; ++it) {
+        stack.push({it->second, SceneStorage::NoParent, -1, it->first});
+    }
+    while(!stack.empty()) {
+        Entry e = stack.top();
+        stack.pop();
+        if(e.index != -1) {
+            m_storage.close_subtree(e.index);
+            continue;
+        }
+        Node* n = e.node;
+        bool enabled = n->m_enabled &&
+                       (e.parent == SceneStorage::NoParent || (m_storage.flags(e.parent) & SceneStorage::Enabled));
+        DrawableNode* dn = dynamic_cast<DrawableNode*>(n);
+        std::uint8_t flags = (enabled ? SceneStorage::Enabled : 0) | (dn ? SceneStorage::Drawable : 0);
+        int drawable = dn ? static_cast<int>(m_drawables.size()) : -1;
+        int i = m_storage.append(e.parent, n->m_position, flags, drawable);
+        if(dn) {
+            m_drawables.push_back(dn);
+            m_drawableNodes.push_back(i);
+        }
+        n->m_graph = this;
+        n->m_index = i;
+        if(e.parent == SceneStorage::NoParent)
+            m_rootIndices[e.id] = i;
+        stack.push({n, e.parent, i, e.id});
+        for(auto it = n->m_children.rbegin() ; it != n->m_children.rend() ; ++it) {
+            stack.push({it->second, i, -1, -1});
+        }
+    }
+    m_localBounds.resize(m_drawables.size());
+    m_worldBounds.resize(m_drawables.size());
+    m_worldBoxes.resize(m_drawables.size());
+    m_visible.resize(m_drawables.size());
+    m_enabledBefore.resize(m_drawables.size() + 1);
+    for(size_t d = 0 ; d != m_drawables.size() ; ++d) {
+        m_localBounds.set(d, m_drawables[d]->bounds());
+        bool enabled = m_storage.flags(m_drawableNodes[d]) & SceneStorage::Enabled;
+        m_enabledBefore[d + 1] = m_enabledBefore[d] + (enabled ? 1 : 0);
+    }
+    m_bvhDirty = true;
+    m_structureDirty = false;
+}
+
+void SceneGraph::renderFlat(int begin, int end) {
+    m_storage.updateWorldTransforms(m_threadPool);
+    updateBounds();
+    if(m_useBVH)
+        updateBVH();
+    size_t first = static_cast<size_t>(std::lower_bound(m_drawableNodes.begin(), m_drawableNodes.end(), begin) -
+                                       m_drawableNodes.begin());
+    size_t last = static_cast<size_t>(std::lower_bound(m_drawableNodes.begin() + first, m_drawableNodes.end(), end) -
+                                      m_drawableNodes.begin());
+
+    m_queue.clear();
+    m_cullStats = {m_enabledBefore[last] - m_enabledBefore[first], 0, 0};
+    if(m_culling && m_hasProjection) {
+        Frustum frustum(m_projection * m_view);
+        if(m_useBVH)
+            cullBVH(frustum, first, last);
+        else
+            cull(frustum, first, last);
+    }
+    else {
+        for(size_t d = first ; d != last ; ++d) {
+            int i = m_drawableNodes[d];
+            if(!(m_storage.flags(i) & SceneStorage::Enabled))
+                continue;
+            glm::mat4 const& world = m_storage.world(i);
+            // The camera looks down -z
+            float depth = -(m_view * world[3]).z;
+            m_queue.push(m_drawables[d], &world, depth);
+        }
+    }
+    m_cullStats.drawn = m_queue.size();
+    m_cullStats.culled = m_cullStats.tested - m_cullStats.drawn;
+    m_queue.submit();
+}
+
+void SceneGraph::updateBounds() {
+    m_movedDrawables.clear();
+    for(int r: m_storage.updatedRoots()) {
+        /* Drawables are in depth-first order too, so a subtree maps to a
+         * contiguous range of drawables */
+        auto begin = std::lower_bound(m_drawableNodes.begin(), m_drawableNodes.end(), r);
+        auto end = std::lower_bound(begin, m_drawableNodes.end(), m_storage.subtree_end(r));
+        for(auto it = begin ; it != end ; ++it) {
+            m_movedDrawables.push_back(static_cast<int>(it - m_drawableNodes.begin()));
+        }
+    }
+    if(!m_changedBounds.empty()) {
+        m_movedDrawables.insert(m_movedDrawables.end(), m_changedBounds.begin(), m_changedBounds.end());
+        std::sort(m_movedDrawables.begin(), m_movedDrawables.end());
+        m_movedDrawables.erase(std::unique(m_movedDrawables.begin(), m_movedDrawables.end()), m_movedDrawables.end());
+        m_changedBounds.clear();
+    }
+    for(int d: m_movedDrawables) {
+        size_t i = static_cast<size_t>(d);
+        BoundingSphere s = m_localBounds.get(i).transformed(m_storage.world(m_drawableNodes[i]));
+        m_worldBounds.set(i, s);
+        if(s.unbounded())
+            m_worldBoxes[i] = AABB();
+        else
+            m_worldBoxes[i] = AABB(s.center() - glm::vec3(s.radius()), s.center() + glm::vec3(s.radius()));
+    }
+}
+
+void SceneGraph::updateBVH() {
+    if(m_bvhBuild.valid() && m_bvhBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        m_bvhBuild.get();
+        m_bvh = std::move(*m_pendingBVH);
+        m_pendingBVH.reset();
+        // Catch up with the nodes that moved during the build
+        m_bvh.refit(m_worldBoxes);
+    }
+    if(m_bvhDirty) {
+        m_pendingBVH.reset();
+        m_bvhBuild = std::future<void>();
+        m_unbounded.clear();
+        for(size_t d = 0 ; d != m_worldBoxes.size() ; ++d) {
+            if(m_worldBoxes[d].empty())
+                m_unbounded.push_back(static_cast<int>(d));
+        }
+        m_bvh.build(m_worldBoxes);
+        m_movedSinceBuild = 0;
+        m_bvhDirty = false;
+        return;
+    }
+    if(m_movedDrawables.empty())
+        return;
+    if(m_movedDrawables.size() > m_worldBoxes.size() / 8)
+        m_bvh.refit(m_worldBoxes);
+    else
+        m_bvh.refit(m_worldBoxes, m_movedDrawables);
+
+    /* Refitting keeps the tree valid but its quality degrades as nodes move
+     * away from their original neighbours */
+    m_movedSinceBuild += m_movedDrawables.size();
+    if(m_bvhBuild.valid() || m_movedSinceBuild <= m_bvhRebuildFraction * m_worldBoxes.size())
+        return;
+    m_movedSinceBuild = 0;
+    if(!m_threadPool || m_threadPool->size() == 0) {
+        m_bvh.build(m_worldBoxes);
+        return;
+    }
+    auto bvh = std::make_shared<BVH>();
+    m_pendingBVH = bvh;
+    m_bvhBuild = m_threadPool->submit([bvh, boxes = m_worldBoxes] () { bvh->build(boxes); });
+}
+
+void SceneGraph::cull(Frustum const& frustum, size_t first, size_t last) {
+    /* A sphere of radius r at distance z covers about r * P[1][1] / z of the
+     * viewport height */
+    float minSize = m_minScreenSize / m_projection[1][1];
+    cullSpheres(frustum, m_worldBounds.x.data() + first, m_worldBounds.y.data() + first, m_worldBounds.z.data() + first,
+                m_worldBounds.r.data() + first, last - first, minSize, m_visible.data() + first);
+    for(size_t d = first ; d != last ; ++d) {
+        int i = m_drawableNodes[d];
+        if(!m_visible[d] || !(m_storage.flags(i) & SceneStorage::Enabled))
+            continue;
+        glm::mat4 const& world = m_storage.world(i);
+        float depth = -(m_view * world[3]).z;
+        m_queue.push(m_drawables[d], &world, depth);
+    }
+}
+
+void SceneGraph::cullBVH(Frustum const& frustum, size_t first, size_t last) {
+    m_bvhHits.assign(m_unbounded.begin(), m_unbounded.end());
+    m_bvh.query(frustum, m_bvhHits);
+    // Keep the depth-first order for the unsorted queue
+    std::sort(m_bvhHits.begin(), m_bvhHits.end());
+    float minSize = m_minScreenSize / m_projection[1][1];
+    for(int h: m_bvhHits) {
+        size_t d = static_cast<size_t>(h);
+        if(d < first || d >= last)
+            continue;
+        int i = m_drawableNodes[d];
+        if(!(m_storage.flags(i) & SceneStorage::Enabled))
+            continue;
+        /* The BVH tests the boxes around the spheres, test the sphere itself
+         * like the linear path does */
+        if(!cullSpheresScalar(frustum, &m_worldBounds.x[d], &m_worldBounds.y[d], &m_worldBounds.z[d],
+                              &m_worldBounds.r[d], 1, minSize, &m_visible[d]))
+            continue;
+        glm::mat4 const& world = m_storage.world(i);
+        float depth = -(m_view * world[3]).z;
+        m_queue.push(m_drawables[d], &world, depth);
+    }
+}
+
 void SceneGraph::render(Node* n) {
+    if(!n->m_enabled)
+        return;
     m_matrixStack.push(n->m_position);
+    ++m_updatedNodes;
     DrawableNode* dn = dynamic_cast<DrawableNode*>(n);
     /* If the node inherits from DrawableNode, draw it.
      * Otherwise, just draw it's children. */
@@ -96,8 +470,35 @@ DrawableNode::DrawableNode(glm::mat4 const& position, Program* prog, VAO* vao, u
     m_program(prog),
     m_nPrimitives(nPrimitives),
     m_primitiveMode(primitiveMode),
-    m_vao(vao)
-{ }
+    m_vao(vao),
+    m_transparent(false),
+    m_bounds(),
+    m_geometryTransform(1.f),
+    m_worldHandle()
+{
+    if(m_program)
+        m_worldHandle = m_program->uniformHandle<glm::mat4>("m_world");
+}
+
+void DrawableNode::draw(glm::mat4 const& m) {
+    if(!m_program)
+        return;
+    m_program->use();
+    m_vao->bind();
+    if(m_tex)
+        m_tex->bind();
+    else
+        Engine::Texture::unbind();
+    drawCall(m);
+}
+
+bool DrawableNode::queueable() const {
+    return false;
+}
+
+MeshArena::Allocation const* DrawableNode::mergeableGeometry() const {
+    return nullptr;
+}
 
 void DrawableNode::set_texture(Texture const* tex) {
     m_tex = tex;
@@ -105,17 +506,53 @@ void DrawableNode::set_texture(Texture const* tex) {
 
 void DrawableNode::set_program(Program* prog) {
     m_program = prog;
+    m_worldHandle = m_program ? m_program->uniformHandle<glm::mat4>("m_world") : UniformHandle<glm::mat4>();
 }
 
 void DrawableNode::set_vao(VAO* vao) {
     m_vao = vao;
 }
 
+void DrawableNode::set_transparent(bool transparent) {
+    m_transparent = transparent;
+}
+
+void DrawableNode::set_bounds(BoundingSphere const& bounds) {
+    m_bounds = bounds;
+    if(m_graph) {
+        int d = m_graph->m_storage.drawable(m_index);
+        // Unbounded nodes aren't stored in the BVH
+        if(m_graph->m_localBounds.get(static_cast<size_t>(d)).unbounded() != bounds.unbounded())
+            m_graph->m_bvhDirty = true;
+        m_graph->m_localBounds.set(static_cast<size_t>(d), bounds);
+        m_graph->m_changedBounds.push_back(d);
+    }
+}
+
+BoundingSphere const& DrawableNode::bounds() const { return m_bounds; }
+
+void DrawableNode::set_geometry_transform(glm::mat4 const& m) {
+    m_geometryTransform = m;
+}
+
+glm::mat4 const& DrawableNode::geometryTransform() const { return m_geometryTransform; }
+
+Texture const* DrawableNode::texture() const { return m_tex; }
+Program* DrawableNode::program() const { return m_program; }
+VAO* DrawableNode::vao() const { return m_vao; }
+bool DrawableNode::transparent() const { return m_transparent; }
+GLenum DrawableNode::primitiveMode() const { return m_primitiveMode; }
+
 void DrawableNode::enable_attribute(std::string const& attr, bool enable) {
-    GLint loc = m_program->getAttributeLocation(attr);
+    // The programs bind the engine attributes to fixed locations
+    int loc = attributeLocation(attr);
     if(loc == -1)
         throw std::runtime_error("Attribute not found");
-    m_vao->enableVertexAttribArray(static_cast<unsigned int>(loc), enable);
+    // The mat4 instance attribute spans 4 locations
+    unsigned int n = (loc == static_cast<int>(InstanceWorldAttribute)) ? 4 : 1;
+    for(unsigned int i = 0 ; i != n ; ++i) {
+        m_vao->enableVertexAttribArray(static_cast<unsigned int>(loc) + i, enable);
+    }
 }
 
 Object::Object(glm::mat4 const& position, Program* p, VAO* vao, unsigned int n_primitives,
@@ -123,26 +560,17 @@ Object::Object(glm::mat4 const& position, Program* p, VAO* vao, unsigned int n_p
     DrawableNode(position, p, vao, n_primitives, tex, primitiveMode)
 { }
 
-Object::~Object() {
-    delete m_vao;
-}
+Object::~Object() { }
 
-void Object::draw(glm::mat4 const& m) {
-    m_program->use();
-    auto u = dynamic_cast<Uniform<glm::mat4>*>(m_program->getUniform("m_world"));
-    if(u)
-        u->set(m);
+void Object::drawCall(glm::mat4 const& m) {
+    if(m_worldHandle)
+        m_program->uniform(m_worldHandle).set(m * m_geometryTransform);
     m_program->uploadUniforms();
-    m_vao->bind();
-    if(m_tex)
-        m_tex->bind();
-    else
-        Engine::Texture::unbind();
     glDrawArrays(m_primitiveMode, 0, static_cast<int>(m_nPrimitives));
-    if(m_tex)
-        Texture::unbind();
-    VAO::unbind();
-    Program::noProgram();
+}
+
+bool Object::queueable() const {
+    return true;
 }
 
 IndexedObject::IndexedObject(glm::mat4 const& position, Program* p, const VBO* ebo, VAO* vao, unsigned int n_indices,
@@ -157,25 +585,252 @@ IndexedObject::~IndexedObject() {
 
 }
 
-void IndexedObject::draw(glm::mat4 const& m) {
-    m_program->use();
+void IndexedObject::drawCall(glm::mat4 const& m) {
     // Remove scaling from m or it will apply to children too
-    auto u = dynamic_cast<Uniform<glm::mat4>*>(m_program->getUniform("m_world"));
-    if(u)
-        u->set(m);
+    if(m_worldHandle)
+        m_program->uniform(m_worldHandle).set(m * m_geometryTransform);
     m_program->uploadUniforms();
-    m_vao->bind();
     m_ebo->bind(GL_ELEMENT_ARRAY_BUFFER);
-    if(m_tex)
-        m_tex->bind();
-    else
-        Engine::Texture::unbind();
     glDrawElements(m_primitiveMode, static_cast<int>(m_nIndices), m_indexType, NULL);
-    if(m_tex)
-        Texture::unbind();
-    VBO::unbind(GL_ELEMENT_ARRAY_BUFFER);
-    VAO::unbind();
-    Program::noProgram();
+}
+
+bool IndexedObject::queueable() const {
+    return true;
+}
+
+ArenaObject::ArenaObject(glm::mat4 const& position, Program* p, VAO* vao,
+                         MeshArena::Allocation const* allocation, Texture const* tex, GLenum primitiveMode) :
+    DrawableNode(position, p, vao,
+                 (allocation->indexCount() ? allocation->indexCount() : allocation->vertexCount()) / 3,
+                 tex, primitiveMode),
+    m_allocation(allocation)
+{ }
+
+ArenaObject::~ArenaObject() { }
+
+void ArenaObject::drawCall(glm::mat4 const& m) {
+    if(m_worldHandle)
+        m_program->uniform(m_worldHandle).set(m * m_geometryTransform);
+    m_program->uploadUniforms();
+    // The ranges are read at each draw since compacting the arena moves them
+    if(m_allocation->indexCount()) {
+        glDrawElementsBaseVertex(m_primitiveMode, static_cast<int>(m_allocation->indexCount()), GL_UNSIGNED_INT,
+                                 reinterpret_cast<void*>(m_allocation->firstIndex() * sizeof(unsigned int)),
+                                 static_cast<int>(m_allocation->baseVertex()));
+    }
+    else {
+        glDrawArrays(m_primitiveMode, static_cast<int>(m_allocation->baseVertex()),
+                     static_cast<int>(m_allocation->vertexCount()));
+    }
+}
+
+bool ArenaObject::queueable() const {
+    return true;
+}
+
+MeshArena::Allocation const* ArenaObject::mergeableGeometry() const {
+    // The world transform is a per-node uniform
+    if(m_worldHandle || !m_allocation->indexCount())
+        return nullptr;
+    return m_allocation;
+}
+
+StreamObject::StreamObject(glm::mat4 const& position, Program* p, VAO* vao, Texture const* tex,
+                           GLenum primitiveMode) :
+    DrawableNode(position, p, vao, 0, tex, primitiveMode),
+    m_geometry{0, 0, 0, 0, GL_UNSIGNED_SHORT}
+{ }
+
+StreamObject::~StreamObject() { }
+
+void StreamObject::drawCall(glm::mat4 const& m) {
+    if(!m_geometry.vertexCount)
+        return;
+    if(m_worldHandle)
+        m_program->uniform(m_worldHandle).set(m * m_geometryTransform);
+    m_program->uploadUniforms();
+    if(m_geometry.indexCount) {
+        glDrawElementsBaseVertex(m_primitiveMode, m_geometry.indexCount, m_geometry.indexType,
+                                 reinterpret_cast<void*>(m_geometry.indexOffset), m_geometry.baseVertex);
+    }
+    else {
+        glDrawArrays(m_primitiveMode, m_geometry.baseVertex, m_geometry.vertexCount);
+    }
+}
+
+bool StreamObject::queueable() const {
+    return true;
+}
+
+void StreamObject::set_geometry(StreamBuffer::Geometry const& geometry) {
+    m_geometry = geometry;
+    m_nPrimitives = static_cast<unsigned int>(geometry.indexCount ? geometry.indexCount : geometry.vertexCount) / 3;
+}
+
+InstancedNode::InstancedNode(glm::mat4 const& position, Program* p, VAO* vao, BoundingSphere const& meshBounds,
+                             const VBO* ebo, unsigned int nElements, Texture const* tex, GLenum indexType,
+                             GLenum primitiveMode) :
+    DrawableNode(position, p, vao, nElements/3, tex, primitiveMode),
+    m_ebo(ebo),
+    m_nElements(nElements),
+    m_indexType(indexType),
+    m_instanceVBO(),
+    m_capacity(0),
+    m_transforms(),
+    m_ids(),
+    m_slots(),
+    m_freeIds(),
+    m_dirtyBegin(std::numeric_limits<size_t>::max()),
+    m_dirtyEnd(0),
+    m_meshBounds(meshBounds),
+    m_instanceBox(),
+    m_boundsDirty(false)
+{
+    // A mat4 attribute spans 4 consecutive locations, one per column
+    for(GLuint c = 0 ; c != 4 ; ++c) {
+        GLuint index = InstanceWorldAttribute + c;
+        m_vao->enableVertexAttribArray(index);
+        m_vao->vertexAttribPointer(m_instanceVBO, index, 4, sizeof(glm::mat4),
+                                   reinterpret_cast<void*>(c * sizeof(glm::vec4)));
+        m_vao->vertexAttribDivisor(index, 1);
+    }
+    // No instance yet
+    if(!meshBounds.unbounded())
+        set_bounds(BoundingSphere(glm::vec3(0.f), 0.f));
+}
+
+InstancedNode::~InstancedNode() {
+    delete m_vao;
+}
+
+void InstancedNode::drawCall(glm::mat4 const& m) {
+    upload();
+    if(m_transforms.empty())
+        return;
+    if(m_worldHandle)
+        m_program->uniform(m_worldHandle).set(m);
+    m_program->uploadUniforms();
+    GLsizei count = static_cast<GLsizei>(m_transforms.size());
+    if(m_ebo) {
+        m_ebo->bind(GL_ELEMENT_ARRAY_BUFFER);
+        glDrawElementsInstanced(m_primitiveMode, static_cast<int>(m_nElements), m_indexType, NULL, count);
+    }
+    else {
+        glDrawArraysInstanced(m_primitiveMode, 0, static_cast<int>(m_nElements), count);
+    }
+}
+
+bool InstancedNode::queueable() const {
+    return true;
+}
+
+int InstancedNode::addInstance(glm::mat4 const& m) {
+    int id;
+    if(!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    else {
+        id = static_cast<int>(m_slots.size());
+        m_slots.push_back(-1);
+    }
+    m_slots[id] = static_cast<int>(m_transforms.size());
+    m_ids.push_back(id);
+    m_transforms.push_back(m);
+    markDirty(m_transforms.size() - 1);
+    growBounds(m);
+    return id;
+}
+
+void InstancedNode::set_instance(int id, glm::mat4 const& m) {
+    size_t s = static_cast<size_t>(slot(id));
+    m_transforms[s] = m;
+    markDirty(s);
+    /* Growing keeps the bounds conservative until upload shrinks them */
+    growBounds(m);
+    m_boundsDirty = true;
+}
+
+void InstancedNode::removeInstance(int id) {
+    /* Move the last instance into the free slot to keep the VBO packed */
+    size_t s = static_cast<size_t>(slot(id)), last = m_transforms.size() - 1;
+    if(s != last) {
+        m_transforms[s] = m_transforms[last];
+        m_ids[s] = m_ids[last];
+        m_slots[m_ids[s]] = static_cast<int>(s);
+        markDirty(s);
+    }
+    m_transforms.pop_back();
+    m_ids.pop_back();
+    m_slots[id] = -1;
+    m_freeIds.push_back(id);
+    m_boundsDirty = true;
+}
+
+glm::mat4 const& InstancedNode::instance(int id) const {
+    return m_transforms[static_cast<size_t>(slot(id))];
+}
+
+size_t InstancedNode::instanceCount() const {
+    return m_transforms.size();
+}
+
+int InstancedNode::slot(int id) const {
+    if(id < 0 || static_cast<size_t>(id) >= m_slots.size() || m_slots[id] == -1)
+        throw std::runtime_error("Invalid instance id");
+    return m_slots[id];
+}
+
+void InstancedNode::markDirty(size_t slot) {
+    m_dirtyBegin = std::min(m_dirtyBegin, slot);
+    m_dirtyEnd = std::max(m_dirtyEnd, slot + 1);
+}
+
+void InstancedNode::growBounds(glm::mat4 const& m) {
+    if(m_meshBounds.unbounded())
+        return;
+    BoundingSphere s = m_meshBounds.transformed(m);
+    glm::vec3 r(s.radius());
+    AABB box = m_instanceBox;
+    box.expand(AABB(s.center() - r, s.center() + r));
+    if(box.min() == m_instanceBox.min() && box.max() == m_instanceBox.max())
+        return;
+    m_instanceBox = box;
+    set_bounds(BoundingSphere(box.center(), glm::length(box.extents())));
+}
+
+void InstancedNode::rebuildBounds() {
+    m_boundsDirty = false;
+    if(m_meshBounds.unbounded())
+        return;
+    m_instanceBox = AABB();
+    for(glm::mat4 const& m: m_transforms) {
+        BoundingSphere s = m_meshBounds.transformed(m);
+        glm::vec3 r(s.radius());
+        m_instanceBox.expand(AABB(s.center() - r, s.center() + r));
+    }
+    if(m_instanceBox.empty())
+        set_bounds(BoundingSphere(glm::vec3(0.f), 0.f));
+    else
+        set_bounds(BoundingSphere(m_instanceBox.center(), glm::length(m_instanceBox.extents())));
+}
+
+void InstancedNode::upload() {
+    if(m_boundsDirty)
+        rebuildBounds();
+    if(m_transforms.size() > m_capacity) {
+        m_capacity = std::max(static_cast<size_t>(64), 2 * m_transforms.size());
+        m_instanceVBO.allocate(m_capacity * sizeof(glm::mat4), GL_DYNAMIC_DRAW);
+        m_dirtyBegin = 0;
+        m_dirtyEnd = m_transforms.size();
+    }
+    m_dirtyEnd = std::min(m_dirtyEnd, m_transforms.size());
+    if(m_dirtyBegin < m_dirtyEnd) {
+        m_instanceVBO.update_data(m_transforms[m_dirtyBegin], (m_dirtyEnd - m_dirtyBegin) * sizeof(glm::mat4),
+                                  static_cast<ptrdiff_t>(m_dirtyBegin * sizeof(glm::mat4)));
+    }
+    m_dirtyBegin = std::numeric_limits<size_t>::max();
+    m_dirtyEnd = 0;
 }
 
 } // namespace Engine
@@ -1,9 +1,25 @@
 #include "sceneimporter.h"
+#include "threadpool.h"
 
+#include <algorithm>
+#include <cstring>
+#include <exception>
 #include <limits>
 
 namespace Engine {
 
+namespace {
+    /* Indices of a triangulated mesh */
+    std::vector<unsigned int> readIndices(aiMesh const& mesh) {
+        std::vector<unsigned int> indices(mesh.mNumFaces * 3);
+        unsigned int* out = indices.data();
+        for(unsigned int i = 0 ; i != mesh.mNumFaces ; ++i, out += 3) {
+            std::memcpy(out, mesh.mFaces[i].mIndices, 3 * sizeof(unsigned int));
+        }
+        return indices;
+    }
+}
+
 SceneImporter::SceneImporter() :
     m_assimp()
 { }
@@ -24,86 +40,122 @@ std::vector<const aiMesh*> SceneImporter::meshes() const {
     return vec;
 }
 
-std::unique_ptr<Mesh> SceneImporter::instantiateMesh(aiMesh const& mesh) const {
+std::unique_ptr<Mesh> SceneImporter::instantiateMesh(aiMesh const& mesh, MeshBuilder::VertexLayout layout,
+                                                     MeshBuilder::Quantise quantise,
+                                                     MeshBuilder::Optimize optimize) const {
     MeshBuilder b;
-    std::vector<glm::vec3> vertices, normals, uvs_cubemap;
-    std::vector<glm::vec2> uvs;
-    std::vector<glm::vec4> colors;
-    std::vector<unsigned char> index_byte;
-    std::vector<unsigned short> index_short;
-    std::vector<unsigned int> index_int;
-    bool hasNormals = mesh.HasNormals(), hasUVs = mesh.HasTextureCoords(0),
-         hasColors = mesh.HasVertexColors(0), hasIndices = (mesh.mNumFaces != mesh.mNumVertices*3);
-    auto nIndices = mesh.mNumFaces * 3;
-    size_t index_size = hasIndices ? ((nIndices <= std::numeric_limits<unsigned char>::max()) ? sizeof(unsigned char) :
-                                      (nIndices <= std::numeric_limits<unsigned short>::max()) ? sizeof(unsigned short) :
-                                      sizeof(unsigned int)) : 0;
-    for(unsigned int i = 0 ; i != mesh.mNumVertices ; ++i) {
-        aiVector3D* v = mesh.mVertices + i;
-        vertices.push_back(glm::vec3(v->x, v->y, v->z));
-        if(hasNormals) {
-            v = mesh.mNormals + i;
-            normals.push_back(glm::vec3(v->x, v->y, v->z));
-        }
-        if(hasColors) {
-            aiColor4D* c = mesh.mColors[0] + i;
-            colors.push_back(glm::vec4(c->r, c->g, c->b, c->a));
+    b.layout(layout)
+     .quantise(quantise)
+     .optimize(optimize);
+    convertMesh(mesh, b);
+    return b.build_mesh();
+}
+
+std::vector<std::unique_ptr<Mesh>> SceneImporter::instantiateMeshes(ThreadPool* pool, MeshBuilder::VertexLayout layout,
+                                                                    MeshBuilder::Quantise quantise,
+                                                                    MeshBuilder::Optimize optimize) const {
+    std::vector<std::unique_ptr<MeshBuilder>> builders = prepareMeshes(pool, layout, quantise, optimize);
+    std::vector<std::unique_ptr<Mesh>> result;
+    result.reserve(builders.size());
+    for(auto& b: builders) {
+        result.push_back(b->build_mesh());
+        // Free the converted attributes as soon as they are uploaded
+        b.reset();
+    }
+    return result;
+}
+
+std::vector<std::unique_ptr<MeshBuilder>> SceneImporter::prepareMeshes(ThreadPool* pool,
+                                                                       MeshBuilder::VertexLayout layout,
+                                                                       MeshBuilder::Quantise quantise,
+                                                                       MeshBuilder::Optimize optimize) const {
+    std::vector<const aiMesh*> scene = meshes();
+    std::vector<std::unique_ptr<MeshBuilder>> builders(scene.size());
+    // The exceptions can't leave the worker threads, they are rethrown on
+    // the calling thread
+    std::vector<std::exception_ptr> errors(scene.size());
+    // Largest meshes first, so that a large mesh doesn't start last and keep
+    // a single thread busy
+    std::vector<size_t> order(scene.size());
+    for(size_t i = 0 ; i != order.size() ; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&scene] (size_t a, size_t b) {
+        return scene[a]->mNumFaces > scene[b]->mNumFaces;
+    });
+
+    auto convert = [&] (size_t k) {
+        size_t i = order[k];
+        try {
+            builders[i].reset(new MeshBuilder());
+            builders[i]->layout(layout)
+                        .quantise(quantise)
+                        .optimize(optimize);
+            convertMesh(*scene[i], *builders[i]);
+            builders[i]->prepare();
         }
-        if(hasUVs) {
-            // TODO : support 3D UVs
-            v = mesh.mTextureCoords[0] + i;
-            uvs.push_back(glm::vec2(v->x, v->y));
+        catch(...) {
+            errors[i] = std::current_exception();
         }
+    };
+    if(pool && pool->size() != 0) {
+        pool->parallel_for(scene.size(), convert);
     }
-    if(hasIndices) {
-        auto f = ((index_size) == 1) ? &readIndex<1> :
-                 ((index_size) == 2) ? &readIndex<2> : &readIndex<4>;
-        for(unsigned int i = 0 ; i != mesh.mNumFaces ; ++i) {
-            f(index_byte, index_short, index_int, mesh.mFaces + i);
+    else {
+        for(size_t k = 0 ; k != scene.size() ; ++k) {
+            convert(k);
         }
     }
-    b.vertices(std::move(vertices));
-    if(hasNormals)
-        b.normals(std::move(normals));
-    if(hasColors)
-        b.colors(std::move(colors));
-    if(hasIndices) {
-        ((index_size) == 1) ? b.faces(std::move(index_byte)) :
-        ((index_size) == 2) ? b.faces(std::move(index_short)) :
-                              b.faces(std::move(index_int));
-    }
-    if(hasUVs)
-        b.uvs(std::move(uvs));
 
-    return b.build_mesh();
+    for(std::exception_ptr const& e: errors) {
+        if(e)
+            std::rethrow_exception(e);
+    }
+    return builders;
 }
 
 void SceneImporter::dropComponents(int flags) {
     m_assimp.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, flags);
 }
 
-template<>
-void SceneImporter::readIndex<1>(std::vector<unsigned char>& v1, std::vector<unsigned short>&,
-                                std::vector<unsigned int>&, aiFace* f) {
-    v1.push_back(f->mIndices[0]);
-    v1.push_back(f->mIndices[1]);
-    v1.push_back(f->mIndices[2]);
-}
-
-template<>
-void SceneImporter::readIndex<2>(std::vector<unsigned char>&, std::vector<unsigned short>& v2,
-                                 std::vector<unsigned int>&, aiFace* f) {
-    v2.push_back(f->mIndices[0]);
-    v2.push_back(f->mIndices[1]);
-    v2.push_back(f->mIndices[2]);
-}
+void SceneImporter::convertMesh(aiMesh const& mesh, MeshBuilder& builder) {
+    static_assert(sizeof(aiVector3D) == sizeof(glm::vec3) && sizeof(aiColor4D) == sizeof(glm::vec4),
+                  "The assimp vectors are copied to the glm ones as is.");
+    unsigned int nVertices = mesh.mNumVertices;
+    bool hasIndices = (mesh.mNumFaces != mesh.mNumVertices*3);
 
-template<>
-void SceneImporter::readIndex<4>(std::vector<unsigned char>&, std::vector<unsigned short>&,
-                                 std::vector<unsigned int>& v3, aiFace* f) {
-    v3.push_back(f->mIndices[0]);
-    v3.push_back(f->mIndices[1]);
-    v3.push_back(f->mIndices[2]);
+    std::vector<glm::vec3> vertices(nVertices);
+    std::memcpy(static_cast<void*>(vertices.data()), mesh.mVertices, nVertices * sizeof(glm::vec3));
+    builder.vertices(std::move(vertices));
+    if(mesh.HasNormals()) {
+        std::vector<glm::vec3> normals(nVertices);
+        std::memcpy(static_cast<void*>(normals.data()), mesh.mNormals, nVertices * sizeof(glm::vec3));
+        builder.normals(std::move(normals));
+    }
+    if(mesh.HasVertexColors(0)) {
+        std::vector<glm::vec4> colors(nVertices);
+        std::memcpy(static_cast<void*>(colors.data()), mesh.mColors[0], nVertices * sizeof(glm::vec4));
+        builder.colors(std::move(colors));
+    }
+    if(mesh.HasTextureCoords(0)) {
+        // TODO : support 3D UVs
+        std::vector<glm::vec2> uvs(nVertices);
+        aiVector3D const* uv = mesh.mTextureCoords[0];
+        for(unsigned int i = 0 ; i != nVertices ; ++i) {
+            uvs[i] = glm::vec2(uv[i].x, uv[i].y);
+        }
+        builder.uvs(std::move(uvs));
+    }
+    if(hasIndices) {
+        // The smallest type holding every vertex index, the indices are only
+        // narrowed when uploaded
+        AttributeArray::Type type = AttributeArray::Type::Uint;
+        if(nVertices <= std::numeric_limits<unsigned char>::max() + 1u)
+            type = AttributeArray::Type::Uchar;
+        else if(nVertices <= std::numeric_limits<unsigned short>::max() + 1u)
+            type = AttributeArray::Type::Ushort;
+        builder.faces(readIndices(mesh), type);
+    }
 }
 
 } // namespace Engine
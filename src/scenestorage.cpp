@@ -0,0 +1,174 @@
+#include "scenestorage.h"
+#include "matrixstack.h"
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace Engine {
+
+constexpr int SceneStorage::NoParent;
+
+SceneStorage::SceneStorage() :
+    m_parents(),
+    m_subtreeEnds(),
+    m_locals(),
+    m_worlds(),
+    m_flags(),
+    m_drawables(),
+    m_dirty(),
+    m_roots(),
+    m_tasks(),
+    m_allDirty(false),
+    m_updatedNodes(0)
+{ }
+
+SceneStorage::~SceneStorage() { }
+
+void SceneStorage::clear() {
+    m_parents.clear();
+    m_subtreeEnds.clear();
+    m_locals.clear();
+    m_worlds.clear();
+    m_flags.clear();
+    m_drawables.clear();
+    m_dirty.clear();
+    m_allDirty = false;
+}
+
+void SceneStorage::reserve(size_t n) {
+    m_parents.reserve(n);
+    m_subtreeEnds.reserve(n);
+    m_locals.reserve(n);
+    m_worlds.reserve(n);
+    m_flags.reserve(n);
+    m_drawables.reserve(n);
+}
+
+size_t SceneStorage::size() const { return m_parents.size(); }
+
+int SceneStorage::append(int parent, glm::mat4 const& local, std::uint8_t flags, int drawable) {
+    int i = static_cast<int>(m_parents.size());
+    m_parents.push_back(parent);
+    m_subtreeEnds.push_back(i + 1);
+    m_locals.push_back(local);
+    m_worlds.push_back(local);
+    m_flags.push_back(flags);
+    m_drawables.push_back(drawable);
+    m_allDirty = true;
+    return i;
+}
+
+void SceneStorage::close_subtree(int i) {
+    m_subtreeEnds[i] = static_cast<int>(m_parents.size());
+}
+
+int SceneStorage::parent(int i) const { return m_parents[i]; }
+int SceneStorage::subtree_end(int i) const { return m_subtreeEnds[i]; }
+std::uint8_t SceneStorage::flags(int i) const { return m_flags[i]; }
+int SceneStorage::drawable(int i) const { return m_drawables[i]; }
+glm::mat4 const& SceneStorage::local(int i) const { return m_locals[i]; }
+glm::mat4 const& SceneStorage::world(int i) const { return m_worlds[i]; }
+
+void SceneStorage::set_local(int i, glm::mat4 const& m) {
+    m_locals[i] = m;
+    if(!(m_flags[i] & Dirty)) {
+        m_flags[i] |= Dirty;
+        m_dirty.push_back(i);
+    }
+}
+
+size_t SceneStorage::updateWorldTransforms(ThreadPool* pool) {
+    m_updatedNodes = 0;
+    m_roots.clear();
+    /* When a large part of the scene moved, sorting the dirty list costs more
+     * than updating everything. */
+    if(m_allDirty || m_dirty.size() > m_parents.size() / 8) {
+        int n = static_cast<int>(m_parents.size());
+        for(int i = 0 ; i < n ; i = m_subtreeEnds[i]) {
+            m_roots.push_back(i);
+        }
+    }
+    else if(!m_dirty.empty()) {
+        /* Depth-first order means that once sorted, a dirty node is either
+         * inside the subtree of the previous dirty root, or starts a new
+         * independent subtree. */
+        std::sort(m_dirty.begin(), m_dirty.end());
+        int end = 0;
+        for(int i: m_dirty) {
+            if(i < end)
+                continue;
+            end = m_subtreeEnds[i];
+            m_roots.push_back(i);
+        }
+    }
+    if(pool && pool->size() != 0) {
+        updateParallel(*pool);
+    }
+    else {
+        for(int i: m_roots) {
+            updateRange(i, m_subtreeEnds[i]);
+            m_updatedNodes += static_cast<size_t>(m_subtreeEnds[i] - i);
+        }
+    }
+    for(int i: m_dirty) {
+        m_flags[i] &= ~Dirty;
+    }
+    m_dirty.clear();
+    m_allDirty = false;
+    return m_updatedNodes;
+}
+
+size_t SceneStorage::updatedNodes() const { return m_updatedNodes; }
+
+std::vector<int> const& SceneStorage::updatedRoots() const { return m_roots; }
+
+void SceneStorage::updateRange(int begin, int end) {
+    const glm::mat4 identity(1.f);
+    const int* parents = m_parents.data();
+    const glm::mat4* locals = m_locals.data();
+    glm::mat4* worlds = m_worlds.data();
+    for(int i = begin ; i != end ; ++i) {
+        int p = parents[i];
+        worlds[i] = MatrixStack::compose((p == NoParent) ? identity : worlds[p], locals[i]);
+    }
+}
+
+void SceneStorage::updateParallel(ThreadPool& pool) {
+    size_t total = 0;
+    for(int i: m_roots) {
+        total += static_cast<size_t>(m_subtreeEnds[i] - i);
+    }
+    /* Aim for a few tasks per thread so that uneven subtrees balance out, but
+     * don't split below the point where scheduling costs more than the work. */
+    const size_t minGrain = 4096;
+    size_t grain = std::max(minGrain, total / (4 * (pool.size() + 1)));
+
+    /* Subtrees are independent once the world transform of their root's
+     * parent is known. Large subtrees are split by updating their root here,
+     * then handling each child subtree separately. */
+    m_tasks.clear();
+    std::vector<int> stack(m_roots.rbegin(), m_roots.rend());
+    while(!stack.empty()) {
+        int i = stack.back();
+        stack.pop_back();
+        int end = m_subtreeEnds[i];
+        if(static_cast<size_t>(end - i) <= grain) {
+            m_tasks.push_back(i);
+            continue;
+        }
+        updateRange(i, i + 1);
+        size_t first = stack.size();
+        for(int c = i + 1 ; c < end ; c = m_subtreeEnds[c]) {
+            stack.push_back(c);
+        }
+        std::reverse(stack.begin() + first, stack.end());
+    }
+
+    pool.parallel_for(m_tasks.size(), [this] (size_t t) {
+        int i = m_tasks[t];
+        updateRange(i, m_subtreeEnds[i]);
+    });
+    m_updatedNodes = total;
+}
+
+} // namespace Engine
@@ -10,18 +10,23 @@ using namespace gl;
 namespace Engine {
 
 Shader::Shader(std::string const& file, gl::GLenum t) :
+    Shader(t, readSource(file))
+{ }
+
+Shader::Shader(gl::GLenum t, std::string const& source) :
     m_id()
 {
-    // Read source and compile
     m_id = glCreateShader(t);
+    const char* code_ptr = source.c_str();
+    glShaderSource(m_id, 1, &code_ptr, NULL);
+    glCompileShader(m_id);
+}
+
+std::string Shader::readSource(std::string const& file) {
     std::ifstream in_file(file);
     std::stringstream ss;
     ss << in_file.rdbuf();
-    std::string shader_code = ss.str();
-    in_file >> shader_code;
-    const char* code_ptr = shader_code.c_str();
-    glShaderSource(m_id, 1, &code_ptr, NULL);
-    glCompileShader(m_id);
+    return ss.str();
 }
 
 Shader::~Shader() {
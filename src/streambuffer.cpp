@@ -0,0 +1,115 @@
+#include "streambuffer.h"
+
+#include <cstring>
+#include <glbinding/gl/functions.h>
+
+using namespace gl;
+
+namespace Engine {
+
+StreamBuffer::StreamBuffer(size_t size, unsigned int frames, bool persistent) :
+    m_buffer(),
+    m_mapped(nullptr),
+    m_staging(),
+    m_ring("StreamBuffer", size, frames, [this] (size_t offset, size_t bytes) { upload(offset, bytes); }),
+    m_vaos()
+{
+    if(persistent && persistentSupported()) {
+        m_buffer.storage(size, BufferStorageMask::GL_MAP_WRITE_BIT | BufferStorageMask::GL_MAP_PERSISTENT_BIT |
+                               BufferStorageMask::GL_MAP_COHERENT_BIT);
+        m_mapped = static_cast<char*>(m_buffer.map_range(0, size, BufferAccessMask::GL_MAP_WRITE_BIT |
+                                                                  BufferAccessMask::GL_MAP_PERSISTENT_BIT |
+                                                                  BufferAccessMask::GL_MAP_COHERENT_BIT));
+    }
+    else {
+        m_staging.resize(size);
+        m_buffer.allocate(size, GL_STREAM_DRAW);
+    }
+}
+
+StreamBuffer::~StreamBuffer() { }
+
+StreamBuffer::Range StreamBuffer::allocate(size_t size, size_t alignment) {
+    return {static_cast<ptrdiff_t>(m_ring.allocate(size, alignment)), size};
+}
+
+char* StreamBuffer::data(Range const& range) {
+    return (m_mapped ? m_mapped : m_staging.data()) + range.offset;
+}
+
+StreamBuffer::Geometry StreamBuffer::write(MeshArena::VertexFormat const& format, const void* vertices,
+                                           unsigned int nVertices, std::vector<unsigned short> const& indices) {
+    return write(format, vertices, nVertices, indices.data(), indices.size(), sizeof(unsigned short));
+}
+
+StreamBuffer::Geometry StreamBuffer::write(MeshArena::VertexFormat const& format, const void* vertices,
+                                           unsigned int nVertices, std::vector<unsigned int> const& indices) {
+    return write(format, vertices, nVertices, indices.data(), indices.size(), sizeof(unsigned int));
+}
+
+StreamBuffer::Geometry StreamBuffer::write(MeshArena::VertexFormat const& format, const void* vertices,
+                                           unsigned int nVertices, const void* indices, size_t nIndices,
+                                           size_t indexSize) {
+    size_t stride = format.stride();
+    // Aligned on the stride so that the first vertex is an index in the buffer
+    Range v = allocate(nVertices * stride, stride);
+    std::memcpy(data(v), vertices, v.size);
+    Geometry g{static_cast<GLint>(static_cast<size_t>(v.offset) / stride), static_cast<GLsizei>(nVertices),
+               0, static_cast<GLsizei>(nIndices), indexSize == sizeof(unsigned int) ? GL_UNSIGNED_INT :
+                                                                                     GL_UNSIGNED_SHORT};
+    if(nIndices) {
+        Range i = allocate(nIndices * indexSize, indexSize);
+        std::memcpy(data(i), indices, i.size);
+        g.indexOffset = i.offset;
+    }
+    return g;
+}
+
+void StreamBuffer::flush() {
+    m_ring.flush();
+}
+
+void StreamBuffer::endFrame() {
+    m_ring.endFrame();
+}
+
+VAO* StreamBuffer::vao(MeshArena::VertexFormat const& format) {
+    for(CachedVAO const& c: m_vaos) {
+        if(c.format == format)
+            return c.vao.get();
+    }
+
+    VAO* vao = format.createVAO(m_buffer, m_buffer);
+    m_vaos.push_back({format, std::unique_ptr<VAO>(vao)});
+    return vao;
+}
+
+VBO const& StreamBuffer::buffer() const { return m_buffer; }
+bool StreamBuffer::persistent() const { return m_mapped != nullptr; }
+size_t StreamBuffer::size() const { return m_ring.size(); }
+size_t StreamBuffer::used() const { return m_ring.used(); }
+size_t StreamBuffer::waits() const { return m_ring.waits(); }
+
+bool StreamBuffer::persistentSupported() {
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for(GLint i = 0 ; i < n ; ++i) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if(ext && std::strcmp(ext, "GL_ARB_buffer_storage") == 0)
+            return true;
+    }
+    return false;
+}
+
+void StreamBuffer::upload(size_t offset, size_t size) {
+    // The persistent mapping is coherent
+    if(m_mapped)
+        return;
+    // The range was released by its fence, so the write doesn't need to wait
+    void* dst = m_buffer.map_range(static_cast<ptrdiff_t>(offset), size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    std::memcpy(dst, m_staging.data() + offset, size);
+    m_buffer.unmap();
+}
+
+} // namespace Engine
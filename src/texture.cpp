@@ -1,6 +1,7 @@
 #include "texture.h"
 #include "image.h"
 #include "debug.h"
+#include "glstate.h"
 #include <vector>
 
 using namespace gl;
@@ -39,8 +40,10 @@ Texture& Texture::operator=(Texture&& other) {
 }
 
 Texture::~Texture() {
-    if(m_id)
+    if(m_id) {
+        GLState::textureDeleted(m_id);
         glDeleteTextures(1, &m_id);
+    }
 }
 
 Texture Texture::fromImage(RGBImage const& img) {
@@ -82,11 +85,11 @@ Texture Texture::depthTextureFromImage(GreyscaleImage const& img) {
 }
 
 void Texture::bind(GLenum target) const {
-    glBindTexture(target, m_id);
+    GLState::bindTexture(target, m_id);
 }
 
 void Texture::unbind(GLenum target) {
-    glBindTexture(target, 0);
+    GLState::bindTexture(target, 0);
 }
 
 Texture Texture::noTexture() {
@@ -101,10 +104,10 @@ void Texture::generateMipmap() {
 }
 
 void Texture::texData(GLint internalFormat, GLenum format, GLenum type, GLint width, GLint height, const void* data) {
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    GLState::bindTexture(GL_TEXTURE_2D, m_id);
     glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, data);
     glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Texture::filtering(GLenum minMag, GLenum filter) {
@@ -0,0 +1,119 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace Engine {
+
+ThreadPool::ThreadPool(unsigned int nThreads) :
+    m_threads(),
+    m_tasks(),
+    m_mutex(),
+    m_cv(),
+    m_stop(false)
+{
+    for(unsigned int i = 0 ; i != nThreads ; ++i) {
+        m_threads.emplace_back(&ThreadPool::worker, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for(auto& t: m_threads) {
+        t.join();
+    }
+}
+
+unsigned int ThreadPool::size() const {
+    return static_cast<unsigned int>(m_threads.size());
+}
+
+void ThreadPool::parallel_for(size_t n, std::function<void(size_t)> const& f) {
+    if(n == 0)
+        return;
+    /* The state is shared with the queued runners, which may only start after
+     * the caller has already processed every index and returned. */
+    struct State {
+        std::atomic<size_t> next;
+        std::atomic<size_t> done;
+        std::mutex mutex;
+        std::condition_variable cv;
+        /* First exception thrown by f, guarded by mutex */
+        std::exception_ptr error;
+        size_t n;
+        std::function<void(size_t)> const* f;
+
+        void complete(size_t count) {
+            if(count != 0 && done.fetch_add(count) + count == n) {
+                std::lock_guard<std::mutex> lock(mutex);
+                cv.notify_all();
+            }
+        }
+    };
+    auto state = std::make_shared<State>();
+    state->next = 0;
+    state->done = 0;
+    state->n = n;
+    state->f = &f;
+    auto run = [state] () {
+        size_t i;
+        while((i = state->next.fetch_add(1)) < state->n) {
+            try {
+                (*state->f)(i);
+            }
+            catch(...) {
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if(!state->error)
+                        state->error = std::current_exception();
+                }
+                // Stop handing out indices, the ones nobody claimed yet are
+                // never run but count as done
+                size_t claimed = std::min(state->next.exchange(state->n), state->n);
+                state->complete(state->n - claimed);
+            }
+            state->complete(1);
+        }
+    };
+    size_t nRunners = std::min<size_t>(m_threads.size(), n - 1);
+    for(size_t i = 0 ; i != nRunners ; ++i) {
+        enqueue(run);
+    }
+    run();
+    // Wait for the indices claimed by the runners even after a failure, f
+    // and the data it refers to belong to the caller
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state] () { return state->done == state->n; });
+    if(state->error)
+        std::rethrow_exception(state->error);
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::worker() {
+    while(true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] () { return m_stop || !m_tasks.empty(); });
+            if(m_stop && m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+
+} // namespace Engine
@@ -0,0 +1,60 @@
+#include "uniformbuffers.h"
+
+#include <algorithm>
+#include <glm/gtc/matrix_inverse.hpp>
+
+using namespace gl;
+
+namespace Engine {
+
+ObjectBuffer::ObjectBuffer() :
+    m_buffer(),
+    m_staging(),
+    m_stride(0),
+    m_count(0)
+{ }
+
+ObjectBuffer::~ObjectBuffer() { }
+
+void ObjectBuffer::clear() {
+    m_count = 0;
+}
+
+unsigned int ObjectBuffer::push(glm::mat4 const& world) {
+    if(m_stride == 0) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        size_t a = static_cast<size_t>(std::max(alignment, 1));
+        m_stride = (traits::block_size<ObjectBlock>::value + a - 1) / a * a;
+    }
+    if(m_staging.size() < (m_count + 1) * m_stride)
+        m_staging.resize(std::max<size_t>(64, 2 * (m_count + 1)) * m_stride);
+    ObjectBlock block;
+    block.world = world;
+    block.normalTransform = glm::inverseTranspose(glm::mat3(world));
+    traits::pack_std140(block, &m_staging[m_count * m_stride]);
+    return static_cast<unsigned int>(m_count++);
+}
+
+size_t ObjectBuffer::size() const { return m_count; }
+
+void ObjectBuffer::upload() {
+    if(m_count == 0)
+        return;
+    if(!m_buffer)
+        m_buffer.reset(new VBO());
+    size_t size = m_count * m_stride;
+    // The storage read by the previous frame is orphaned rather than waited for
+    if(size > m_buffer->size())
+        m_buffer->allocate(size, GL_STREAM_DRAW);
+    else
+        m_buffer->orphan();
+    m_buffer->update_data(m_staging[0], size, 0);
+}
+
+void ObjectBuffer::bind(unsigned int slot) {
+    m_buffer->bindRange(GL_UNIFORM_BUFFER, ObjectBlockBinding,
+                        static_cast<ptrdiff_t>(slot * m_stride), traits::block_size<ObjectBlock>::value);
+}
+
+} // namespace Engine
@@ -0,0 +1,58 @@
+#include "uniformring.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace gl;
+
+namespace Engine {
+
+UniformRing::UniformRing(size_t size, unsigned int frames) :
+    m_buffer(),
+    m_staging(size),
+    m_alignment(1),
+    m_ring("UniformRing", size, frames, [this] (size_t offset, size_t bytes) { upload(offset, bytes); })
+{
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_alignment = static_cast<size_t>(std::max(alignment, 1));
+    m_buffer.allocate(size, GL_STREAM_DRAW);
+}
+
+UniformRing::~UniformRing() { }
+
+UniformRing::Slice UniformRing::allocate(size_t size) {
+    // Aligned sizes keep the head aligned, so that no padding is needed
+    size_t aligned = (size + m_alignment - 1) / m_alignment * m_alignment;
+    return {static_cast<ptrdiff_t>(m_ring.allocate(aligned, m_alignment)), size};
+}
+
+char* UniformRing::data(Slice const& slice) {
+    return m_staging.data() + slice.offset;
+}
+
+void UniformRing::flush() {
+    m_ring.flush();
+}
+
+void UniformRing::bind(Slice const& slice, unsigned int binding) {
+    m_buffer.bindRange(GL_UNIFORM_BUFFER, binding, slice.offset, slice.size);
+}
+
+void UniformRing::endFrame() {
+    m_ring.endFrame();
+}
+
+size_t UniformRing::size() const { return m_ring.size(); }
+size_t UniformRing::used() const { return m_ring.used(); }
+size_t UniformRing::waits() const { return m_ring.waits(); }
+
+void UniformRing::upload(size_t offset, size_t size) {
+    // The range was released by its fence, so the write doesn't need to wait
+    void* dst = m_buffer.map_range(static_cast<ptrdiff_t>(offset), size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    std::memcpy(dst, m_staging.data() + offset, size);
+    m_buffer.unmap();
+}
+
+} // namespace Engine
@@ -1,5 +1,6 @@
 #include "vao.h"
 #include "vbo.h"
+#include "glstate.h"
 #include "debug.h"
 
 using namespace gl;
@@ -13,15 +14,16 @@ VAO::VAO() :
 }
 
 VAO::~VAO() {
+    GLState::vertexArrayDeleted(m_id);
     glDeleteVertexArrays(1, &m_id);
 }
 
 void VAO::bind() const {
-    glBindVertexArray(m_id);
+    GLState::bindVertexArray(m_id);
 }
 
 void VAO::unbind() {
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 }
 
 void VAO::enableVertexAttribArray(GLuint index, bool enable) {
@@ -38,4 +40,15 @@ void VAO::vertexAttribPointer(VBO const& array, GLuint index, GLint size, GLsize
     VBO::unbind();
 }
 
+void VAO::vertexAttribDivisor(GLuint index, GLuint divisor) {
+    bind();
+    glVertexAttribDivisor(index, divisor);
+}
+
+void VAO::elementBuffer(VBO const& indices) {
+    bind();
+    indices.bind(GL_ELEMENT_ARRAY_BUFFER);
+    unbind();
+}
+
 } // namespace Engine
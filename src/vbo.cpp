@@ -1,17 +1,25 @@
 #include "vbo.h"
+#include "glstate.h"
+
+#include <stdexcept>
+#include <glbinding/gl/functions.h>
 
 using namespace gl;
 
 namespace Engine {
 
 VBO::VBO() :
-    m_id()
+    m_id(),
+    m_size(0),
+    m_hint(GL_STATIC_DRAW)
 {
     glGenBuffers(1, &m_id);
 }
 
 VBO::VBO(size_t size) :
-    m_id()
+    m_id(),
+    m_size(size),
+    m_hint(GL_STATIC_DRAW)
 {
     glGenBuffers(1, &m_id);
     bind();
@@ -20,19 +28,76 @@ VBO::VBO(size_t size) :
 }
 
 VBO::~VBO() {
+    GLState::bufferDeleted(m_id);
     glDeleteBuffers(1, &m_id);
 }
 
 void VBO::bind(GLenum target) const {
-    glBindBuffer(target, m_id);
+    GLState::bindBuffer(target, m_id);
 }
 
 void VBO::bindBase(GLenum target, unsigned int index) {
-    glBindBufferBase(target, index, m_id);
+    GLState::bindBufferBase(target, index, m_id);
+}
+
+void VBO::bindRange(GLenum target, unsigned int index, ptrdiff_t offset, size_t size) {
+    GLState::bindBufferRange(target, index, m_id, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+}
+
+void VBO::allocate(size_t size, GLenum hint) {
+    upload_data(nullptr, size, hint);
+}
+
+void VBO::orphan() {
+    upload_data(nullptr, m_size, m_hint);
+}
+
+void VBO::storage(size_t size, BufferStorageMask flags) {
+    m_size = size;
+    bind(GL_COPY_WRITE_BUFFER);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, flags);
+}
+
+size_t VBO::size() const { return m_size; }
+
+void VBO::upload_data(const void* data, size_t size, GLenum hint) {
+    m_size = size;
+    m_hint = hint;
+    bind();
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), data, hint);
+    unbind();
+}
+
+void VBO::copy_data(VBO const& src, ptrdiff_t readOffset, ptrdiff_t writeOffset, size_t size) {
+    src.bind(GL_COPY_READ_BUFFER);
+    bind(GL_COPY_WRITE_BUFFER);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(readOffset),
+                        static_cast<GLintptr>(writeOffset), static_cast<GLsizeiptr>(size));
+}
+
+void VBO::read_data(void* data, size_t size, ptrdiff_t offset) const {
+    bind(GL_COPY_READ_BUFFER);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+}
+
+void* VBO::map_range(ptrdiff_t offset, size_t size, BufferAccessMask access) {
+    // Mapped through the copy target to leave the vertex and index buffer
+    // bindings alone
+    bind(GL_COPY_WRITE_BUFFER);
+    void* data = glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset),
+                                  static_cast<GLsizeiptr>(size), access);
+    if(!data)
+        throw std::runtime_error("Failed to map the buffer.");
+    return data;
+}
+
+bool VBO::unmap() {
+    bind(GL_COPY_WRITE_BUFFER);
+    return glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
 }
 
 void VBO::unbind(GLenum target) {
-    glBindBuffer(target, 0);
+    GLState::bindBuffer(target, 0);
 }
 
 } // namespace Engine
@@ -0,0 +1,36 @@
+#include <catch.hpp>
+
+#include <stdexcept>
+
+#include "assetloader.h"
+
+using namespace Engine;
+
+/* The loads fail before any OpenGL call, so that no context is needed */
+TEST_CASE("Testing AssetLoader without worker threads", "[assetloader]") {
+    AssetLoader loader(0);
+    Asset<Program> program = loader.loadProgram("missing.vs", "missing.fs");
+    REQUIRE(program.valid());
+    REQUIRE(loader.loading() == 0);
+    REQUIRE(!program.ready());
+
+    loader.finish();
+    REQUIRE(loader.queued() == 0);
+    REQUIRE(program.ready());
+    REQUIRE(program.failed());
+    REQUIRE_THROWS(program.get());
+}
+
+TEST_CASE("Testing AssetLoader failures on worker threads", "[assetloader]") {
+    AssetLoader loader(2);
+    std::vector<Asset<Program>> programs;
+    for(int i = 0 ; i != 8 ; ++i) {
+        programs.push_back(loader.loadProgram("missing.vs", "missing.fs"));
+    }
+    loader.finish();
+    REQUIRE(loader.loading() == 0);
+    for(Asset<Program> const& p: programs) {
+        REQUIRE(p.failed());
+        REQUIRE_THROWS_AS(p.get(), std::runtime_error);
+    }
+}
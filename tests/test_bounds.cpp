@@ -0,0 +1,91 @@
+#include <catch.hpp>
+
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bounds.h"
+
+using namespace Engine;
+
+namespace {
+    /* Spheres around a camera at the origin looking down -z, some with a
+     * negative radius */
+    SphereArray randomSpheres(size_t n, std::mt19937& rng) {
+        std::uniform_real_distribution<float> position(-60.f, 60.f);
+        std::uniform_real_distribution<float> radius(0.01f, 4.f);
+        SphereArray spheres;
+        spheres.resize(n);
+        for(size_t i = 0 ; i != n ; ++i) {
+            float r = (i % 29 == 3) ? -1.f : radius(rng);
+            spheres.set(i, BoundingSphere(glm::vec3(position(rng), position(rng), position(rng)), r));
+        }
+        return spheres;
+    }
+
+    void compare(Frustum const& f, SphereArray const& s, size_t first, size_t n, float minSize) {
+        std::vector<std::uint8_t> simd(n + 1, 2), scalar(n + 1, 2);
+        size_t simdCount = cullSpheres(f, s.x.data() + first, s.y.data() + first, s.z.data() + first,
+                                       s.r.data() + first, n, minSize, simd.data());
+        size_t scalarCount = cullSpheresScalar(f, s.x.data() + first, s.y.data() + first, s.z.data() + first,
+                                               s.r.data() + first, n, minSize, scalar.data());
+        REQUIRE(simdCount == scalarCount);
+        REQUIRE(simd == scalar);
+        // Nothing is written past the end
+        REQUIRE(simd[n] == 2);
+    }
+}
+
+TEST_CASE("Testing cullSpheres against cullSpheresScalar", "[bounds]") {
+    std::mt19937 rng(13);
+    Frustum f(glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 50.f));
+    SphereArray spheres = randomSpheres(1100, rng);
+
+    // Counts that aren't multiples of the SSE or AVX width, and unaligned
+    // starts
+    for(size_t n: {0, 1, 3, 4, 5, 7, 8, 9, 12, 15, 16, 17, 31, 100, 1001}) {
+        for(size_t first: {0, 1, 3}) {
+            compare(f, spheres, first, n, 0.f);
+            compare(f, spheres, first, n, 0.05f);
+        }
+    }
+}
+
+TEST_CASE("Testing cullSpheres screen size rejection", "[bounds]") {
+    std::mt19937 rng(17);
+    Frustum f(glm::perspective(glm::radians(60.f), 1.f, 0.1f, 50.f));
+    SphereArray spheres = randomSpheres(1000, rng);
+    size_t n = spheres.size();
+
+    std::vector<std::uint8_t> all(n), large(n);
+    size_t nAll = cullSpheres(f, spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.r.data(), n, 0.f,
+                              all.data());
+    size_t nLarge = cullSpheres(f, spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.r.data(), n,
+                                0.1f, large.data());
+    REQUIRE(nAll != 0);
+    REQUIRE(nLarge < nAll);
+
+    for(size_t i = 0 ; i != n ; ++i) {
+        // The size test only culls more spheres, never the unbounded ones
+        if(large[i])
+            REQUIRE(all[i]);
+        if(spheres.r[i] < 0.f)
+            REQUIRE(large[i]);
+        if(all[i] && !large[i]) {
+            float nearDist = glm::dot(glm::vec3(f.plane(Frustum::Near)),
+                                      glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i])) +
+                             f.plane(Frustum::Near).w;
+            REQUIRE(spheres.r[i] < 0.1f * nearDist * 1.001f);
+        }
+    }
+
+    // Spheres close to the camera stay visible
+    SphereArray close;
+    close.resize(9);
+    for(size_t i = 0 ; i != close.size() ; ++i) {
+        close.set(i, BoundingSphere(glm::vec3(0.f, 0.f, -1.f - static_cast<float>(i)), 1.f));
+    }
+    std::vector<std::uint8_t> visible(close.size());
+    REQUIRE(cullSpheres(f, close.x.data(), close.y.data(), close.z.data(), close.r.data(), close.size(), 0.1f,
+                        visible.data()) == close.size());
+}
@@ -0,0 +1,156 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "bvh.h"
+
+using namespace Engine;
+
+namespace {
+    std::vector<AABB> randomBoxes(size_t n, std::mt19937& rng) {
+        std::uniform_real_distribution<float> position(-100.f, 100.f);
+        std::uniform_real_distribution<float> size(0.1f, 5.f);
+        std::vector<AABB> boxes;
+        for(size_t i = 0 ; i != n ; ++i) {
+            glm::vec3 min(position(rng), position(rng), position(rng));
+            boxes.push_back(AABB(min, min + glm::vec3(size(rng), size(rng), size(rng))));
+        }
+        return boxes;
+    }
+
+    bool overlaps(AABB const& a, AABB const& b) {
+        return !a.empty() && !b.empty() &&
+               a.min().x <= b.max().x && a.max().x >= b.min().x &&
+               a.min().y <= b.max().y && a.max().y >= b.min().y &&
+               a.min().z <= b.max().z && a.max().z >= b.min().z;
+    }
+
+    /* Entry parameter of the ray in the box, infinity if missed */
+    float hit(AABB const& b, glm::vec3 const& origin, glm::vec3 const& direction) {
+        float tMin = 0.f;
+        float tMax = std::numeric_limits<float>::infinity();
+        if(b.empty())
+            return tMax;
+        for(int i = 0 ; i != 3 ; ++i) {
+            float t0 = (b.min()[i] - origin[i]) / direction[i];
+            float t1 = (b.max()[i] - origin[i]) / direction[i];
+            tMin = std::max(tMin, std::min(t0, t1));
+            tMax = std::min(tMax, std::max(t0, t1));
+        }
+        return (tMin <= tMax) ? tMin : std::numeric_limits<float>::infinity();
+    }
+
+    std::vector<int> bruteQuery(std::vector<AABB> const& boxes, AABB const& region) {
+        std::vector<int> items;
+        for(size_t i = 0 ; i != boxes.size() ; ++i) {
+            if(overlaps(boxes[i], region))
+                items.push_back(static_cast<int>(i));
+        }
+        return items;
+    }
+
+    void checkQueries(BVH const& bvh, std::vector<AABB> const& boxes, std::mt19937& rng) {
+        std::uniform_real_distribution<float> position(-100.f, 100.f);
+        for(int q = 0 ; q != 50 ; ++q) {
+            glm::vec3 min(position(rng), position(rng), position(rng));
+            AABB region(min, min + glm::vec3(20.f));
+            std::vector<int> items;
+            bvh.query(region, items);
+            std::sort(items.begin(), items.end());
+            REQUIRE(items == bruteQuery(boxes, region));
+        }
+    }
+
+    void checkRaycasts(BVH const& bvh, std::vector<AABB> const& boxes, std::mt19937& rng) {
+        std::uniform_real_distribution<float> position(-150.f, 150.f);
+        std::uniform_real_distribution<float> direction(-1.f, 1.f);
+        for(int r = 0 ; r != 50 ; ++r) {
+            glm::vec3 origin(position(rng), position(rng), position(rng));
+            glm::vec3 dir(direction(rng), direction(rng), direction(rng));
+            // Aim at a box half of the time, so that most rays hit
+            if(r % 2)
+                dir = boxes[static_cast<size_t>(r) % boxes.size()].center() - origin;
+            float best = std::numeric_limits<float>::infinity();
+            for(AABB const& b: boxes) {
+                best = std::min(best, hit(b, origin, dir));
+            }
+            float t;
+            int i = bvh.raycast(origin, dir, &t);
+            if(std::isinf(best)) {
+                REQUIRE(i == -1);
+            }
+            else {
+                REQUIRE(i != -1);
+                REQUIRE(t == Approx(best).margin(1e-3f));
+                REQUIRE(hit(boxes[static_cast<size_t>(i)], origin, dir) == Approx(best).margin(1e-3f));
+            }
+        }
+    }
+}
+
+TEST_CASE("Testing BVH build", "[bvh]") {
+    std::mt19937 rng(7);
+    std::vector<AABB> boxes = randomBoxes(1000, rng);
+    // Empty boxes are never returned
+    boxes[10] = AABB();
+    boxes[500] = AABB();
+
+    BVH bvh;
+    bvh.build(boxes);
+    REQUIRE(bvh.size() == boxes.size() - 2);
+    REQUIRE(bvh.nodeCount() > 1);
+
+    std::vector<int> items;
+    bvh.query(AABB(glm::vec3(-200.f), glm::vec3(200.f)), items);
+    REQUIRE(items.size() == boxes.size() - 2);
+    REQUIRE(std::find(items.begin(), items.end(), 10) == items.end());
+    REQUIRE(std::find(items.begin(), items.end(), 500) == items.end());
+
+    checkQueries(bvh, boxes, rng);
+    checkRaycasts(bvh, boxes, rng);
+}
+
+TEST_CASE("Testing BVH refit", "[bvh]") {
+    std::mt19937 rng(11);
+    std::vector<AABB> boxes = randomBoxes(1000, rng);
+    BVH bvh;
+    bvh.build(boxes);
+
+    std::uniform_real_distribution<float> offset(-30.f, 30.f);
+    auto move = [&] (size_t i) {
+        glm::vec3 d(offset(rng), offset(rng), offset(rng));
+        boxes[i] = AABB(boxes[i].min() + d, boxes[i].max() + d);
+    };
+
+    SECTION("Every item") {
+        for(size_t i = 0 ; i != boxes.size() ; ++i) {
+            move(i);
+        }
+        bvh.refit(boxes);
+        checkQueries(bvh, boxes, rng);
+        checkRaycasts(bvh, boxes, rng);
+    }
+
+    SECTION("Some items") {
+        std::vector<int> moved;
+        for(size_t i = 0 ; i < boxes.size() ; i += 37) {
+            move(i);
+            moved.push_back(static_cast<int>(i));
+        }
+        bvh.refit(boxes, moved);
+        checkQueries(bvh, boxes, rng);
+        checkRaycasts(bvh, boxes, rng);
+    }
+}
+
+TEST_CASE("Testing BVH with no items", "[bvh]") {
+    BVH bvh;
+    bvh.build(std::vector<AABB>());
+    std::vector<int> items;
+    bvh.query(AABB(glm::vec3(-1.f), glm::vec3(1.f)), items);
+    REQUIRE(items.empty());
+    REQUIRE(bvh.raycast(glm::vec3(0.f), glm::vec3(1.f, 0.f, 0.f)) == -1);
+}
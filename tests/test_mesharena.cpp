@@ -0,0 +1,193 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "mesharena.h"
+
+using namespace Engine;
+
+namespace {
+    struct Range {
+        size_t offset;
+        size_t size;
+    };
+
+    /* Size of the largest run of free units */
+    size_t largestRun(std::vector<bool> const& used) {
+        size_t largest = 0, run = 0;
+        for(bool u: used) {
+            run = u ? 0 : run + 1;
+            largest = std::max(largest, run);
+        }
+        return largest;
+    }
+}
+
+TEST_CASE("Testing RangeAllocator allocation and release", "[rangeallocator]") {
+    RangeAllocator r(100);
+    REQUIRE(r.capacity() == 100);
+    REQUIRE(r.used() == 0);
+    REQUIRE(r.largestFree() == 100);
+
+    size_t a = r.allocate(30);
+    size_t b = r.allocate(30);
+    size_t c = r.allocate(30);
+    REQUIRE(a == 0);
+    REQUIRE(b == 30);
+    REQUIRE(c == 60);
+    REQUIRE(r.used() == 90);
+    REQUIRE(r.largestFree() == 10);
+
+    SECTION("Coalescing with the following range") {
+        r.release(b, 30);
+        REQUIRE(r.largestFree() == 30);
+        r.release(a, 30);
+        REQUIRE(r.largestFree() == 60);
+        REQUIRE(r.allocate(60) == 0);
+    }
+
+    SECTION("Coalescing with the preceding range") {
+        r.release(a, 30);
+        r.release(b, 30);
+        REQUIRE(r.largestFree() == 60);
+        r.release(c, 30);
+        REQUIRE(r.largestFree() == 100);
+        REQUIRE(r.used() == 0);
+    }
+
+    SECTION("First fit") {
+        r.release(a, 30);
+        r.release(c, 30);
+        // The hole at the start comes first
+        REQUIRE(r.allocate(20) == 0);
+        REQUIRE(r.allocate(20) == 60);
+        REQUIRE(r.allocate(10) == 20);
+    }
+}
+
+TEST_CASE("Testing RangeAllocator alignment", "[rangeallocator]") {
+    RangeAllocator r(100);
+    REQUIRE(r.allocate(3) == 0);
+    REQUIRE(r.allocate(8, 4) == 4);
+    REQUIRE(r.used() == 11);
+    // The padding stays free
+    REQUIRE(r.allocate(1) == 3);
+    REQUIRE(r.allocate(5, 16) == 16);
+    REQUIRE(r.allocate(4) == 12);
+    REQUIRE(r.allocate(80, 16) == RangeAllocator::npos);
+    REQUIRE(r.allocate(64, 16) == 32);
+    REQUIRE(r.allocate(4, 7) == 21);
+    REQUIRE(r.allocate(1, 1) == 25);
+}
+
+TEST_CASE("Testing RangeAllocator exhaustion", "[rangeallocator]") {
+    RangeAllocator r(64);
+    REQUIRE(r.allocate(65) == RangeAllocator::npos);
+    REQUIRE(r.allocate(64) == 0);
+    REQUIRE(r.allocate(1) == RangeAllocator::npos);
+    REQUIRE(r.largestFree() == 0);
+
+    // Holes too small for the request
+    r.release(10, 4);
+    r.release(40, 4);
+    REQUIRE(r.largestFree() == 4);
+    REQUIRE(r.allocate(5) == RangeAllocator::npos);
+
+    // Growing adds the new space after the last range
+    r.grow(100);
+    REQUIRE(r.capacity() == 100);
+    REQUIRE(r.largestFree() == 36);
+    REQUIRE(r.allocate(5) == 64);
+
+    RangeAllocator empty;
+    REQUIRE(empty.allocate(1) == RangeAllocator::npos);
+    empty.grow(8);
+    REQUIRE(empty.allocate(8) == 0);
+}
+
+TEST_CASE("Testing RangeAllocator against a model", "[rangeallocator]") {
+    const size_t capacity = 4096;
+    RangeAllocator r(capacity);
+    std::vector<bool> used(capacity, false);
+    std::vector<Range> live;
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<size_t> size(1, 64);
+    std::uniform_int_distribution<int> alignment(0, 3);
+
+    for(int i = 0 ; i != 5000 ; ++i) {
+        if(live.empty() || rng() % 3 != 0) {
+            size_t s = size(rng);
+            size_t align = size_t(1) << alignment(rng);
+            size_t offset = r.allocate(s, align);
+            if(offset == RangeAllocator::npos) {
+                // Only fails when no free run fits, whatever the alignment
+                REQUIRE(largestRun(used) < s + align - 1);
+                continue;
+            }
+            REQUIRE(offset % align == 0);
+            REQUIRE(offset + s <= capacity);
+            for(size_t u = offset ; u != offset + s ; ++u) {
+                REQUIRE(!used[u]);
+                used[u] = true;
+            }
+            live.push_back({offset, s});
+        }
+        else {
+            size_t k = rng() % live.size();
+            Range range = live[k];
+            live[k] = live.back();
+            live.pop_back();
+            r.release(range.offset, range.size);
+            std::fill(used.begin() + static_cast<ptrdiff_t>(range.offset),
+                      used.begin() + static_cast<ptrdiff_t>(range.offset + range.size), false);
+        }
+        REQUIRE(r.used() == static_cast<size_t>(std::count(used.begin(), used.end(), true)));
+        // Neighbouring free ranges are always merged
+        REQUIRE(r.largestFree() == largestRun(used));
+    }
+}
+
+TEST_CASE("Testing RangeAllocator compaction", "[rangeallocator]") {
+    RangeAllocator r(1000);
+    std::vector<Range> live;
+    for(size_t i = 0 ; i != 20 ; ++i) {
+        size_t s = 10 + i;
+        live.push_back({r.allocate(s), s});
+    }
+    // Leave holes
+    for(size_t i = 0 ; i < live.size() ; i += 3) {
+        r.release(live[i].offset, live[i].size);
+        live[i].size = 0;
+    }
+    live.erase(std::remove_if(live.begin(), live.end(), [] (Range const& a) { return a.size == 0; }),
+               live.end());
+    size_t used = r.used();
+    REQUIRE(r.largestFree() < r.capacity() - used);
+
+    // Move the ranges to the start in offset order, like MeshArena::compact
+    std::sort(live.begin(), live.end(), [] (Range const& a, Range const& b) { return a.offset < b.offset; });
+    size_t offset = 0;
+    size_t moved = 0;
+    for(Range& a: live) {
+        REQUIRE(offset <= a.offset);
+        if(a.offset != offset)
+            ++moved;
+        a.offset = offset;
+        offset += a.size;
+    }
+    REQUIRE(offset == used);
+    REQUIRE(moved != 0);
+    r.reset(used);
+
+    REQUIRE(r.used() == used);
+    REQUIRE(r.largestFree() == r.capacity() - used);
+    REQUIRE(r.allocate(r.capacity() - used) == used);
+    // The moved ranges can be released where they now are
+    for(Range const& a: live) {
+        r.release(a.offset, a.size);
+    }
+    REQUIRE(r.used() == r.capacity() - used);
+    REQUIRE(r.largestFree() == used);
+}
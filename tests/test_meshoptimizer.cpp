@@ -0,0 +1,121 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include "meshoptimizer.h"
+
+using namespace Engine;
+
+namespace {
+    using Triangle = std::array<unsigned int, 3>;
+
+    /* Grid of n * n quads, with the triangles in random order */
+    void makeGrid(size_t n, std::vector<unsigned int>& indices, std::vector<glm::vec3>& positions) {
+        positions.clear();
+        for(size_t y = 0 ; y != n + 1 ; ++y) {
+            for(size_t x = 0 ; x != n + 1 ; ++x) {
+                positions.push_back(glm::vec3(x, y, 0.1f * ((x * y) % 3)));
+            }
+        }
+        std::vector<Triangle> triangles;
+        for(size_t y = 0 ; y != n ; ++y) {
+            for(size_t x = 0 ; x != n ; ++x) {
+                unsigned int i = static_cast<unsigned int>(y * (n + 1) + x);
+                unsigned int w = static_cast<unsigned int>(n + 1);
+                triangles.push_back({i, i + 1, i + w});
+                triangles.push_back({i + 1, i + w + 1, i + w});
+            }
+        }
+        std::mt19937 rng(42);
+        std::shuffle(triangles.begin(), triangles.end(), rng);
+        indices.clear();
+        for(Triangle const& t: triangles) {
+            indices.insert(indices.end(), t.begin(), t.end());
+        }
+    }
+
+    /* Triangles of a list, rotated to start with their smallest index so
+     * that the winding is kept, and sorted */
+    std::vector<Triangle> triangles(std::vector<unsigned int> const& indices) {
+        std::vector<Triangle> result;
+        for(size_t i = 0 ; i + 2 < indices.size() ; i += 3) {
+            Triangle t = {indices[i], indices[i + 1], indices[i + 2]};
+            std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+            result.push_back(t);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+}
+
+TEST_CASE("Testing optimizeVertexCache", "[meshoptimizer]") {
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3> positions;
+    makeGrid(32, indices, positions);
+    std::vector<unsigned int> original = indices;
+
+    VertexCacheStats before = analyzeVertexCache(indices, positions.size());
+    optimizeVertexCache(indices, positions.size());
+    VertexCacheStats after = analyzeVertexCache(indices, positions.size());
+
+    REQUIRE(after.acmr < before.acmr);
+    REQUIRE(after.acmr < 1.f);
+    REQUIRE(after.atvr >= 1.f);
+    REQUIRE(triangles(indices) == triangles(original));
+}
+
+TEST_CASE("Testing optimizeOverdraw", "[meshoptimizer]") {
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3> positions;
+    makeGrid(32, indices, positions);
+    optimizeVertexCache(indices, positions.size());
+    std::vector<unsigned int> original = indices;
+
+    VertexCacheStats before = analyzeVertexCache(indices, positions.size());
+    optimizeOverdraw(indices, positions, 1.05f);
+    VertexCacheStats after = analyzeVertexCache(indices, positions.size());
+
+    REQUIRE(triangles(indices) == triangles(original));
+    // The clusters are cut so that the ACMR stays close to the input
+    REQUIRE(after.acmr <= before.acmr * 1.5f);
+}
+
+TEST_CASE("Testing optimizeVertexFetch", "[meshoptimizer]") {
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3> positions;
+    makeGrid(16, indices, positions);
+    optimizeVertexCache(indices, positions.size());
+    // A vertex used by no triangle
+    positions.push_back(glm::vec3(-1.f));
+    std::vector<unsigned int> original = indices;
+    std::vector<glm::vec3> originalPositions = positions;
+
+    std::vector<unsigned int> remap = optimizeVertexFetch(indices, positions.size());
+    REQUIRE(remap.size() == positions.size());
+
+    // The remap is a permutation of the vertices
+    std::vector<unsigned int> sorted = remap;
+    std::sort(sorted.begin(), sorted.end());
+    for(size_t i = 0 ; i != sorted.size() ; ++i) {
+        REQUIRE(sorted[i] == i);
+    }
+    REQUIRE(remap.back() == positions.size() - 1);
+
+    // The vertices are numbered in the order of their first use
+    unsigned int next = 0;
+    for(unsigned int i: indices) {
+        REQUIRE(i <= next);
+        if(i == next)
+            ++next;
+    }
+
+    // The triangles still refer to the same vertices, in the same order
+    remapVertices(positions, remap);
+    REQUIRE(indices.size() == original.size());
+    for(size_t i = 0 ; i != indices.size() ; ++i) {
+        REQUIRE(indices[i] == remap[original[i]]);
+        REQUIRE(positions[indices[i]] == originalPositions[original[i]]);
+    }
+}
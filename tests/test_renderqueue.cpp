@@ -0,0 +1,107 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "renderqueue.h"
+
+using namespace Engine;
+
+namespace {
+    using Pass = RenderQueue::Pass;
+
+    /* Values of the keys after sorting them */
+    std::vector<std::uint32_t> sortOrder(std::vector<std::uint64_t> keys) {
+        std::vector<std::uint32_t> values(keys.size());
+        std::iota(values.begin(), values.end(), 0u);
+        std::vector<std::uint64_t> tmpKeys;
+        std::vector<std::uint32_t> tmpValues;
+        RenderQueue::radix_sort(keys, values, tmpKeys, tmpValues);
+        return values;
+    }
+}
+
+TEST_CASE("Testing RenderQueue::radix_sort", "[renderqueue]") {
+    std::mt19937_64 rng(5);
+    for(size_t n: {0, 1, 2, 100, 5000}) {
+        std::vector<std::uint64_t> keys(n);
+        for(size_t i = 0 ; i != n ; ++i) {
+            // Few distinct keys in the upper bits, so that some passes are
+            // skipped, and duplicates to check the stability
+            keys[i] = (rng() % 4) << 60 | (rng() % 64) << 20 | (rng() % 16);
+        }
+        std::vector<std::uint32_t> expected(n);
+        std::iota(expected.begin(), expected.end(), 0u);
+        std::stable_sort(expected.begin(), expected.end(),
+                         [&keys] (std::uint32_t a, std::uint32_t b) { return keys[a] < keys[b]; });
+
+        std::vector<std::uint64_t> sorted = keys;
+        std::vector<std::uint32_t> values(n);
+        std::iota(values.begin(), values.end(), 0u);
+        std::vector<std::uint64_t> tmpKeys;
+        std::vector<std::uint32_t> tmpValues;
+        RenderQueue::radix_sort(sorted, values, tmpKeys, tmpValues);
+
+        REQUIRE(values == expected);
+        REQUIRE(std::is_sorted(sorted.begin(), sorted.end()));
+        for(size_t i = 0 ; i != n ; ++i) {
+            REQUIRE(sorted[i] == keys[values[i]]);
+        }
+    }
+
+    // Full 64 bit keys
+    std::vector<std::uint64_t> keys(1000);
+    for(std::uint64_t& k: keys) {
+        k = rng();
+    }
+    std::vector<std::uint32_t> values = sortOrder(keys);
+    for(size_t i = 1 ; i != values.size() ; ++i) {
+        REQUIRE(keys[values[i - 1]] <= keys[values[i]]);
+    }
+}
+
+TEST_CASE("Testing RenderQueue::makeKey opaque order", "[renderqueue]") {
+    // The program matters most, then the texture, the VAO and the depth
+    REQUIRE(RenderQueue::makeKey(Pass::Opaque, 1, 0, 0, 0.f) >
+            RenderQueue::makeKey(Pass::Opaque, 0, 8191, 8191, 1e30f));
+    REQUIRE(RenderQueue::makeKey(Pass::Opaque, 0, 1, 0, 0.f) >
+            RenderQueue::makeKey(Pass::Opaque, 0, 0, 8191, 1e30f));
+    REQUIRE(RenderQueue::makeKey(Pass::Opaque, 0, 0, 1, 0.f) >
+            RenderQueue::makeKey(Pass::Opaque, 0, 0, 0, 1e30f));
+
+    // Front to back within a state
+    REQUIRE(RenderQueue::makeKey(Pass::Opaque, 3, 2, 1, 1.f) < RenderQueue::makeKey(Pass::Opaque, 3, 2, 1, 2.f));
+    REQUIRE(RenderQueue::makeKey(Pass::Opaque, 3, 2, 1, 0.5f) < RenderQueue::makeKey(Pass::Opaque, 3, 2, 1, 100.f));
+
+    // Negative depths are clamped to 0
+    REQUIRE(RenderQueue::makeKey(Pass::Opaque, 3, 2, 1, -5.f) == RenderQueue::makeKey(Pass::Opaque, 3, 2, 1, 0.f));
+
+    // The opaque pass comes first
+    REQUIRE(RenderQueue::makeKey(Pass::Opaque, 8191, 8191, 8191, 1e30f) <
+            RenderQueue::makeKey(Pass::Transparent, 0, 0, 0, 1e30f));
+}
+
+TEST_CASE("Testing RenderQueue::makeKey transparent order", "[renderqueue]") {
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<float> depth(0.1f, 1000.f);
+    std::vector<float> depths(500);
+    std::vector<std::uint64_t> keys;
+    for(float& d: depths) {
+        d = depth(rng);
+        // The state doesn't change the order of different depths
+        keys.push_back(RenderQueue::makeKey(Pass::Transparent, rng() % 8192, rng() % 8192, rng() % 8192, d));
+    }
+    std::vector<std::uint32_t> order = sortOrder(keys);
+    // Back to front, the depth key keeps the upper bits of the depth only
+    for(size_t i = 1 ; i != order.size() ; ++i) {
+        REQUIRE(depths[order[i - 1]] >= depths[order[i]] * (1.f - 1e-4f));
+    }
+
+    // The state is sorted within a depth
+    REQUIRE(RenderQueue::makeKey(Pass::Transparent, 0, 0, 0, 10.f) <
+            RenderQueue::makeKey(Pass::Transparent, 1, 0, 0, 10.f));
+    REQUIRE(RenderQueue::makeKey(Pass::Transparent, 8191, 8191, 8191, 20.f) <
+            RenderQueue::makeKey(Pass::Transparent, 0, 0, 0, 10.f));
+}
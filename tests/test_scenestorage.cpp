@@ -0,0 +1,154 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "matrixstack.h"
+#include "scenestorage.h"
+#include "threadpool.h"
+
+using namespace Engine;
+
+namespace {
+    glm::mat4 randomTransform(std::mt19937& rng) {
+        std::uniform_real_distribution<float> d(-0.1f, 0.1f);
+        glm::mat4 m(1.f);
+        for(int c = 0 ; c != 3 ; ++c) {
+            for(int r = 0 ; r != 3 ; ++r) {
+                m[c][r] += d(rng);
+            }
+        }
+        m[3] = glm::vec4(10.f * d(rng), 10.f * d(rng), 10.f * d(rng), 1.f);
+        return m;
+    }
+
+    /* Append a random subtree of about n nodes in depth-first order */
+    void appendSubtree(SceneStorage& s, int parent, size_t n, std::mt19937& rng) {
+        int i = s.append(parent, randomTransform(rng), SceneStorage::Enabled);
+        size_t left = n - 1;
+        while(left != 0) {
+            size_t child = std::min<size_t>(left, 1 + rng() % std::max<size_t>(left / 2, 1));
+            appendSubtree(s, i, child, rng);
+            left -= child;
+        }
+        s.close_subtree(i);
+    }
+
+    /* A large tree, to split it on the pool, and a few small ones */
+    void fill(SceneStorage& s, std::mt19937& rng) {
+        s.clear();
+        appendSubtree(s, SceneStorage::NoParent, 20000, rng);
+        for(int t = 0 ; t != 20 ; ++t) {
+            appendSubtree(s, SceneStorage::NoParent, 1 + rng() % 200, rng);
+        }
+    }
+
+    /* Compare the world transforms with a full recomputation */
+    void check(SceneStorage const& s) {
+        std::vector<glm::mat4> worlds(s.size());
+        for(int i = 0 ; i != static_cast<int>(s.size()) ; ++i) {
+            int p = s.parent(i);
+            worlds[i] = MatrixStack::compose((p == SceneStorage::NoParent) ? glm::mat4(1.f) : worlds[p],
+                                             s.local(i));
+            REQUIRE(s.world(i) == worlds[i]);
+            REQUIRE(!(s.flags(i) & SceneStorage::Dirty));
+        }
+    }
+
+    /* Number of nodes in the subtrees rooted at the dirty nodes */
+    size_t dirtySubtrees(SceneStorage const& s, std::vector<int> dirty) {
+        std::sort(dirty.begin(), dirty.end());
+        size_t n = 0;
+        int end = 0;
+        for(int i: dirty) {
+            if(i < end)
+                continue;
+            end = s.subtree_end(i);
+            n += static_cast<size_t>(end - i);
+        }
+        return n;
+    }
+
+    void run(ThreadPool* pool) {
+        std::mt19937 rng(21);
+        SceneStorage s;
+        fill(s, rng);
+        size_t n = s.size();
+
+        // Appending makes every node dirty
+        REQUIRE(s.updateWorldTransforms(pool) == n);
+        check(s);
+
+        // Nothing to update
+        REQUIRE(s.updateWorldTransforms(pool) == 0);
+
+        // A few dirty nodes only update their subtrees
+        for(int round = 0 ; round != 5 ; ++round) {
+            std::vector<int> dirty;
+            for(int k = 0 ; k != 50 ; ++k) {
+                int i = static_cast<int>(rng() % n);
+                s.set_local(i, randomTransform(rng));
+                dirty.push_back(i);
+            }
+            // A dirty node inside the subtree of another
+            int p = s.parent(dirty[0]);
+            if(p != SceneStorage::NoParent) {
+                s.set_local(p, randomTransform(rng));
+                dirty.push_back(p);
+            }
+            size_t expected = dirtySubtrees(s, dirty);
+            REQUIRE(expected < n);
+            REQUIRE(s.updateWorldTransforms(pool) == expected);
+            check(s);
+
+            std::vector<int> const& roots = s.updatedRoots();
+            for(size_t r = 1 ; r < roots.size() ; ++r) {
+                REQUIRE(s.subtree_end(roots[r - 1]) <= roots[r]);
+            }
+        }
+
+        // Past n / 8 dirty nodes, everything is updated
+        for(size_t i = 0 ; i < n ; i += 7) {
+            s.set_local(static_cast<int>(i), randomTransform(rng));
+        }
+        REQUIRE(s.updateWorldTransforms(pool) == n);
+        check(s);
+
+        // The whole large tree, split on the pool
+        s.set_local(0, randomTransform(rng));
+        REQUIRE(s.updateWorldTransforms(pool) == static_cast<size_t>(s.subtree_end(0)));
+        check(s);
+    }
+}
+
+TEST_CASE("Testing SceneStorage serial update", "[scenestorage]") {
+    run(nullptr);
+}
+
+TEST_CASE("Testing SceneStorage parallel update", "[scenestorage]") {
+    ThreadPool pool(4);
+    run(&pool);
+}
+
+TEST_CASE("Testing SceneStorage parallel and serial updates match", "[scenestorage]") {
+    std::mt19937 rngA(5), rngB(5);
+    SceneStorage a, b;
+    fill(a, rngA);
+    fill(b, rngB);
+    ThreadPool pool(3);
+    a.updateWorldTransforms();
+    b.updateWorldTransforms(&pool);
+    for(int round = 0 ; round != 3 ; ++round) {
+        for(int k = 0 ; k != 100 ; ++k) {
+            int i = static_cast<int>(rngA() % a.size());
+            glm::mat4 m = randomTransform(rngA);
+            a.set_local(i, m);
+            b.set_local(i, m);
+        }
+        REQUIRE(a.updateWorldTransforms() == b.updateWorldTransforms(&pool));
+        for(int i = 0 ; i != static_cast<int>(a.size()) ; ++i) {
+            REQUIRE(a.world(i) == b.world(i));
+        }
+    }
+}
@@ -1,6 +1,10 @@
 #include <catch.hpp>
 #include <glm/glm.hpp>
 
+#include <array>
+#include <cstring>
+#include <vector>
+
 #include "ubo.h"
 #include "utility.h"
 
@@ -15,6 +19,26 @@ struct T2 {
     glm::vec3 v2;
 };
 
+struct T3 {
+    glm::mat3 m;
+    float f;
+    glm::vec2 v;
+    bool b;
+};
+
+struct Light {
+    glm::vec4 position;
+    glm::vec3 color;
+};
+
+// Camera data and a light list, like a per-frame block
+struct T4 {
+    glm::mat4 view;
+    float scalars[3];
+    Light lights[2];
+    int count;
+};
+
 namespace Engine {
     namespace traits {
         template <>
@@ -26,6 +50,21 @@ namespace Engine {
         struct uniform_block_types<T2> {
             using type = type_list<glm::vec3, float, glm::vec3>;
         };
+
+        template <>
+        struct uniform_block_types<T3> {
+            using type = type_list<glm::mat3, float, glm::vec2, bool>;
+        };
+
+        template <>
+        struct uniform_block_types<Light> {
+            using type = type_list<glm::vec4, glm::vec3>;
+        };
+
+        template <>
+        struct uniform_block_types<T4> {
+            using type = type_list<glm::mat4, float[3], Light[2], int>;
+        };
     } // namespace traits
 } // namespace Engine
 
@@ -100,3 +139,120 @@ TEST_CASE("Testing get_field", "[ubo-traits]") {
     b = traits::get_field<T2, 2>::value(t2) == t2.v2;
     REQUIRE(b);
 }
+
+TEST_CASE("Testing pack_std140", "[ubo-traits]") {
+    // Fill with a marker to check that the padding is left untouched
+    std::array<unsigned char, traits::block_size<T1>::value> p1;
+    p1.fill(0xAB);
+    T1 t1;
+    t1.v1 = glm::vec3(1.f, 2.f, 3.f);
+    t1.v2 = glm::vec3(4.f, 5.f, 6.f);
+    traits::pack_std140(t1, p1.data());
+    REQUIRE(std::memcmp(p1.data(), &t1.v1, sizeof(glm::vec3)) == 0);
+    REQUIRE(std::memcmp(p1.data() + 16, &t1.v2, sizeof(glm::vec3)) == 0);
+    for(size_t i = 12 ; i != 16 ; ++i) {
+        REQUIRE(p1[i] == 0xAB);
+    }
+
+    std::array<unsigned char, traits::block_size<T2>::value> p2;
+    p2.fill(0xAB);
+    T2 t2;
+    t2.v1 = glm::vec3(1.f, 2.f, 3.f);
+    t2.f = 5.f;
+    t2.v2 = glm::vec3(6.f, 7.f, 8.f);
+    traits::pack_std140(t2, p2.data());
+    REQUIRE(std::memcmp(p2.data(), &t2.v1, sizeof(glm::vec3)) == 0);
+    // A scalar fills the padding after a vec3
+    REQUIRE(std::memcmp(p2.data() + 12, &t2.f, sizeof(float)) == 0);
+    REQUIRE(std::memcmp(p2.data() + 16, &t2.v2, sizeof(glm::vec3)) == 0);
+}
+
+TEST_CASE("Testing glsl_alignment and glsl_size", "[ubo-traits]") {
+    bool b = traits::glsl_alignment<float>::value == 4 && traits::glsl_size<float>::value == 4;
+    REQUIRE(b);
+    b = traits::glsl_alignment<bool>::value == 4 && traits::glsl_size<bool>::value == 4;
+    REQUIRE(b);
+    b = traits::glsl_alignment<glm::ivec2>::value == 8 && traits::glsl_size<glm::ivec2>::value == 8;
+    REQUIRE(b);
+    b = traits::glsl_alignment<glm::vec3>::value == 16 && traits::glsl_size<glm::vec3>::value == 12;
+    REQUIRE(b);
+    b = traits::glsl_alignment<glm::uvec4>::value == 16 && traits::glsl_size<glm::uvec4>::value == 16;
+    REQUIRE(b);
+    b = traits::glsl_alignment<glm::mat2>::value == 16 && traits::glsl_size<glm::mat2>::value == 32;
+    REQUIRE(b);
+    b = traits::glsl_alignment<glm::mat3>::value == 16 && traits::glsl_size<glm::mat3>::value == 48;
+    REQUIRE(b);
+    b = traits::glsl_size<glm::mat4>::value == 64;
+    REQUIRE(b);
+    // Array elements are padded to 16 bytes
+    b = traits::glsl_alignment<float[3]>::value == 16 && traits::glsl_size<float[3]>::value == 48;
+    REQUIRE(b);
+    b = traits::glsl_size<std::array<glm::vec3, 2>>::value == 32;
+    REQUIRE(b);
+    // Nested blocks are padded to a multiple of 16 bytes
+    b = traits::glsl_alignment<Light>::value == 16 && traits::glsl_size<Light>::value == 32;
+    REQUIRE(b);
+    b = traits::glsl_size<Light[2]>::value == 64;
+    REQUIRE(b);
+}
+
+TEST_CASE("Testing std140 offsets of matrices, arrays and nested blocks", "[ubo-traits]") {
+    bool b = (traits::field_std140_offset<T3, 1>::value == 48);
+    REQUIRE(b);
+    b = (traits::field_std140_offset<T3, 2>::value == 56);
+    REQUIRE(b);
+    b = (traits::field_std140_offset<T3, 3>::value == 64);
+    REQUIRE(b);
+    REQUIRE(traits::block_size<T3>::value == 68);
+
+    b = (traits::field_std140_offset<T4, 1>::value == 64);
+    REQUIRE(b);
+    b = (traits::field_std140_offset<T4, 2>::value == 112);
+    REQUIRE(b);
+    b = (traits::field_std140_offset<T4, 3>::value == 176);
+    REQUIRE(b);
+    REQUIRE(traits::block_size<T4>::value == 180);
+}
+
+TEST_CASE("Testing pack_std140 of matrices, arrays and nested blocks", "[ubo-traits]") {
+    std::array<unsigned char, traits::block_size<T3>::value> p3;
+    p3.fill(0xAB);
+    T3 t3;
+    t3.m = glm::mat3(2.f);
+    t3.f = 3.f;
+    t3.v = glm::vec2(4.f, 5.f);
+    t3.b = true;
+    traits::pack_std140(t3, p3.data());
+    // Matrix columns are padded to 16 bytes
+    for(int c = 0 ; c != 3 ; ++c) {
+        REQUIRE(std::memcmp(p3.data() + 16 * c, &t3.m[c], sizeof(glm::vec3)) == 0);
+        REQUIRE(p3[static_cast<size_t>(16 * c + 12)] == 0xAB);
+    }
+    REQUIRE(std::memcmp(p3.data() + 48, &t3.f, sizeof(float)) == 0);
+    REQUIRE(std::memcmp(p3.data() + 56, &t3.v, sizeof(glm::vec2)) == 0);
+    // Booleans are 4 bytes
+    unsigned int one = 1;
+    REQUIRE(std::memcmp(p3.data() + 64, &one, sizeof(unsigned int)) == 0);
+
+    std::vector<unsigned char> p4(traits::block_size<T4>::value, 0xAB);
+    T4 t4;
+    t4.view = glm::mat4(1.f);
+    for(int i = 0 ; i != 3 ; ++i) {
+        t4.scalars[i] = static_cast<float>(i);
+    }
+    for(int i = 0 ; i != 2 ; ++i) {
+        t4.lights[i].position = glm::vec4(static_cast<float>(i));
+        t4.lights[i].color = glm::vec3(static_cast<float>(i + 10));
+    }
+    t4.count = 2;
+    traits::pack_std140(t4, p4.data());
+    REQUIRE(std::memcmp(p4.data(), &t4.view, sizeof(glm::mat4)) == 0);
+    for(size_t i = 0 ; i != 3 ; ++i) {
+        REQUIRE(std::memcmp(p4.data() + 64 + 16 * i, &t4.scalars[i], sizeof(float)) == 0);
+    }
+    for(size_t i = 0 ; i != 2 ; ++i) {
+        REQUIRE(std::memcmp(p4.data() + 112 + 32 * i, &t4.lights[i].position, sizeof(glm::vec4)) == 0);
+        REQUIRE(std::memcmp(p4.data() + 128 + 32 * i, &t4.lights[i].color, sizeof(glm::vec3)) == 0);
+    }
+    REQUIRE(std::memcmp(p4.data() + 176, &t4.count, sizeof(int)) == 0);
+}